@@ -1,6 +1,6 @@
 /* Generated file by extension.py */
 
-#include "common.h"
+#include "Common.h"
 
 int eve_loadpatch(EVE_HalContext *phost);
 /* From base patch */
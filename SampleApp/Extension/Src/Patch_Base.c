@@ -5,7 +5,7 @@
  * - base patch v1.4
  */
 
-#include "patch.h"
+#include "Patch.h"
 
 /********************************************** base patch commands *******************************************************/
 /* base patch commands */
@@ -41,6 +41,33 @@ static uint32_t d;
 static uint32_t e;
 static uint32_t f;
 
+#if DISPLAY_STAGE_SIZE
+static uint8_t s_DisplayStage[DISPLAY_STAGE_SIZE];
+#endif
+
+#if EVE_TRACE
+/**
+ * @brief Replay a recorded bus trace instead of running the application
+ * 
+ * @param phost Pointer to Hal context
+ * @param filename Trace file
+ */
+static void Gpu_ReplayTrace(EVE_HalContext* phost, const char* filename)
+{
+    EVE_TraceStats stats;
+    bool ok = EVE_Trace_replay(phost, filename, &stats);
+
+    eve_printf("Replayed %u records, %u transfers in %llu us (recorded %llu us)\n",
+        (unsigned int)stats.Records, (unsigned int)stats.Transfers,
+        (unsigned long long)stats.ReplayMicros, (unsigned long long)stats.RecordedMicros);
+    eve_printf("Written %llu bytes, read %llu bytes, %u read mismatches\n",
+        (unsigned long long)stats.BytesWritten, (unsigned long long)stats.BytesRead,
+        (unsigned int)stats.ReadMismatches);
+    Gpu_Release(phost);
+    exit(ok ? 0 : 1);
+}
+#endif
+
 /**
  * @brief EVE initialization
  * 
@@ -56,6 +83,14 @@ void Gpu_Init(EVE_HalContext* phost)
 
     EVE_Hal_open(phost, &params);
 
+#if EVE_TRACE
+    /* Set EVE_TRACE_FILE to record the session, or EVE_TRACE_REPLAY to replay one */
+    if (getenv("EVE_TRACE_REPLAY"))
+        Gpu_ReplayTrace(phost, getenv("EVE_TRACE_REPLAY"));
+    if (getenv("EVE_TRACE_FILE"))
+        EVE_Trace_start(phost, getenv("EVE_TRACE_FILE"));
+#endif
+
     EVE_Util_bootupConfig(phost);
 #if defined(RP2040_PLATFORM)
     EVE_Util_loadSdCard(phost);
@@ -158,12 +193,15 @@ bool EVE_Calibrate(EVE_HalContext *phost)
  */
 void Calibration_Restore(EVE_HalContext* phost)
 {
+    /* Consecutive registers, sent in a single transfer */
+    EVE_Hal_regBatchBegin(phost);
     EVE_Hal_wr32(phost, REG_TOUCH_TRANSFORM_A, a);
     EVE_Hal_wr32(phost, REG_TOUCH_TRANSFORM_B, b);
     EVE_Hal_wr32(phost, REG_TOUCH_TRANSFORM_C, c);
     EVE_Hal_wr32(phost, REG_TOUCH_TRANSFORM_D, d);
     EVE_Hal_wr32(phost, REG_TOUCH_TRANSFORM_E, e);
     EVE_Hal_wr32(phost, REG_TOUCH_TRANSFORM_F, f);
+    EVE_Hal_regBatchEnd(phost);
 }
 
 /**
@@ -173,12 +211,17 @@ void Calibration_Restore(EVE_HalContext* phost)
  */
 void Calibration_Save(EVE_HalContext* phost)
 {
-    a = EVE_Hal_rd32(phost, REG_TOUCH_TRANSFORM_A);
-    b = EVE_Hal_rd32(phost, REG_TOUCH_TRANSFORM_B);
-    c = EVE_Hal_rd32(phost, REG_TOUCH_TRANSFORM_C);
-    d = EVE_Hal_rd32(phost, REG_TOUCH_TRANSFORM_D);
-    e = EVE_Hal_rd32(phost, REG_TOUCH_TRANSFORM_E);
-    f = EVE_Hal_rd32(phost, REG_TOUCH_TRANSFORM_F);
+    static const uint32_t addrs[6] = { REG_TOUCH_TRANSFORM_A, REG_TOUCH_TRANSFORM_B, REG_TOUCH_TRANSFORM_C,
+        REG_TOUCH_TRANSFORM_D, REG_TOUCH_TRANSFORM_E, REG_TOUCH_TRANSFORM_F };
+    uint32_t values[6];
+
+    EVE_Hal_rd32Multi(phost, addrs, values, 6);
+    a = values[0];
+    b = values[1];
+    c = values[2];
+    d = values[3];
+    e = values[4];
+    f = values[5];
 }
 
 /**
@@ -192,6 +235,14 @@ void Calibration_Save(EVE_HalContext* phost)
  */
 void Display_Start(EVE_HalContext* phost, uint8_t *bgColor, uint8_t *textColor, uint32_t tag, uint8_t frac)
 {
+#if DISPLAY_STAGE_SIZE
+    /* Frame is written in a single burst by Display_End, or by the next wait
+    on the command buffer when the frame is ended otherwise */
+    if (phost->CmdStage == s_DisplayStage)
+        EVE_Cmd_stageSubmit(phost);
+    if (!phost->CmdStage)
+        EVE_Cmd_stageBegin(phost, s_DisplayStage, DISPLAY_STAGE_SIZE);
+#endif
     EVE_CoCmd_dlStart(phost);
     EVE_CoDl_clearTag(phost, tag);
     EVE_CoDl_clearColorRgb(phost, bgColor[0], bgColor[1], bgColor[2]);
@@ -209,6 +260,10 @@ void Display_End(EVE_HalContext* phost)
 {
     EVE_CoDl_display(phost);
     EVE_CoCmd_swap(phost);
+#if DISPLAY_STAGE_SIZE
+    if (phost->CmdStage == s_DisplayStage)
+        EVE_Cmd_stageSubmit(phost);
+#endif
     EVE_Cmd_waitFlush(phost);
 }
 
@@ -311,6 +366,8 @@ uint32_t Flash_Init(EVE_HalContext* phost, const uint8_t *file)
 #define _WHERE "PC"
 #elif defined(RP2040_PLATFORM)
 #define _WHERE "SDcard"
+#else
+#define _WHERE "host"
 #endif
 
     /// show a dialog on the screen with two options: Yes or No?
@@ -765,7 +822,7 @@ void Display_Config(EVE_HalContext *phost, uint16_t format, Display_mode mode)
     eve_printf_debug("LVDSTX_ERR_STAT is %lx \n", EVE_Hal_rd32(phost, REG_LVDSTX_ERR_STAT));
 }
 
-#if defined(RP2040_PLATFORM)
+#if !defined(MSVC_PLATFORM)
 void strcat_s(char *dest, size_t dest_size, const char *src)
 {
     size_t space_left = dest_size - strlen(dest) - 1; // leave space for null terminator
@@ -65,6 +65,10 @@
 
 #define DDR_FRAMEBUFFER_STARTADDR (72 << 20) /**< from 72M(size : 9M) */
 
+#ifndef DISPLAY_STAGE_SIZE
+#define DISPLAY_STAGE_SIZE 0 /**< Host buffer for the commands from Display_Start to Display_End, in bytes, 0 to write them as they come */
+#endif
+
 typedef enum
 {
     MODE_PICTURE = 1, /**< 1 */
@@ -95,7 +99,7 @@ void Show_Diaglog_Info(EVE_HalContext *phost, const uint8_t *msg);
 uint32_t Flash_Init(EVE_HalContext *phost, const uint8_t *file);
 void WelcomeScreen(EVE_HalContext *phost, char *info[]);
 void Display_Config(EVE_HalContext *phost, uint16_t format, Display_mode mode);
-#if defined(RP2040_PLATFORM)
+#if !defined(MSVC_PLATFORM)
 void strcat_s(char* dest, size_t dest_size, const char* src);
 #endif
 #endif /* COMMON_H_ */
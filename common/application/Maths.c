@@ -29,7 +29,7 @@
  * SOFTWARE.
  */
 
-#include "common.h"
+#include "Common.h"
 #include <math.h>
 #include "Maths.h"
 
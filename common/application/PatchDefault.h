@@ -1,6 +1,6 @@
 /* Generated file by extension.py and modified for EveApps */
 
-#include "common.h"
+#include "Common.h"
 
 /* From base patch*/
 int EVE_LoadDefaultPatch(EVE_HalContext *phost);
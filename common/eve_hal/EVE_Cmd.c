@@ -34,6 +34,22 @@
 */
 
 #include "EVE_Cmd.h"
+#include "EVE_CmdProfile.h"
+
+#ifndef EVE_CMD_SPACE_LOW
+#define EVE_CMD_SPACE_LOW (EVE_CMD_FIFO_SIZE >> 3) /**< Default free space below which it is refreshed at the next transfer */
+#endif
+#ifndef EVE_CMD_SPACE_HIGH
+#define EVE_CMD_SPACE_HIGH (EVE_CMD_FIFO_SIZE >> 1) /**< Default free space waited for when blocked */
+#endif
+#define EVE_CMD_STALL_MICROS 1000 /**< Time without progress after which a wait stops short of the high watermark */
+#define EVE_CMD_TRY_MICROS 100 /**< Time suggested by EVE_Cmd_spaceMicros while the consumption rate is not known yet */
+#define EVE_CMD_RESOLVE_BURST 512 /**< Largest read of RAM_CMD by EVE_Cmd_resolve, on the stack */
+#ifndef EVE_CMD_RING_BATCH
+#define EVE_CMD_RING_BATCH (EVE_CMD_FIFO_SIZE >> 3) /**< Bytes written into RAM_CMD after which REG_CMD_WRITE is updated */
+#endif
+
+static uint32_t waitSpace(EVE_HalContext *phost, uint32_t size, uint32_t target);
 
 /**
  * @brief End read/write to Coprocessor
@@ -48,6 +64,19 @@ static inline void endFunc(EVE_HalContext *phost)
 	}
 }
 
+/**
+ * @brief Write the staged commands, and update REG_CMD_WRITE, before the command buffer state is observed
+ * 
+ * @param phost Pointer to Hal context
+ */
+static inline void stageSync(EVE_HalContext *phost)
+{
+	if (phost->CmdStageUsed && !phost->CmdRecord)
+		EVE_Cmd_stageFlush(phost);
+	if (phost->CmdWp != phost->CmdWpPublished)
+		EVE_Cmd_publish(phost);
+}
+
 /**
  * @brief Read from Coprocessor
  * 
@@ -57,6 +86,7 @@ static inline void endFunc(EVE_HalContext *phost)
 uint32_t EVE_Cmd_rp(EVE_HalContext *phost)
 {
 	uint32_t rp;
+	stageSync(phost);
 	endFunc(phost);
 	rp = EVE_Hal_rd32(phost, REG_CMD_READ) & EVE_CMD_FIFO_MASK;
 	if (EVE_CMD_FAULT(rp))
@@ -72,10 +102,30 @@ uint32_t EVE_Cmd_rp(EVE_HalContext *phost)
  */
 uint32_t EVE_Cmd_wp(EVE_HalContext *phost)
 {
+	stageSync(phost);
 	endFunc(phost);
 	return EVE_Hal_rd32(phost, REG_CMD_WRITE) & EVE_CMD_FIFO_MASK;
 }
 
+/**
+ * @brief Read the Coprocessor read and write pointers in a single burst
+ * 
+ * @param phost Pointer to Hal context
+ * @param rp Read pointer
+ * @param wp Write pointer
+ */
+static inline void rdPointers(EVE_HalContext *phost, uint32_t *rp, uint32_t *wp)
+{
+	static const uint32_t addrs[2] = { REG_CMD_READ, REG_CMD_WRITE };
+	uint32_t values[2];
+	endFunc(phost);
+	EVE_Hal_rd32Multi(phost, addrs, values, 2);
+	*rp = values[0] & EVE_CMD_FIFO_MASK;
+	*wp = values[1] & EVE_CMD_FIFO_MASK;
+	if (EVE_CMD_FAULT(*rp))
+		phost->CmdFault = true;
+}
+
 /**
  * @brief Get free space of Coprocessor's command buffer
  * 
@@ -85,15 +135,216 @@ uint32_t EVE_Cmd_wp(EVE_HalContext *phost)
 uint32_t EVE_Cmd_space(EVE_HalContext *phost)
 {
 	uint32_t space;
+	stageSync(phost);
 	endFunc(phost);
 	
 	space = EVE_Hal_rd32(phost, REG_CMDB_SPACE) & EVE_CMD_FIFO_MASK;
+	++phost->Stats.CmdSpaceReads;
 	if (EVE_CMD_FAULT(space))
 		phost->CmdFault = true;
 	phost->CmdSpace = space;
+	phost->CmdSpaceRefresh = false;
 	return space;
 }
 
+/**
+ * @brief Set when the free space of the command buffer is refreshed
+ * 
+ * Command writes go ahead on the cached free space. When it falls below the
+ * low watermark, it is refreshed once at the start of the next transfer.
+ * When a write does not fit, the host waits until the high watermark is
+ * free, or until the write fits and the coprocessor makes no more progress.
+ * 
+ * @param phost Pointer to Hal context
+ * @param low Low watermark in bytes, 0 for the default
+ * @param high High watermark in bytes, 0 for the default, 4 to wait only for the bytes written
+ */
+void EVE_Cmd_setSpaceWatermarks(EVE_HalContext *phost, uint32_t low, uint32_t high)
+{
+	eve_assert(low <= EVE_CMD_FIFO_SPACE && high <= EVE_CMD_FIFO_SPACE);
+	phost->CmdSpaceLow = low;
+	phost->CmdSpaceHigh = high;
+}
+
+/**
+ * @brief Estimate the time until the command buffer has free space, without waiting
+ * 
+ * Reads the command buffer pointers once when the cached free space does not
+ * suffice. The consumption rate is sampled from consecutive calls while
+ * the space does not suffice, and shared with the EVE_WAIT_ESTIMATE policy.
+ * 
+ * @param phost Pointer to Hal context
+ * @param size Space size, up to EVE_CMD_FIFO_SIZE - 4
+ * @return uint32_t Estimated time in microseconds, 0 when the space is free now, or in case a coprocessor fault occurred
+ */
+uint32_t EVE_Cmd_spaceMicros(EVE_HalContext *phost, uint32_t size)
+{
+	uint32_t rp;
+	uint32_t wp;
+	uint32_t space;
+	uint64_t now;
+	eve_assert(!phost->CmdWaiting);
+	eve_assert(size <= EVE_CMD_FIFO_SPACE);
+
+	if (phost->CmdSpace >= size)
+		return 0;
+
+	stageSync(phost);
+	rdPointers(phost, &rp, &wp);
+	if (phost->CmdFault)
+		return 0;
+	space = (rp - wp - 4) & EVE_CMD_FIFO_MASK;
+	++phost->Stats.CmdSpaceReads;
+	phost->CmdSpace = space;
+	phost->CmdSpaceRefresh = false;
+	if (space >= size)
+	{
+		phost->CmdRateTime = 0;
+		return 0;
+	}
+
+	/* Sample the rate only across calls which were both blocked, the coprocessor was busy in between */
+	now = EVE_micros64();
+	if (phost->CmdRateTime && rp != phost->CmdRateRp && now > phost->CmdRateTime)
+	{
+		uint32_t sample = (uint32_t)min((uint64_t)((rp - phost->CmdRateRp) & EVE_CMD_FIFO_MASK) * 1000 / (now - phost->CmdRateTime), 0xFFFFFFFFULL);
+		phost->CmdRate = phost->CmdRate ? ((phost->CmdRate * 3) + sample) >> 2 : sample;
+	}
+	phost->CmdRateRp = rp;
+	phost->CmdRateTime = now;
+
+	if (!phost->CmdRate)
+		return EVE_CMD_TRY_MICROS;
+	return (uint32_t)max((uint64_t)(size - space) * 1000 / phost->CmdRate, 1);
+}
+
+/**
+ * @brief Make sure the command buffer has space for a write
+ * 
+ * @param phost Pointer to Hal context
+ * @param size Number of bytes to write
+ * @return true True if ok
+ * @return false False if coprocessor fault
+ */
+static inline bool needSpace(EVE_HalContext *phost, uint32_t size)
+{
+	uint32_t high;
+
+	if (phost->CmdSpaceRefresh && phost->Status != EVE_STATUS_WRITING)
+	{
+		/* Fell below the low watermark, refresh between transfers */
+		phost->CmdSpaceRefresh = false;
+		if (EVE_CMD_FAULT(EVE_Cmd_space(phost)))
+			return false;
+	}
+	else if (phost->CmdSpace >= size)
+	{
+		++phost->Stats.CmdSpaceReadsAvoided;
+		return true;
+	}
+
+	if (phost->CmdSpace >= size)
+		return true;
+
+	high = phost->CmdSpaceHigh ? phost->CmdSpaceHigh : EVE_CMD_SPACE_HIGH;
+	return waitSpace(phost, size, max(size, high)) != 0;
+}
+
+/**
+ * @brief Account for bytes written to the command buffer
+ * 
+ * @param phost Pointer to Hal context
+ * @param size Number of bytes written
+ */
+static inline void useSpace(EVE_HalContext *phost, uint32_t size)
+{
+	uint32_t low = phost->CmdSpaceLow ? phost->CmdSpaceLow : EVE_CMD_SPACE_LOW;
+	eve_assert(phost->CmdSpace >= size);
+	if (phost->CmdSpace >= low && phost->CmdSpace - size < low)
+		phost->CmdSpaceRefresh = true;
+	phost->CmdSpace -= size;
+	phost->CmdWritten += size;
+}
+
+#if EVE_CMD_PROFILE
+/**
+ * @brief Command bytes written or staged so far, see EVE_CmdProfile.h
+ * 
+ * @param phost Pointer to Hal context
+ * @return uint32_t Number of bytes, wraps around
+ */
+static inline uint32_t profBytes(EVE_HalContext *phost)
+{
+	return phost->CmdWritten + (phost->CmdStage ? phost->CmdStageUsed : 0);
+}
+
+/**
+ * @brief Check whether a write outside of a function is tallied on its own
+ * 
+ * @param phost Pointer to Hal context
+ * @return true True if the write must be wrapped in profStart and profEnd
+ */
+static inline bool profOutside(EVE_HalContext *phost)
+{
+	return phost->CmdProfile && !phost->CmdFunc && !phost->CmdProfOpen && !phost->CmdRecord;
+}
+
+/**
+ * @brief Start tallying a command
+ * 
+ * @param phost Pointer to Hal context
+ */
+static void profStart(EVE_HalContext *phost)
+{
+	if (!phost->CmdProfile || phost->CmdProfOpen || phost->CmdRecord)
+		return;
+	phost->CmdProfOpen = true;
+	phost->CmdProfKeyed = false;
+	phost->CmdProfBytes = profBytes(phost);
+	phost->CmdProfMicros = phost->Stats.CmdWaitSpaceMicros;
+}
+
+/**
+ * @brief Take the first word written as the opcode of the command
+ * 
+ * @param phost Pointer to Hal context
+ * @param ptr Little-endian word
+ */
+static inline void profWord(EVE_HalContext *phost, const uint8_t *ptr)
+{
+	if (phost->CmdProfOpen && !phost->CmdProfKeyed)
+	{
+		phost->CmdProfWord = ptr[0] | ((uint32_t)ptr[1] << 8) | ((uint32_t)ptr[2] << 16) | ((uint32_t)ptr[3] << 24);
+		phost->CmdProfKeyed = true;
+	}
+}
+
+/**
+ * @brief Tally the command
+ * 
+ * @param phost Pointer to Hal context
+ */
+static void profEnd(EVE_HalContext *phost)
+{
+	uint32_t bytes;
+	uint64_t micros = phost->Stats.CmdWaitSpaceMicros;
+	if (!phost->CmdProfOpen)
+		return;
+	phost->CmdProfOpen = false;
+
+	bytes = profBytes(phost) - phost->CmdProfBytes;
+	if ((int32_t)bytes < 0)
+		bytes = 0; /* Staged commands dropped on a coprocessor fault */
+	micros = micros >= phost->CmdProfMicros ? micros - phost->CmdProfMicros : micros; /* Counters reset in between */
+	EVE_CmdProfile_add(phost, phost->CmdProfKeyed ? EVE_CmdProfile_key(phost->CmdProfWord) : EVE_CMD_PROFILE_DATA,
+	    bytes, (uint32_t)micros);
+}
+#else
+#define profStart(phost) eve_noop()
+#define profWord(phost, ptr) eve_noop()
+#define profEnd(phost) eve_noop()
+#endif
+
 /**
  * @brief Start transfer data to EVE
  * 
@@ -103,36 +354,62 @@ static void startBufferTransfer(EVE_HalContext *phost)
 {
 	if (phost->Status != EVE_STATUS_WRITING)
 	{
-		EVE_Hal_startTransfer(phost, EVE_TRANSFER_WRITE, REG_CMDB_WRITE);
+		if (phost->RegBatchCount)
+			EVE_Hal_regBatchFlush(phost);
+		EVE_Hal_startTransfer(phost, EVE_TRANSFER_WRITE, phost->CmdRing ? (RAM_CMD + phost->CmdWp) : REG_CMDB_WRITE);
+	}
+}
+
+/**
+ * @brief Advance the write offset in RAM_CMD
+ * 
+ * @param phost Pointer to Hal context
+ * @param size Number of bytes written
+ */
+static inline void ringAdvance(EVE_HalContext *phost, uint32_t size)
+{
+	phost->CmdWp = (phost->CmdWp + size) & EVE_CMD_FIFO_MASK;
+	if (!phost->CmdWp)
+	{
+		/* Continue at the start of RAM_CMD */
+		EVE_Hal_endTransfer(phost);
 	}
 }
 
 /**
- * @brief Write string to Coprocessor's comand fifo
+ * @brief Write bytes to the command buffer, splitting at the end of RAM_CMD
  * 
  * @param phost Pointer to Hal context
  * @param buffer Data pointer
  * @param size Size to write
- * @param transfer Byte to transfer
- * @param transfered Byte transfered
- * @return transfer Byte to transfer
  */
-static uint32_t wrString(EVE_HalContext *phost, const void *buffer, uint32_t *size, uint32_t transfered, uint32_t transfer)
+static void cmdWrite(EVE_HalContext *phost, const uint8_t *buffer, uint32_t size)
 {
-	uint32_t t;
-	eve_assert(transfered == 0);
-	eve_assert(transfer == *size); /* Cannot split string transfers */
-	eve_assert(transfer <= phost->CmdSpace);
-	t = EVE_Hal_transferString(phost, (const char *)buffer, transfered, transfer, 0x3);
-	if (t != transfer) /* End of string */
+	while (size)
 	{
-		eve_assert(t <= phost->CmdSpace);
-		transfer = t;
-		*size = (transfered + transfer);
+		uint32_t transfer = phost->CmdRing ? min(size, EVE_CMD_FIFO_SIZE - phost->CmdWp) : size;
+		startBufferTransfer(phost);
+		EVE_Hal_transferMem(phost, NULL, buffer, transfer);
+		if (phost->CmdRing)
+			ringAdvance(phost, transfer);
+		buffer += transfer;
+		size -= transfer;
 	}
-	eve_assert((transfered + transfer) == *size);
+}
 
-	return transfer;
+/**
+ * @brief Close the transfer after a write, unless writing a function
+ * 
+ * @param phost Pointer to Hal context
+ */
+static inline void endWrite(EVE_HalContext *phost)
+{
+	if (!phost->CmdFunc) /* Keep alive while writing function */
+	{
+		endFunc(phost);
+		if (((phost->CmdWp - phost->CmdWpPublished) & EVE_CMD_FIFO_MASK) >= EVE_CMD_RING_BATCH)
+			EVE_Cmd_publish(phost);
+	}
 }
 
 /**
@@ -141,10 +418,9 @@ static uint32_t wrString(EVE_HalContext *phost, const void *buffer, uint32_t *si
  * @param phost Pointer to Hal context
  * @param buffer Data pointer
  * @param size Size to write
- * @param string True is string
  * @return uint32_t Byte transfered
  */
-static uint32_t wrBuffer(EVE_HalContext *phost, const void *buffer, uint32_t size, bool string)
+static uint32_t wrBuffer(EVE_HalContext *phost, const uint8_t *buffer, uint32_t size)
 {
 	uint32_t transfered = 0;
 
@@ -152,164 +428,668 @@ static uint32_t wrBuffer(EVE_HalContext *phost, const void *buffer, uint32_t siz
 	{
 		uint32_t transfer = (size - transfered);
 		uint32_t space = phost->CmdSpace;
-		uint32_t req = min((string ? (transfer + 1) : transfer), (EVE_CMD_FIFO_SIZE >> 1));
-		eve_assert(!string || (req == (transfer + 1)));
-		if (space < req)
-		{
-			if (!EVE_Cmd_waitSpace(phost, req))
-				return transfered; /* Coprocessor fault */
-			space = phost->CmdSpace;
-		}
+		uint32_t req = min(transfer, (EVE_CMD_FIFO_SIZE >> 1));
+		if (!needSpace(phost, req))
+			return transfered; /* Coprocessor fault */
+		space = phost->CmdSpace;
 		if (transfer > space)
 			transfer = space;
 		eve_assert(transfer <= EVE_CMD_FIFO_SIZE - 4);
 		if (transfer)
 		{
 			startBufferTransfer(phost);
-			if (string)
-			{
-				transfer = wrString(phost, buffer, &size, transfered, transfer);
-			}
-			else
-			{
-				EVE_Hal_transferMem(phost, NULL, &((uint8_t *)buffer)[transfered], transfer);
-			}
-			if (!string && (transfer & 0x3))
+			cmdWrite(phost, &buffer[transfered], transfer);
+			if (transfer & 0x3)
 			{
 				uint32_t pad = 4 - (transfer & 0x3);
 				uint8_t padding[4] = { 0 };
 				eve_assert((transfered + transfer) == size);
-				EVE_Hal_transferMem(phost, NULL, padding, pad);
+				cmdWrite(phost, padding, pad);
 				transfer += pad;
 				eve_assert(!(transfer & 0x3));
 			}
 			transfered += transfer;
-			if (!phost->CmdFunc) /* Keep alive while writing function */
-			{
-				EVE_Hal_endTransfer(phost);
-			}
-			eve_assert(phost->CmdSpace >= transfer);
-			phost->CmdSpace -= (uint16_t)transfer;
+			useSpace(phost, transfer);
+			endWrite(phost);
 		}
 	} while (transfered < size);
 	return transfered;
 }
 
 /**
- * @brief Begin writing a function, keeps the transfer open
+ * @brief Get space for the next commands in the staging buffer
+ * 
+ * Writes the staged commands when the buffer is full.
+ * A full recording is marked, and the commands are dropped.
+ * 
+ * @param phost Pointer to Hal context
+ * @param size Number of bytes needed
+ * @return uint8_t* Space in the staging buffer, NULL when the bytes must be written directly, or dropped while recording
+ */
+static uint8_t *stageSpace(EVE_HalContext *phost, uint32_t size)
+{
+	if (phost->CmdStageUsed + size > phost->CmdStageSize)
+	{
+		if (phost->CmdRecord)
+		{
+			phost->CmdRecordFull = true;
+			return NULL;
+		}
+		if (!EVE_Cmd_stageFlush(phost) || size > phost->CmdStageSize)
+			return NULL;
+	}
+	return &phost->CmdStage[phost->CmdStageUsed];
+}
+
+/**
+ * @brief Start collecting commands in a host buffer
+ * 
+ * Commands are written to the command buffer in as few transfers as the
+ * free space allows, when the buffer is full, on EVE_Cmd_stageFlush and
+ * EVE_Cmd_stageSubmit, and before any function which reads the command
+ * buffer pointers or waits on them.
+ * 
+ * @param phost Pointer to Hal context
+ * @param buffer Host buffer, must stay valid until EVE_Cmd_stageSubmit
+ * @param size Size of the buffer, multiple of 4
+ */
+void EVE_Cmd_stageBegin(EVE_HalContext *phost, uint8_t *buffer, uint32_t size)
+{
+	eve_assert(!phost->CmdStage);
+	eve_assert(!phost->CmdReserved);
+	eve_assert(phost->CmdBufferIndex == 0);
+	eve_assert(buffer && size >= 4 && !(size & 0x3));
+	phost->CmdStage = buffer;
+	phost->CmdStageSize = size & ~0x3UL;
+	phost->CmdStageUsed = 0;
+	phost->CmdStageFrame = 0;
+}
+
+/**
+ * @brief Write the staged commands, and continue collecting
+ * 
+ * @param phost Pointer to Hal context
+ * @return true True if ok
+ * @return false False if coprocessor fault
+ */
+bool EVE_Cmd_stageFlush(EVE_HalContext *phost)
+{
+	uint32_t size = phost->CmdStageUsed;
+	eve_assert(!phost->CmdReserved);
+	eve_assert(!phost->CmdRecord);
+	if (!size)
+		return true;
+
+	/* Cleared first, the waits in wrBuffer would flush again */
+	phost->CmdStageUsed = 0;
+	return wrBuffer(phost, phost->CmdStage, size) == size;
+}
+
+/**
+ * @brief Write the staged commands, and stop collecting
+ * 
+ * @param phost Pointer to Hal context
+ * @return uint32_t Number of command bytes since EVE_Cmd_stageBegin
+ */
+uint32_t EVE_Cmd_stageSubmit(EVE_HalContext *phost)
+{
+	uint32_t frame = phost->CmdStageFrame;
+	eve_assert(phost->CmdStage);
+	eve_assert(!phost->CmdRecord);
+	EVE_Cmd_stageFlush(phost);
+	EVE_Cmd_publish(phost);
+	phost->CmdStage = NULL;
+	phost->CmdStageSize = 0;
+	phost->CmdStageFrame = 0;
+
+	++phost->Stats.CmdStageFrames;
+	phost->Stats.CmdStageLastBytes = frame;
+	if (frame > phost->Stats.CmdStagePeakBytes)
+		phost->Stats.CmdStagePeakBytes = frame;
+	return frame;
+}
+
+/**
+ * @brief Begin writing a function, keeps the transfer open
+ * 
+ * @param phost Pointer to Hal context
+ */
+void EVE_Cmd_startFunc(EVE_HalContext *phost)
+{
+	eve_assert(!phost->CmdWaiting);
+	eve_assert(phost->CmdBufferIndex == 0);
+	profStart(phost);
+	phost->CmdFunc = true;
+}
+
+/**
+ * @brief Reserve space for the words of a function
+ * 
+ * @param phost Pointer to Hal context
+ * @param size Number of bytes to reserve
+ * @return true True if ok
+ * @return false False if coprocessor fault
+ */
+static bool fastReserve(EVE_HalContext *phost, uint32_t size)
+{
+	uint8_t *ptr = EVE_Cmd_reserve(phost, size);
+	if (!ptr)
+		return false;
+	phost->CmdFastPtr = ptr;
+	phost->CmdFastEnd = ptr + size;
+	return true;
+}
+
+/**
+ * @brief Send the words written into the space of a function
+ * 
+ * @param phost Pointer to Hal context
+ */
+static void fastCommit(EVE_HalContext *phost)
+{
+	EVE_Cmd_commit(phost, (uint32_t)(phost->CmdFastPtr - phost->CmdReservePtr));
+	phost->CmdFastPtr = NULL;
+	phost->CmdFastEnd = NULL;
+}
+
+/**
+ * @brief End writing a function, closes the transfer
+ * 
+ * @param phost Pointer to Hal context
+ */
+void EVE_Cmd_endFunc(EVE_HalContext *phost)
+{
+	eve_assert(!phost->CmdWaiting);
+	eve_assert(phost->CmdBufferIndex == 0);
+	if (phost->CmdFastEnd)
+		fastCommit(phost);
+	phost->CmdFunc = false;
+	endWrite(phost);
+	profEnd(phost);
+}
+
+/**
+ * @brief Begin writing a function, and reserve its space at once
+ * 
+ * @param phost Pointer to Hal context
+ * @param size Number of bytes to reserve, multiple of 4, up to EVE_CMD_RESERVE_MAX
+ * @return true True if ok
+ * @return false False if coprocessor fault, the function is not started
+ */
+bool EVE_Cmd_startFuncReserve(EVE_HalContext *phost, uint32_t size)
+{
+	EVE_Cmd_startFunc(phost);
+	phost->CmdFastSize = size;
+	if (!fastReserve(phost, size))
+	{
+		EVE_Cmd_endFunc(phost);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Write buffer to Coprocessor's command fifo
+ * 
+ * @param phost Pointer to Hal context
+ * @param buffer Data pointer
+ * @param size Size to write
+ * @return true Write ok
+ * @return false Write error
+ */
+bool EVE_Cmd_wrMem(EVE_HalContext *phost, const uint8_t *buffer, uint32_t size)
+{
+	eve_assert(!phost->CmdWaiting);
+	eve_assert(phost->CmdBufferIndex == 0);
+
+#if EVE_CMD_PROFILE
+	if (profOutside(phost))
+	{
+		bool res;
+		profStart(phost);
+		res = EVE_Cmd_wrMem(phost, buffer, size);
+		profEnd(phost);
+		return res;
+	}
+#endif
+
+	if (phost->CmdFastEnd)
+		fastCommit(phost);
+	if (phost->CmdFunc && size >= 4)
+		profWord(phost, buffer);
+
+	if (phost->CmdStage)
+	{
+		uint32_t padded = (size + 3) & ~0x3UL;
+		uint8_t *ptr = stageSpace(phost, padded);
+		phost->CmdStageFrame += padded;
+		if (ptr)
+		{
+			memcpy(ptr, buffer, size);
+			memset(&ptr[size], 0, padded - size);
+			phost->CmdStageUsed += padded;
+			return true;
+		}
+		if (phost->CmdRecord)
+			return false;
+	}
+
+	return wrBuffer(phost, buffer, size) == size;
+}
+
+/**
+ * @brief Write a string into Coprocessor's command fifo
+ * 
+ * @param phost Pointer to Hal context
+ * @param str String to write
+ * @param maxLength Length to write, up to EVE_CMD_STRING_MAX
+ * @return uint32_t Number of bytes transfered
+ */
+uint32_t EVE_Cmd_wrString(EVE_HalContext *phost, const char *str, uint32_t maxLength)
+{
+	eve_assert(maxLength <= EVE_CMD_STRING_MAX);
+	if (!maxLength)
+		return 0;
+	return EVE_Cmd_wrStringN(phost, str, EVE_Hal_stringLength(str, maxLength));
+}
+
+/**
+ * @brief Write a string of known length into Coprocessor's command fifo
+ * 
+ * The characters are copied once, into the staging buffer or the transport
+ * write buffer, followed by the terminator and padding. Only whole words are
+ * sent, the last 0 to 3 characters go in the word holding the terminator.
+ * 
+ * @param phost Pointer to Hal context
+ * @param str Characters to write, not necessarily terminated
+ * @param length Number of characters, up to EVE_CMD_STRING_MAX
+ * @return uint32_t Number of bytes transfered, 0 in case a coprocessor fault occurred
+ */
+uint32_t EVE_Cmd_wrStringN(EVE_HalContext *phost, const char *str, uint32_t length)
+{
+	uint8_t tail[4] = { 0 };
+	uint32_t aligned = length & ~0x3UL;
+	uint32_t padded = aligned + 4;
+	eve_assert(!phost->CmdWaiting);
+	eve_assert(phost->CmdBufferIndex == 0);
+	eve_assert(length <= EVE_CMD_STRING_MAX);
+
+#if EVE_CMD_PROFILE
+	if (profOutside(phost))
+	{
+		profStart(phost);
+		padded = EVE_Cmd_wrStringN(phost, str, length);
+		profEnd(phost);
+		return padded;
+	}
+#endif
+
+	if (phost->CmdFastEnd)
+		fastCommit(phost);
+
+	if (phost->CmdStage)
+	{
+		uint8_t *ptr = stageSpace(phost, padded);
+		if (ptr)
+		{
+			memcpy(ptr, str, length);
+			memset(&ptr[length], 0, padded - length);
+			phost->CmdStageUsed += padded;
+			phost->CmdStageFrame += padded;
+			return padded;
+		}
+		if (phost->CmdRecord)
+			return 0;
+	}
+
+	if (!needSpace(phost, padded))
+		return 0; /* Coprocessor fault */
+
+	/* Transports send whole words only, the last characters go out with the terminator and padding */
+	memcpy(tail, &str[aligned], length - aligned);
+	cmdWrite(phost, (const uint8_t *)str, aligned);
+	cmdWrite(phost, tail, 4);
+	useSpace(phost, padded);
+	endWrite(phost);
+	if (phost->CmdStage)
+		phost->CmdStageFrame += padded;
+	return padded;
+}
+
+/**
+ * @brief Write 2 bytes to Coprocessor's command fifo
+ * 
+ * @param phost Pointer to Hal context
+ * @param value Data to write
+ * @return true True if ok
+ * @return false False if error
+ */
+bool EVE_Cmd_wr16(EVE_HalContext *phost, uint16_t value)
+{
+	eve_assert(!phost->CmdWaiting);
+	eve_assert(phost->CmdBufferIndex < 3);
+
+	if (phost->CmdBufferIndex < 3)
+	{
+		phost->CmdBuffer[phost->CmdBufferIndex++] = value & 0xFF;
+		phost->CmdBuffer[phost->CmdBufferIndex++] = value >> 8;
+	}
+
+	if (phost->CmdBufferIndex == 4)
+	{
+		phost->CmdBufferIndex = 0;
+		return EVE_Cmd_wrMem(phost, phost->CmdBuffer, 4);
+	}
+
+	return true;
+}
+
+/**
+ * @brief Write 4 bytes to Coprocessor's command fifo
+ * 
+ * @param phost Pointer to Hal context
+ * @param value Data to write
+ * @return true True if ok
+ * @return false False if error
+ */
+bool EVE_Cmd_wr32(EVE_HalContext *phost, uint32_t value)
+{
+	eve_assert(!phost->CmdWaiting);
+	eve_assert(phost->CmdBufferIndex == 0);
+
+#if EVE_CMD_PROFILE
+	if (profOutside(phost))
+	{
+		bool res;
+		profStart(phost);
+		res = EVE_Cmd_wr32(phost, value);
+		profEnd(phost);
+		return res;
+	}
+#endif
+
+	if (phost->CmdFastEnd)
+	{
+		/* Continue in the space of EVE_Cmd_startFuncReserve */
+		if (phost->CmdFastPtr == phost->CmdFastEnd)
+		{
+			fastCommit(phost);
+			if (!fastReserve(phost, phost->CmdFastSize))
+				return false;
+		}
+		EVE_Cmd_wr32Fast(phost, value);
+		return true;
+	}
+
+#if EVE_CMD_PROFILE
+	{
+		uint8_t word[4];
+		EVE_Cmd_put32(word, value);
+		profWord(phost, word);
+	}
+#endif
+
+	if (phost->CmdStage)
+	{
+		uint8_t *ptr = stageSpace(phost, 4);
+		if (!ptr)
+			return false; /* Coprocessor fault */
+		EVE_Cmd_put32(ptr, value);
+		phost->CmdStageUsed += 4;
+		phost->CmdStageFrame += 4;
+		return true;
+	}
+
+	if (!needSpace(phost, 4))
+		return false;
+
+	startBufferTransfer(phost);
+	EVE_Hal_transfer32(phost, value);
+	if (phost->CmdRing)
+		ringAdvance(phost, 4);
+	useSpace(phost, 4);
+	endWrite(phost);
+
+	return true;
+}
+
+/**
+ * @brief Get the free space of the command buffer, without waiting
  * 
  * @param phost Pointer to Hal context
+ * @param size Space wanted
+ * @return uint32_t Free space in bytes, 0 in case a coprocessor fault occurred
  */
-void EVE_Cmd_startFunc(EVE_HalContext *phost)
+static uint32_t trySpace(EVE_HalContext *phost, uint32_t size)
 {
-	eve_assert(!phost->CmdWaiting);
-	eve_assert(phost->CmdBufferIndex == 0);
-	phost->CmdFunc = true;
+	uint32_t space = phost->CmdSpace;
+	if (space < size)
+	{
+		space = EVE_Cmd_space(phost);
+		if (EVE_CMD_FAULT(space))
+			return 0;
+	}
+	return space;
 }
 
 /**
- * @brief End writing a function, closes the transfer
+ * @brief Begin writing a function if its whole space is free, without waiting
  * 
  * @param phost Pointer to Hal context
+ * @param size Number of bytes of the function, multiple of 4, up to EVE_CMD_RESERVE_MAX
+ * @return true True if the function is started with its space reserved
+ * @return false False when full or in case a coprocessor fault occurred, the function is not started
  */
-void EVE_Cmd_endFunc(EVE_HalContext *phost)
+bool EVE_Cmd_tryStartFuncReserve(EVE_HalContext *phost, uint32_t size)
 {
-	eve_assert(!phost->CmdWaiting);
-	eve_assert(phost->CmdBufferIndex == 0);
-	endFunc(phost);
-	phost->CmdFunc = false;
+	eve_assert(!phost->CmdFunc);
+	eve_assert(!phost->CmdStage); /* Flushing the staging buffer waits */
+	eve_assert(size <= EVE_CMD_FIFO_SPACE);
+
+	if (trySpace(phost, size) < size)
+		return false;
+	return EVE_Cmd_startFuncReserve(phost, size);
 }
 
 /**
- * @brief Write buffer to Coprocessor's command fifo
+ * @brief Write as much of a buffer as the command fifo accepts, without waiting
+ * 
+ * Outside a function, accepts whole words. Within a function, which is
+ * started by EVE_Cmd_tryStartFuncReserve, the buffer is written into the
+ * reserved space, so a function is never refused partway.
  * 
  * @param phost Pointer to Hal context
  * @param buffer Data pointer
  * @param size Size to write
- * @return true Write ok
- * @return false Write error
+ * @return uint32_t Number of bytes of the buffer accepted, 0 when full or in case a coprocessor fault occurred
  */
-bool EVE_Cmd_wrMem(EVE_HalContext *phost, const uint8_t *buffer, uint32_t size)
+uint32_t EVE_Cmd_tryWrMem(EVE_HalContext *phost, const uint8_t *buffer, uint32_t size)
 {
+	uint32_t padded = (size + 3) & ~0x3UL;
+	uint32_t space;
+	uint32_t transfer;
 	eve_assert(!phost->CmdWaiting);
 	eve_assert(phost->CmdBufferIndex == 0);
-	return wrBuffer(phost, buffer, size, false) == size;
+	eve_assert(!phost->CmdStage); /* Flushing the staging buffer waits */
+
+#if EVE_CMD_PROFILE
+	if (profOutside(phost))
+	{
+		profStart(phost);
+		transfer = EVE_Cmd_tryWrMem(phost, buffer, size);
+		profEnd(phost);
+		return transfer;
+	}
+#endif
+
+	if (phost->CmdFunc)
+	{
+		/* Functions are refused as a whole, see EVE_Cmd_tryStartFuncReserve */
+		eve_assert(phost->CmdFastEnd && padded <= (uint32_t)(phost->CmdFastEnd - phost->CmdFastPtr));
+		if (phost->CmdFastEnd && padded <= (uint32_t)(phost->CmdFastEnd - phost->CmdFastPtr))
+		{
+			memcpy(phost->CmdFastPtr, buffer, size);
+			memset(&phost->CmdFastPtr[size], 0, padded - size);
+			phost->CmdFastPtr += padded;
+			return size;
+		}
+		return EVE_Cmd_wrMem(phost, buffer, size) ? size : 0;
+	}
+
+	if (phost->CmdFastEnd)
+		fastCommit(phost);
+
+	space = trySpace(phost, min(padded, EVE_CMD_FIFO_SPACE));
+	if (padded <= space)
+		transfer = size;
+	else
+		transfer = space & ~0x3UL;
+
+	if (!transfer)
+		return 0;
+	return min(wrBuffer(phost, buffer, transfer), transfer);
 }
 
 /**
- * @brief Write a string into Coprocessor's command fifo
+ * @brief Write 4 bytes to Coprocessor's command fifo, without waiting
+ * 
+ * Within a function, the value is written into the space reserved by
+ * EVE_Cmd_tryStartFuncReserve, and is never refused.
  * 
  * @param phost Pointer to Hal context
- * @param str String to write
- * @param maxLength Length to write, up to EVE_CMD_STRING_MAX
- * @return uint32_t Number of bytes transfered
+ * @param value Data to write
+ * @return uint32_t 4 if written, 0 when full or in case a coprocessor fault occurred
  */
-uint32_t EVE_Cmd_wrString(EVE_HalContext *phost, const char *str, uint32_t maxLength)
+uint32_t EVE_Cmd_tryWr32(EVE_HalContext *phost, uint32_t value)
 {
-	uint32_t transfered;
 	eve_assert(!phost->CmdWaiting);
 	eve_assert(phost->CmdBufferIndex == 0);
-	transfered = wrBuffer(phost, str, maxLength, true);
-	return transfered;
+	eve_assert(!phost->CmdStage); /* Flushing the staging buffer waits */
+
+	if (phost->CmdFastEnd)
+	{
+		if (phost->CmdFastPtr != phost->CmdFastEnd)
+		{
+			/* Already reserved */
+			EVE_Cmd_wr32Fast(phost, value);
+			return 4;
+		}
+		fastCommit(phost);
+	}
+
+	if (phost->CmdFunc)
+	{
+		/* Functions are refused as a whole, see EVE_Cmd_tryStartFuncReserve */
+		eve_assert(false);
+		return EVE_Cmd_wr32(phost, value) ? 4 : 0;
+	}
+
+	if (trySpace(phost, 4) < 4)
+		return 0;
+	return EVE_Cmd_wr32(phost, value) ? 4 : 0;
 }
 
 /**
- * @brief Write 2 bytes to Coprocessor's command fifo
+ * @brief Reserve space in the command fifo to be filled in place
+ * 
+ * Waits for the space once, and opens the transfer. When the transport buffers
+ * writes, the returned pointer is directly into its write buffer. While
+ * staging, it is into the staging buffer.
  * 
  * @param phost Pointer to Hal context
- * @param value Data to write
- * @return true True if ok
- * @return false False if error
+ * @param size Number of bytes to reserve, multiple of 4, up to EVE_CMD_RESERVE_MAX
+ * @return uint8_t* Space to write little-endian command words into, NULL on coprocessor fault
  */
-bool EVE_Cmd_wr16(EVE_HalContext *phost, uint16_t value)
+uint8_t *EVE_Cmd_reserve(EVE_HalContext *phost, uint32_t size)
 {
+	uint8_t *ptr;
 	eve_assert(!phost->CmdWaiting);
-	eve_assert(phost->CmdBufferIndex < 3);
+	eve_assert(phost->CmdBufferIndex == 0);
+	eve_assert(!phost->CmdReserved);
+	eve_assert(!(size & 0x3));
+	eve_assert(size && size <= EVE_CMD_RESERVE_MAX);
 
-	if (phost->CmdBufferIndex < 3)
+	/* Tallied until EVE_Cmd_commit */
+	profStart(phost);
+
+	if (phost->CmdStage)
 	{
-		phost->CmdBuffer[phost->CmdBufferIndex++] = value & 0xFF;
-		phost->CmdBuffer[phost->CmdBufferIndex++] = value >> 8;
+		ptr = stageSpace(phost, size);
+		if (ptr)
+		{
+			phost->CmdReservePtr = ptr;
+			phost->CmdReserved = size;
+			return ptr;
+		}
+		if (phost->CmdRecord)
+			return NULL;
 	}
 
-	if (phost->CmdBufferIndex == 4)
+	if (!needSpace(phost, size))
 	{
-		phost->CmdBufferIndex = 0;
-		return EVE_Cmd_wrMem(phost, phost->CmdBuffer, 4);
+		if (!phost->CmdFunc)
+			profEnd(phost);
+		return NULL;
 	}
 
-	return true;
+	startBufferTransfer(phost);
+	if (phost->CmdRing && phost->CmdWp + size > EVE_CMD_FIFO_SIZE)
+		ptr = NULL; /* Wraps around the end of RAM_CMD */
+	else
+		ptr = EVE_Hal_transferReserve(phost, size);
+	if (!ptr)
+		ptr = phost->CmdReserveBuf;
+	phost->CmdReservePtr = ptr;
+	phost->CmdReserved = size;
+	return ptr;
 }
 
 /**
- * @brief Write 4 bytes to Coprocessor's command fifo
+ * @brief Send the bytes written into space from EVE_Cmd_reserve
  * 
  * @param phost Pointer to Hal context
- * @param value Data to write
- * @return true True if ok
- * @return false False if error
+ * @param size Number of bytes used, multiple of 4, at most the reserved size
  */
-bool EVE_Cmd_wr32(EVE_HalContext *phost, uint32_t value)
+void EVE_Cmd_commit(EVE_HalContext *phost, uint32_t size)
 {
-	eve_assert(!phost->CmdWaiting);
-	eve_assert(phost->CmdBufferIndex == 0);
+	eve_assert(phost->CmdReserved);
+	eve_assert(!(size & 0x3));
+	eve_assert(size <= phost->CmdReserved);
 
-	if (phost->CmdSpace < 4 && !EVE_Cmd_waitSpace(phost, 4))
-		return false;
+	if (size)
+		profWord(phost, phost->CmdReservePtr);
 
-	if (phost->Status != EVE_STATUS_WRITING)
+	if (phost->CmdStage)
 	{
-		EVE_Hal_startTransfer(phost, EVE_TRANSFER_WRITE, REG_CMDB_WRITE);
+		phost->CmdStageFrame += size;
+		if (phost->CmdReservePtr == &phost->CmdStage[phost->CmdStageUsed])
+		{
+			phost->CmdStageUsed += size;
+			phost->CmdReservePtr = NULL;
+			phost->CmdReserved = 0;
+			if (!phost->CmdFunc)
+				profEnd(phost);
+			return;
+		}
 	}
-	EVE_Hal_transfer32(phost, value);
-	if (!phost->CmdFunc) /* Keep alive while writing function */
+
+	if (phost->CmdReservePtr == phost->CmdReserveBuf)
 	{
-		EVE_Hal_endTransfer(phost);
+		cmdWrite(phost, phost->CmdReserveBuf, size);
+	}
+	else
+	{
+		EVE_Hal_transferCommit(phost, size);
+		if (phost->CmdRing)
+			ringAdvance(phost, size);
 	}
-	eve_assert(phost->CmdSpace >= 4);
-	phost->CmdSpace -= 4;
+	phost->CmdReservePtr = NULL;
+	phost->CmdReserved = 0;
 
-	return true;
+	useSpace(phost, size);
+	endWrite(phost);
+	if (!phost->CmdFunc)
+		profEnd(phost);
 }
 
 /**
@@ -325,17 +1105,193 @@ uint32_t EVE_Cmd_moveWp(EVE_HalContext *phost, uint16_t bytes)
 	uint32_t prevWp;
 	eve_assert(!phost->CmdWaiting);
 	eve_assert(phost->CmdBufferIndex == 0);
+	eve_assert(!phost->CmdRecord); /* Results cannot be recorded */
 
 	if (!EVE_Cmd_waitSpace(phost, bytes))
 		return -1;
 
-	prevWp = EVE_Cmd_wp(phost);
-	wp = (prevWp + bytes) & EVE_CMD_FIFO_MASK;
-	EVE_Hal_wr32(phost, REG_CMD_WRITE, wp);
+	if (phost->CmdRing)
+	{
+		/* Pending writes were published by the wait */
+		prevWp = phost->CmdWp;
+		phost->CmdWp = (prevWp + bytes) & EVE_CMD_FIFO_MASK;
+		EVE_Cmd_publish(phost);
+	}
+	else
+	{
+		prevWp = EVE_Cmd_wp(phost);
+		wp = (prevWp + bytes) & EVE_CMD_FIFO_MASK;
+		EVE_Hal_wr32(phost, REG_CMD_WRITE, wp);
+	}
+	useSpace(phost, bytes);
 
 	return prevWp;
 }
 
+/**
+ * @brief Select whether commands are written directly into RAM_CMD
+ * 
+ * In ring mode the command words are written at a host tracked offset in
+ * RAM_CMD, and REG_CMD_WRITE is updated once per batch of writes, before
+ * the command buffer state is observed, and by EVE_Cmd_publish. This saves
+ * the coprocessor the handling of each REG_CMDB_WRITE transfer, but costs
+ * a register write per batch, see EVE_Util_selectCmdRing.
+ * 
+ * @param phost Pointer to Hal context
+ * @param ring True to write into RAM_CMD, false to write through REG_CMDB_WRITE
+ * @return true True if ok
+ * @return false False if coprocessor fault
+ */
+bool EVE_Cmd_setRing(EVE_HalContext *phost, bool ring)
+{
+	eve_assert(!phost->CmdFunc);
+	eve_assert(!phost->CmdReserved);
+	if (!EVE_Cmd_waitFlush(phost))
+		return false;
+	phost->CmdWp = EVE_Cmd_wp(phost);
+	phost->CmdWpPublished = phost->CmdWp;
+	phost->CmdRing = ring;
+	return true;
+}
+
+/**
+ * @brief Update REG_CMD_WRITE with the commands written into RAM_CMD
+ * 
+ * @param phost Pointer to Hal context
+ */
+void EVE_Cmd_publish(EVE_HalContext *phost)
+{
+	if (phost->CmdWp == phost->CmdWpPublished)
+		return;
+
+	/* Bypasses the register batch and shadow, this is a pointer and not a setting */
+	endFunc(phost);
+	if (phost->RegBatchCount)
+		EVE_Hal_regBatchFlush(phost);
+	EVE_Hal_startTransfer(phost, EVE_TRANSFER_WRITE, REG_CMD_WRITE);
+	EVE_Hal_transfer32(phost, phost->CmdWp);
+	EVE_Hal_endTransfer(phost);
+	phost->CmdWpPublished = phost->CmdWp;
+	++phost->Stats.CmdWpPublishes;
+}
+
+/**
+ * @brief Reserve space for the result of the current function, to be read later by EVE_Cmd_resolve
+ * 
+ * @param phost Pointer to Hal context
+ * @param query Handle of the result
+ * @param result Written with `size / 4` words by EVE_Cmd_resolve
+ * @param size Size of the result in bytes, multiple of 4, up to EVE_CMD_RESOLVE_BURST
+ * @return true True if ok
+ * @return false False if coprocessor fault
+ */
+bool EVE_Cmd_query(EVE_HalContext *phost, EVE_CmdQuery *query, uint32_t *result, uint32_t size)
+{
+	uint32_t offset;
+	eve_assert(size && !(size & 0x3) && size <= EVE_CMD_RESOLVE_BURST);
+
+	offset = EVE_Cmd_moveWp(phost, (uint16_t)size);
+	query->Size = size;
+	query->Result = result;
+	if (EVE_CMD_FAULT(offset))
+	{
+		/* Never valid */
+		query->Offset = 0;
+		query->Gen = phost->CmdWritten - EVE_CMD_FIFO_SIZE - 4;
+		return false;
+	}
+	query->Offset = offset;
+	query->Gen = phost->CmdWritten - size;
+	return true;
+}
+
+/**
+ * @brief Check that a result is not overwritten yet by later commands
+ * 
+ * @param phost Pointer to Hal context
+ * @param query Handle of the result
+ * @return true True if the result is still in RAM_CMD
+ */
+static inline bool queryValid(EVE_HalContext *phost, const EVE_CmdQuery *query)
+{
+	return (phost->CmdWritten - query->Gen) <= EVE_CMD_FIFO_SIZE;
+}
+
+/**
+ * @brief Read from RAM_CMD, continuing at its start when reaching its end
+ * 
+ * @param phost Pointer to Hal context
+ * @param buffer Destination
+ * @param offset Position in RAM_CMD
+ * @param size Number of bytes
+ */
+static void rdRing(EVE_HalContext *phost, uint8_t *buffer, uint32_t offset, uint32_t size)
+{
+	uint32_t first = min(size, EVE_CMD_FIFO_SIZE - offset);
+	EVE_Hal_rdMem(phost, buffer, RAM_CMD + offset, first);
+	if (first < size)
+		EVE_Hal_rdMem(phost, &buffer[first], RAM_CMD, size - first);
+}
+
+/**
+ * @brief Read the results of any number of queries, after a single flush
+ * 
+ * The results of queries issued one after another are read together, in as
+ * few reads of RAM_CMD as EVE_CMD_RESOLVE_BURST allows. A result is lost once
+ * more than the size of the command buffer is written after its command.
+ * 
+ * @param phost Pointer to Hal context
+ * @param queries Handles from EVE_Cmd_query
+ * @param count Number of handles
+ * @return true True if ok
+ * @return false False if coprocessor fault, or if a result was already overwritten
+ */
+bool EVE_Cmd_resolve(EVE_HalContext *phost, const EVE_CmdQuery *queries, uint32_t count)
+{
+	uint8_t buffer[EVE_CMD_RESOLVE_BURST];
+	bool res = true;
+	uint32_t i = 0;
+	uint32_t j;
+	uint32_t k;
+
+	if (!count)
+		return true;
+	if (!EVE_Cmd_waitFlush(phost))
+		return false;
+
+	while (i < count)
+	{
+		const EVE_CmdQuery *first = &queries[i];
+		uint32_t span = first->Size;
+
+		if (!queryValid(phost, first))
+		{
+			eve_printf_debug("Query result overwritten\n");
+			res = false;
+			++i;
+			continue;
+		}
+
+		/* Extend the read over the following results which fit */
+		for (j = i + 1; j < count; ++j)
+		{
+			uint32_t end = queries[j].Gen - first->Gen + queries[j].Size;
+			if (!queryValid(phost, &queries[j]) || end > EVE_CMD_RESOLVE_BURST)
+				break;
+			span = max(span, end);
+		}
+
+		rdRing(phost, buffer, first->Offset, span);
+		for (; i < j; ++i)
+		{
+			const uint8_t *src = &buffer[queries[i].Gen - first->Gen];
+			for (k = 0; k < (queries[i].Size >> 2); ++k, src += 4)
+				queries[i].Result[k] = (uint32_t)src[0] | ((uint32_t)src[1] << 8) | ((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+		}
+	}
+	return res;
+}
+
 #if defined(_DEBUG)
 void debugBackupRamG(EVE_HalContext *phost);
 #endif
@@ -384,10 +1340,12 @@ static bool checkWait(EVE_HalContext *phost, uint16_t rpOrSpace)
  * 
  * @param phost Pointer to Hal context
  * @param rpOrSpace Read pointer or space
+ * @param wait Wait loop state, NULL to not pause
+ * @param pending Bytes still to be consumed
  * @return true True if ok
  * @return false False if error
  */
-static bool handleWait(EVE_HalContext *phost, uint16_t rpOrSpace)
+static bool handleWait(EVE_HalContext *phost, uint16_t rpOrSpace, EVE_HalWait *wait, uint32_t pending)
 {
 	/* Check for coprocessor fault */
 	if (!checkWait(phost, rpOrSpace))
@@ -395,6 +1353,10 @@ static bool handleWait(EVE_HalContext *phost, uint16_t rpOrSpace)
 
 	/* Process any idling */
 	EVE_Hal_idle(phost);
+
+	/* Pause according to the wait policy */
+	if (wait)
+		EVE_Hal_waitPause(phost, wait, pending);
 	return true;
 }
 
@@ -409,20 +1371,30 @@ bool EVE_Cmd_waitFlush(EVE_HalContext *phost)
 {
 	uint32_t rp;
 	uint32_t wp;
+	uint64_t start = EVE_micros64();
+	EVE_HalWait wait;
 
+	stageSync(phost);
 	eve_assert(!phost->CmdWaiting);
 	phost->CmdWaiting = true;
-	while ((rp = EVE_Cmd_rp(phost)) != (wp = EVE_Cmd_wp(phost)))
+	++phost->Stats.CmdWaitFlushCalls;
+	EVE_Hal_waitBegin(phost, &wait, &phost->CmdRate, true);
+	while (rdPointers(phost, &rp, &wp), rp != wp)
 	{
-		if (!handleWait(phost, rp))
+		++phost->Stats.CmdWaitFlushLoops;
+		if (!handleWait(phost, rp, &wait, (wp - rp) & EVE_CMD_FIFO_MASK))
 		{
 			phost->CmdSpace = (rp - wp - 4) & EVE_CMD_FIFO_MASK;
+			phost->Stats.CmdWaitFlushMicros += EVE_micros64() - start;
 			return false;
 		}
 	}
 
 	/* Command buffer empty */
+	EVE_Hal_regShadowSettle(phost);
+	phost->Stats.CmdWaitFlushMicros += EVE_micros64() - start;
 	phost->CmdSpace = EVE_CMD_FIFO_SIZE - 4;
+	phost->CmdSpaceRefresh = false;
 	phost->CmdWaiting = false;
 	return true;
 }
@@ -435,6 +1407,22 @@ bool EVE_Cmd_waitFlush(EVE_HalContext *phost)
  * @return 0 in case a coprocessor fault occurred 
  */
 uint32_t EVE_Cmd_waitSpace(EVE_HalContext *phost, uint32_t size)
+{
+	return waitSpace(phost, size, size);
+}
+
+/** 
+ * @brief Wait for free space in the command buffer
+ * 
+ * When blocked, waits for the target space, or for the requested space once
+ * the coprocessor makes no more progress.
+ * 
+ * @param phost Pointer to Hal context
+ * @param size Space size
+ * @param target Space to wait for when blocked, at least size
+ * @return 0 in case a coprocessor fault occurred 
+ */
+static uint32_t waitSpace(EVE_HalContext *phost, uint32_t size, uint32_t target)
 {
 	uint32_t space;
 
@@ -444,8 +1432,10 @@ uint32_t EVE_Cmd_waitSpace(EVE_HalContext *phost, uint32_t size)
 		return 0;
 	}
 
+	stageSync(phost);
 	eve_assert(!phost->CmdWaiting);
 	phost->CmdWaiting = true;
+	++phost->Stats.CmdWaitSpaceCalls;
 
 	space = phost->CmdSpace;
 
@@ -458,11 +1448,35 @@ uint32_t EVE_Cmd_waitSpace(EVE_HalContext *phost, uint32_t size)
 		return 0;
 
 	/* Wait until there's sufficient space */
-	while (space < size)
+	if (space < size)
 	{
-		space = EVE_Cmd_space(phost);
-		if (!handleWait(phost, space))
-			return 0;
+		/* Only timed when blocked, this is called for most command writes */
+		uint64_t start = EVE_micros64();
+		uint64_t progress = start;
+		EVE_HalWait wait;
+		eve_assert(target >= size && target <= EVE_CMD_FIFO_SPACE);
+		EVE_Hal_waitBegin(phost, &wait, &phost->CmdRate, false);
+		for (;;)
+		{
+			uint32_t prev = space;
+			++phost->Stats.CmdWaitSpaceLoops;
+			space = EVE_Cmd_space(phost);
+			if (!EVE_CMD_FAULT(space))
+			{
+				if (space >= target)
+					break;
+				if (space > prev)
+					progress = EVE_micros64();
+				else if (space >= size && EVE_micros64() - progress >= EVE_CMD_STALL_MICROS)
+					break; /* Sufficient, and the coprocessor makes no more progress */
+			}
+			if (!handleWait(phost, space, &wait, target - space))
+			{
+				phost->Stats.CmdWaitSpaceMicros += EVE_micros64() - start;
+				return 0;
+			}
+		}
+		phost->Stats.CmdWaitSpaceMicros += EVE_micros64() - start;
 	}
 
 	/* Sufficient space */
@@ -482,6 +1496,7 @@ bool EVE_Cmd_waitLogo(EVE_HalContext *phost)
 	uint32_t rp;
 	uint32_t wp;
 
+	stageSync(phost);
 	eve_assert(!phost->CmdWaiting);
 	phost->CmdWaiting = true;
 
@@ -489,7 +1504,7 @@ bool EVE_Cmd_waitLogo(EVE_HalContext *phost)
 	{
 		rp = EVE_Cmd_rp(phost);
 		wp = EVE_Cmd_wp(phost);
-		if (!handleWait(phost, rp))
+		if (!handleWait(phost, rp, NULL, 0))
 			return false;
 
 	} while ((wp != 0) || (rp != 0));
@@ -512,10 +1527,13 @@ bool EVE_Cmd_waitRead32(EVE_HalContext *phost, uint32_t ptr, uint32_t value)
 {
 	uint32_t rp;
 	uint32_t wp;
+	EVE_HalWait wait;
 
+	stageSync(phost);
 	eve_assert(!phost->CmdWaiting);
 	phost->CmdWaiting = true;
-	while ((rp = EVE_Cmd_rp(phost)) != (wp = EVE_Cmd_wp(phost)))
+	EVE_Hal_waitBegin(phost, &wait, &phost->CmdRate, false);
+	while (rdPointers(phost, &rp, &wp), rp != wp)
 	{
 		if (EVE_Hal_rd32(phost, ptr) == value)
 		{
@@ -523,7 +1541,7 @@ bool EVE_Cmd_waitRead32(EVE_HalContext *phost, uint32_t ptr, uint32_t value)
 			phost->CmdWaiting = false;
 			return true;
 		}
-		if (!handleWait(phost, rp))
+		if (!handleWait(phost, rp, &wait, (wp - rp) & EVE_CMD_FIFO_MASK))
 		{
 			phost->CmdSpace = (rp - wp - 4) & EVE_CMD_FIFO_MASK;
 			return false;
@@ -532,8 +1550,134 @@ bool EVE_Cmd_waitRead32(EVE_HalContext *phost, uint32_t ptr, uint32_t value)
 
 	/* Command buffer empty */
 	phost->CmdSpace = EVE_CMD_FIFO_SIZE - 4;
+	phost->CmdSpaceRefresh = false;
 	phost->CmdWaiting = false;
 	return EVE_Hal_rd32(phost, ptr) == value;
 }
 
+/**
+ * @brief Set the slot in RAM_G written by the fences
+ * 
+ * @param phost Pointer to Hal context
+ * @param addr Address of a word reserved in RAM_G
+ */
+void EVE_Cmd_setFenceAddr(EVE_HalContext *phost, uint32_t addr)
+{
+	eve_assert(addr && !(addr & 0x3));
+	phost->CmdFenceAddr = addr;
+	phost->CmdFenceReady = false;
+}
+
+/**
+ * @brief Append a fence, which marks the completion of the commands before it
+ * 
+ * Writes CMD_MEMWRITE of the next sequence number into the fence slot.
+ * 
+ * @param phost Pointer to Hal context
+ * @return uint32_t Sequence number of the fence, 0 if no slot is set
+ */
+uint32_t EVE_Cmd_fence(EVE_HalContext *phost)
+{
+	uint32_t addr = phost->CmdFenceAddr;
+	uint32_t seq;
+	eve_assert(!phost->CmdFunc);
+
+	if (!addr)
+	{
+		/* The slot is application memory, it is never taken implicitly */
+		eve_printf_debug("No fence slot set, see EVE_Cmd_setFenceAddr\n");
+		eve_assert(false);
+		return 0;
+	}
+
+	if (!phost->CmdFenceReady)
+	{
+		/* No command in flight writes the slot yet */
+		EVE_Hal_wr32(phost, addr, phost->CmdFenceSeq);
+		phost->CmdFenceDone = phost->CmdFenceSeq;
+		phost->CmdFenceReady = true;
+	}
+
+	seq = ++phost->CmdFenceSeq;
+	EVE_Cmd_startFunc(phost);
+	EVE_Cmd_wr32(phost, CMD_MEMWRITE);
+	EVE_Cmd_wr32(phost, addr);
+	EVE_Cmd_wr32(phost, 4);
+	EVE_Cmd_wr32(phost, seq);
+	EVE_Cmd_endFunc(phost);
+	return seq;
+}
+
+/**
+ * @brief Check whether the coprocessor has passed a fence
+ * 
+ * Reads the fence slot only when the fence was not seen passed before.
+ * 
+ * @param phost Pointer to Hal context
+ * @param seq Sequence number from EVE_Cmd_fence
+ * @return true True if the commands before the fence are done
+ */
+bool EVE_Cmd_fenceReached(EVE_HalContext *phost, uint32_t seq)
+{
+	eve_assert(!phost->CmdWaiting);
+	if ((int32_t)(seq - phost->CmdFenceDropped) <= 0)
+		return false; /* Dropped by a coprocessor reset, or not issued */
+	if ((int32_t)(phost->CmdFenceDone - seq) >= 0)
+		return true;
+
+	/* The fence may still be on the host */
+	stageSync(phost);
+	endFunc(phost);
+	phost->CmdFenceDone = EVE_Hal_rd32(phost, phost->CmdFenceAddr);
+	return (int32_t)(phost->CmdFenceDone - seq) >= 0;
+}
+
+/**
+ * @brief Wait until the coprocessor has passed a fence
+ * 
+ * Unlike EVE_Cmd_waitFlush, the commands after the fence keep the
+ * command buffer busy.
+ * 
+ * @param phost Pointer to Hal context
+ * @param seq Sequence number from EVE_Cmd_fence
+ * @return true True if the commands before the fence are done
+ * @return false False if coprocessor fault, or the fence was dropped by a coprocessor reset
+ */
+bool EVE_Cmd_waitFence(EVE_HalContext *phost, uint32_t seq)
+{
+	uint32_t rp;
+	uint32_t wp;
+	EVE_HalWait wait;
+
+	if (EVE_Cmd_fenceReached(phost, seq))
+		return true;
+	if ((int32_t)(seq - phost->CmdFenceDropped) <= 0)
+		return false;
+
+	eve_assert(!phost->CmdWaiting);
+	phost->CmdWaiting = true;
+	EVE_Hal_waitBegin(phost, &wait, &phost->CmdRate, false);
+	while (rdPointers(phost, &rp, &wp), rp != wp)
+	{
+		phost->CmdFenceDone = EVE_Hal_rd32(phost, phost->CmdFenceAddr);
+		if ((int32_t)(phost->CmdFenceDone - seq) >= 0)
+		{
+			phost->CmdWaiting = false;
+			return true;
+		}
+		if (!handleWait(phost, rp, &wait, (wp - rp) & EVE_CMD_FIFO_MASK))
+		{
+			phost->CmdSpace = (rp - wp - 4) & EVE_CMD_FIFO_MASK;
+			return false;
+		}
+	}
+
+	/* Command buffer empty */
+	phost->CmdSpace = EVE_CMD_FIFO_SIZE - 4;
+	phost->CmdSpaceRefresh = false;
+	phost->CmdWaiting = false;
+	phost->CmdFenceDone = EVE_Hal_rd32(phost, phost->CmdFenceAddr);
+	return (int32_t)(phost->CmdFenceDone - seq) >= 0;
+}
+
 /* end of file */
@@ -63,6 +63,17 @@ Updates cached available space.
 Safe to use during ongoing command transaction */
 uint32_t EVE_Cmd_space(EVE_HalContext *phost);
 
+/** Set when command writes refresh the cached free space.
+Below the `low` watermark, it is refreshed once at the start of the next transfer.
+When a write does not fit, waits for the `high` watermark, or for the write to fit once the coprocessor stalls.
+Pass 0 for the defaults, EVE_CMD_SPACE_LOW and EVE_CMD_SPACE_HIGH */
+void EVE_Cmd_setSpaceWatermarks(EVE_HalContext *phost, uint32_t low, uint32_t high);
+
+/** Estimate the time in microseconds until the command buffer has `size` bytes free, without waiting.
+Returns 0 when the space is free now, or in case a coprocessor fault occurred (see CmdFault).
+For cooperative schedulers, together with EVE_Cmd_tryStartFuncReserve, EVE_Cmd_tryWrMem and EVE_Cmd_tryWr32 */
+uint32_t EVE_Cmd_spaceMicros(EVE_HalContext *phost, uint32_t size);
+
 /* Begin writing a function, keeps the transfer open. */
 /** @note While a command transaction is ongoing,
     HAL functions outside of EVE_Cmd_* must not be used. */
@@ -71,6 +82,13 @@ void EVE_Cmd_startFunc(EVE_HalContext *phost);
 /* End writing a function, closes the transfer */
 void EVE_Cmd_endFunc(EVE_HalContext *phost);
 
+/** Begin writing a function, and reserve `size` bytes for it in the command buffer at once, up to EVE_CMD_RESERVE_MAX.
+Words are written into the space with EVE_Cmd_wr32Fast, without further checks, and sent by EVE_Cmd_endFunc.
+EVE_Cmd_wr32 continues in the space, and reserves the same size again once it is used up.
+Other EVE_Cmd writes send the words written so far, and continue without the space.
+Returns false in case a coprocessor fault occurred, the function is not started then */
+bool EVE_Cmd_startFuncReserve(EVE_HalContext *phost, uint32_t size);
+
 /** Write a buffer to the command buffer. 
 Waits if there is not enough space in the command buffer. 
 Returns false in case a coprocessor fault occurred */
@@ -79,9 +97,15 @@ bool EVE_Cmd_wrMem(EVE_HalContext *phost, const uint8_t *buffer, uint32_t size);
 /** Write a string to the command buffer, padded to 4 bytes. 
 Waits if there is not enough space in the command buffer. 
 Parameter `maxLength` can be set up to `EVE_CMD_STRING_MAX`.
-Returns false in case a coprocessor fault occurred */
+Returns the number of bytes written, 0 in case a coprocessor fault occurred */
 uint32_t EVE_Cmd_wrString(EVE_HalContext *phost, const char *str, uint32_t maxLength);
 
+/** Write `length` characters to the command buffer as a string, terminated and padded to 4 bytes.
+Does not scan for the terminator, `str` does not need to be terminated.
+Parameter `length` can be set up to `EVE_CMD_STRING_MAX`.
+Returns the number of bytes written, 0 in case a coprocessor fault occurred */
+uint32_t EVE_Cmd_wrStringN(EVE_HalContext *phost, const char *str, uint32_t length);
+
 /** Write a 16-bit value to the command buffer. 
 Uses a cache to write 4 bytes at once. 
 Wire endianness is handled by the transfer. 
@@ -95,10 +119,90 @@ Waits if there is not enough space in the command buffer.
 Returns false in case a coprocessor fault occurred */
 bool EVE_Cmd_wr32(EVE_HalContext *phost, uint32_t value);
 
+/** Begin writing a function, like EVE_Cmd_startFuncReserve, only if its whole `size` is free now, without waiting.
+Functions written with the non-blocking writes are started this way, so a function is refused as a whole, never partway.
+Returns false when full or in case a coprocessor fault occurred (see CmdFault), the function is not started then.
+Not available while staging, see EVE_Cmd_stageBegin */
+bool EVE_Cmd_tryStartFuncReserve(EVE_HalContext *phost, uint32_t size);
+
+/** Write as much of the buffer as the command buffer accepts now, without waiting, in whole words.
+Within a function started by EVE_Cmd_tryStartFuncReserve, writes into its reserved space, and is never refused.
+Returns the number of bytes of the buffer accepted, 0 when full or in case a coprocessor fault occurred (see CmdFault).
+Not available while staging, see EVE_Cmd_stageBegin */
+uint32_t EVE_Cmd_tryWrMem(EVE_HalContext *phost, const uint8_t *buffer, uint32_t size);
+
+/** Write 4 bytes to the command buffer if it accepts them now, without waiting. Returns 4 if written, otherwise 0.
+Within a function started by EVE_Cmd_tryStartFuncReserve, writes into its reserved space, and is never refused */
+uint32_t EVE_Cmd_tryWr32(EVE_HalContext *phost, uint32_t value);
+
+/** Reserve space in the command buffer, to encode command words in place.
+Waits if there is not enough space in the command buffer.
+The space may be directly in the transport write buffer, and is only valid until EVE_Cmd_commit.
+No other EVE_Cmd or EVE_Hal function may be called in between.
+Returns NULL in case a coprocessor fault occurred */
+uint8_t *EVE_Cmd_reserve(EVE_HalContext *phost, uint32_t size);
+
+/** Send the first `size` bytes written into the reserved space.
+Must be called once for each successful EVE_Cmd_reserve, `size` may be 0 */
+void EVE_Cmd_commit(EVE_HalContext *phost, uint32_t size);
+
+/** Store a little-endian command word into reserved space. Returns the next position */
+static inline uint8_t *EVE_Cmd_put32(uint8_t *ptr, uint32_t value)
+{
+	ptr[0] = value & 0xFF;
+	ptr[1] = (value >> 8) & 0xFF;
+	ptr[2] = (value >> 16) & 0xFF;
+	ptr[3] = value >> 24;
+	return ptr + 4;
+}
+
+/** Collect commands in a host buffer, to write a whole frame in as few transfers as possible.
+`buffer` holds `size` bytes, a multiple of 4, and must stay valid until EVE_Cmd_stageSubmit.
+The collected commands are written when the buffer is full, and before any EVE_Cmd function
+which reads the command buffer pointers or waits on them. Direct register and memory writes
+are not staged, and may reach the device before the staged commands */
+void EVE_Cmd_stageBegin(EVE_HalContext *phost, uint8_t *buffer, uint32_t size);
+
+/** Write the collected commands, and continue collecting.
+Returns false in case a coprocessor fault occurred */
+bool EVE_Cmd_stageFlush(EVE_HalContext *phost);
+
+/** Write the collected commands, and stop collecting.
+Returns the number of command bytes since EVE_Cmd_stageBegin */
+uint32_t EVE_Cmd_stageSubmit(EVE_HalContext *phost);
+
+/** Write a value into the space reserved by EVE_Cmd_startFuncReserve.
+The caller ensures that there is space left */
+static inline void EVE_Cmd_wr32Fast(EVE_HalContext *phost, uint32_t value)
+{
+	eve_assert(phost->CmdFastPtr && phost->CmdFastPtr < phost->CmdFastEnd);
+	phost->CmdFastPtr = EVE_Cmd_put32(phost->CmdFastPtr, value);
+}
+
 /* Move the write pointer forward by the specified number of bytes. 
 Returns the previous write pointer */
 uint32_t EVE_Cmd_moveWp(EVE_HalContext *phost, uint16_t bytes);
 
+/** Reserve space for the result of the current function, like EVE_Cmd_moveWp, without waiting for it.
+`size` is a multiple of 4, up to EVE_CMD_RESOLVE_BURST. EVE_Cmd_resolve writes the result into `result`.
+Returns false in case a coprocessor fault occurred */
+bool EVE_Cmd_query(EVE_HalContext *phost, EVE_CmdQuery *query, uint32_t *result, uint32_t size);
+
+/** Wait for the command buffer to empty once, and read the results of all the queries.
+Results of queries issued one after another are read together in a single burst.
+A result is lost once more than the size of the command buffer is written after it.
+Returns false in case a coprocessor fault occurred, or a result was already lost */
+bool EVE_Cmd_resolve(EVE_HalContext *phost, const EVE_CmdQuery *queries, uint32_t count);
+
+/** Write commands directly into RAM_CMD at a host tracked offset, instead of through REG_CMDB_WRITE.
+REG_CMD_WRITE is then updated every EVE_CMD_RING_BATCH bytes, on CMD_SWAP, at EVE_Cmd_stageSubmit,
+before any EVE_Cmd function which reads the command buffer pointers or waits on them, and on EVE_Cmd_publish.
+Waits for the command buffer to empty. Returns false in case a coprocessor fault occurred */
+bool EVE_Cmd_setRing(EVE_HalContext *phost, bool ring);
+
+/** Update REG_CMD_WRITE with the commands written into RAM_CMD since the last update */
+void EVE_Cmd_publish(EVE_HalContext *phost);
+
 /** Wait for the command buffer to fully empty. 
 Returns false in case a coprocessor fault occurred */
 bool EVE_Cmd_waitFlush(EVE_HalContext *phost);
@@ -116,6 +220,23 @@ Returns true when the value is found. Returns false otherwise
 when the coprocessor has flushed, or a coprocessor fault occured. */
 bool EVE_Cmd_waitRead32(EVE_HalContext *phost, uint32_t ptr, uint32_t value);
 
+/** Set the word in RAM_G written by the fences. The application reserves this word in its RAM_G layout.
+Must be set before the first EVE_Cmd_fence, there is no default */
+void EVE_Cmd_setFenceAddr(EVE_HalContext *phost, uint32_t addr);
+
+/** Append a fence, a CMD_MEMWRITE of the next sequence number into the fence slot.
+Returns the sequence number, to track the completion of the commands before it.
+Returns 0, which is never reached, when no slot is set with EVE_Cmd_setFenceAddr */
+uint32_t EVE_Cmd_fence(EVE_HalContext *phost);
+
+/** Check whether the commands before a fence are done, without waiting.
+Reads the fence slot only when the fence was not seen passed before */
+bool EVE_Cmd_fenceReached(EVE_HalContext *phost, uint32_t seq);
+
+/** Wait until the commands before a fence are done, while the commands after it keep the command buffer busy.
+Returns false in case a coprocessor fault occurred, or the fence was dropped by a coprocessor reset */
+bool EVE_Cmd_waitFence(EVE_HalContext *phost, uint32_t seq);
+
 #endif /* #ifndef EVE_CMD__H */
 
 /* end of file */
\ No newline at end of file
@@ -0,0 +1,299 @@
+/**
+ * @file EVE_CmdList.c
+ * @brief Recorded command lists, replayed from the host or called from RAM_G
+ *
+ * @author Bridgetek
+ *
+ * @date 2025
+ *
+ * MIT License
+ *
+ * Copyright (c) [2025] [Bridgetek Pte Ltd (BRTChip)]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "EVE_CmdList.h"
+
+/* CMD_ENDLIST terminates the list in RAM_G with a CMD_RETURN */
+#define CMDLIST_TAIL 4
+
+/**
+ * @brief FNV-1a hash of the recorded commands
+ * 
+ * @param buffer Recorded commands
+ * @param size Size in bytes
+ * @return uint32_t Hash
+ */
+static uint32_t listHash(const uint8_t *buffer, uint32_t size)
+{
+	uint32_t hash = 2166136261UL;
+	uint32_t i;
+	for (i = 0; i < size; ++i)
+		hash = (hash ^ buffer[i]) * 16777619UL;
+	return hash;
+}
+
+/**
+ * @brief Start recording commands
+ * 
+ * @param phost Pointer to Hal context
+ * @param list List to record
+ * @param buffer Host buffer, must stay valid as long as the list is used, or uploaded by EVE_CmdList_call
+ * @param size Size of the buffer, multiple of 4
+ */
+void EVE_CmdList_begin(EVE_HalContext *phost, EVE_CmdList *list, uint8_t *buffer, uint32_t size)
+{
+	eve_assert(!phost->CmdRecord);
+	eve_assert(!phost->CmdFunc);
+	eve_assert(!phost->CmdReserved);
+	eve_assert(phost->CmdBufferIndex == 0);
+	eve_assert(buffer && size >= 4 && !(size & 0x3));
+
+	list->Buffer = buffer;
+	list->Size = 0;
+	list->Hash = 0;
+	list->PrevStage = phost->CmdStage;
+	list->PrevStageSize = phost->CmdStageSize;
+	list->PrevStageUsed = phost->CmdStageUsed;
+	list->PrevStageFrame = phost->CmdStageFrame;
+
+	phost->CmdStage = buffer;
+	phost->CmdStageSize = size & ~0x3UL;
+	phost->CmdStageUsed = 0;
+	phost->CmdStageFrame = 0;
+	phost->CmdRecord = true;
+	phost->CmdRecordFull = false;
+}
+
+/**
+ * @brief Stop recording commands
+ * 
+ * @param phost Pointer to Hal context
+ * @param list List being recorded
+ * @return true True if ok
+ * @return false False if the commands did not fit the buffer
+ */
+bool EVE_CmdList_end(EVE_HalContext *phost, EVE_CmdList *list)
+{
+	bool full = phost->CmdRecordFull;
+	eve_assert(phost->CmdRecord && phost->CmdStage == list->Buffer);
+	eve_assert(!phost->CmdFunc);
+	eve_assert(phost->CmdBufferIndex == 0);
+
+	if (full)
+		eve_printf_debug("Command list does not fit %u bytes\n", (unsigned int)phost->CmdStageSize);
+	else
+		list->Size = phost->CmdStageUsed;
+	list->Hash = listHash(list->Buffer, list->Size);
+
+	phost->CmdStage = list->PrevStage;
+	phost->CmdStageSize = list->PrevStageSize;
+	phost->CmdStageUsed = list->PrevStageUsed;
+	phost->CmdStageFrame = list->PrevStageFrame;
+	phost->CmdRecord = false;
+	phost->CmdRecordFull = false;
+	return !full;
+}
+
+/**
+ * @brief Write the recorded commands to the command buffer
+ * 
+ * @param phost Pointer to Hal context
+ * @param list Recorded list
+ * @return true True if ok
+ * @return false False if coprocessor fault
+ */
+bool EVE_CmdList_play(EVE_HalContext *phost, const EVE_CmdList *list)
+{
+	if (!list->Size)
+		return true;
+	return EVE_Cmd_wrMem(phost, list->Buffer, list->Size);
+}
+
+/**
+ * @brief Set the area in RAM_G for uploaded lists
+ * 
+ * @param phost Pointer to Hal context
+ * @param addr Start of the area in RAM_G
+ * @param size Size of the area, 0 to play lists from the host
+ */
+void EVE_CmdList_setBudget(EVE_HalContext *phost, uint32_t addr, uint32_t size)
+{
+	if (phost->CmdListAddr != addr || phost->CmdListBudget != size)
+		EVE_CmdList_evictAll(phost);
+	phost->CmdListAddr = addr;
+	phost->CmdListBudget = size & ~0x3UL;
+}
+
+/**
+ * @brief Forget all uploaded lists
+ * 
+ * @param phost Pointer to Hal context
+ */
+void EVE_CmdList_evictAll(EVE_HalContext *phost)
+{
+	phost->CmdListCount = 0;
+}
+
+/**
+ * @brief Find an uploaded list with the same commands
+ * 
+ * The hash only selects the candidates, the commands are compared
+ * so a hash collision never calls a different list.
+ * 
+ * @param phost Pointer to Hal context
+ * @param list Recorded list
+ * @return EVE_CmdListEntry* Uploaded list, NULL when not found
+ */
+static EVE_CmdListEntry *findEntry(EVE_HalContext *phost, const EVE_CmdList *list)
+{
+	uint32_t i;
+	for (i = 0; i < phost->CmdListCount; ++i)
+	{
+		EVE_CmdListEntry *entry = &phost->CmdListEntries[i];
+		if (entry->Hash == list->Hash && entry->Size == list->Size
+		    && (entry->Buffer == list->Buffer || !memcmp(entry->Buffer, list->Buffer, list->Size)))
+			return entry;
+	}
+	return NULL;
+}
+
+/**
+ * @brief Drop the least recently called list
+ * 
+ * Commands already written which call it still run before any upload
+ * which overwrites it, the coprocessor processes them in order.
+ * 
+ * @param phost Pointer to Hal context
+ */
+static void evictEntry(EVE_HalContext *phost)
+{
+	uint32_t lru = 0;
+	uint32_t i;
+	eve_assert(phost->CmdListCount);
+	for (i = 1; i < phost->CmdListCount; ++i)
+	{
+		if ((int32_t)(phost->CmdListEntries[i].LastUse - phost->CmdListEntries[lru].LastUse) < 0)
+			lru = i;
+	}
+	phost->CmdListEntries[lru] = phost->CmdListEntries[--phost->CmdListCount];
+	++phost->Stats.CmdListEvictions;
+}
+
+/**
+ * @brief Find the lowest free range in the area
+ * 
+ * @param phost Pointer to Hal context
+ * @param size Bytes needed
+ * @param addr Start of the free range
+ * @return true True if found
+ * @return false False if no free range is large enough
+ */
+static bool findSpace(EVE_HalContext *phost, uint32_t size, uint32_t *addr)
+{
+	uint32_t end = phost->CmdListAddr + phost->CmdListBudget;
+	uint32_t lowest = end;
+	uint32_t c;
+	uint32_t i;
+
+	/* Candidates are the start of the area, and the end of each list */
+	for (c = 0; c <= phost->CmdListCount; ++c)
+	{
+		uint32_t start = c ? phost->CmdListEntries[c - 1].Addr + phost->CmdListEntries[c - 1].Size + CMDLIST_TAIL
+		                   : phost->CmdListAddr;
+		bool fits = start + size <= end && start < lowest;
+		for (i = 0; fits && i < phost->CmdListCount; ++i)
+		{
+			const EVE_CmdListEntry *entry = &phost->CmdListEntries[i];
+			fits = start + size <= entry->Addr || entry->Addr + entry->Size + CMDLIST_TAIL <= start;
+		}
+		if (fits)
+			lowest = start;
+	}
+	*addr = lowest;
+	return lowest < end;
+}
+
+/**
+ * @brief Upload a list into RAM_G
+ * 
+ * @param phost Pointer to Hal context
+ * @param list Recorded list
+ * @return EVE_CmdListEntry* Uploaded list, NULL when it does not fit the area, or in case a coprocessor fault occurred
+ */
+static EVE_CmdListEntry *uploadEntry(EVE_HalContext *phost, const EVE_CmdList *list)
+{
+	uint32_t size = list->Size + CMDLIST_TAIL;
+	EVE_CmdListEntry *entry;
+	uint32_t addr;
+
+	if (size > phost->CmdListBudget)
+		return NULL;
+	if (phost->CmdListCount == EVE_CMDLIST_CACHE_MAX)
+		evictEntry(phost);
+	while (!findSpace(phost, size, &addr))
+		evictEntry(phost);
+
+	EVE_CoCmd_newList(phost, addr);
+	if (!EVE_Cmd_wrMem(phost, list->Buffer, list->Size))
+		return NULL;
+	EVE_CoCmd_endList(phost);
+
+	entry = &phost->CmdListEntries[phost->CmdListCount++];
+	entry->Buffer = list->Buffer;
+	entry->Hash = list->Hash;
+	entry->Size = list->Size;
+	entry->Addr = addr;
+	++phost->Stats.CmdListUploads;
+	phost->Stats.CmdListUploadBytes += list->Size;
+	return entry;
+}
+
+/**
+ * @brief Call a list from RAM_G, uploading it on the first call
+ * 
+ * @param phost Pointer to Hal context
+ * @param list Recorded list
+ * @return true True if ok
+ * @return false False if coprocessor fault
+ */
+bool EVE_CmdList_call(EVE_HalContext *phost, const EVE_CmdList *list)
+{
+	EVE_CmdListEntry *entry;
+	if (!list->Size)
+		return true;
+
+	/* Nested in a recording, the commands are copied */
+	if (phost->CmdRecord)
+		return EVE_CmdList_play(phost, list);
+
+	++phost->Stats.CmdListCalls;
+	entry = findEntry(phost, list);
+	if (!entry)
+		entry = uploadEntry(phost, list);
+	if (!entry)
+		return !phost->CmdFault && EVE_CmdList_play(phost, list);
+
+	entry->LastUse = ++phost->CmdListClock;
+	EVE_CoCmd_callList(phost, entry->Addr);
+	return !phost->CmdFault;
+}
+
+/* end of file */
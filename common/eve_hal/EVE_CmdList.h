@@ -0,0 +1,91 @@
+/**
+ * @file EVE_CmdList.h
+ * @brief Recorded command lists, replayed from the host or called from RAM_G
+ *
+ * @author Bridgetek
+ *
+ * @date 2025
+ *
+ * MIT License
+ *
+ * Copyright (c) [2025] [Bridgetek Pte Ltd (BRTChip)]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef EVE_CMDLIST__H
+#define EVE_CMDLIST__H
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "EVE_CoCmd.h"
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/** Commands recorded by EVE_CmdList_begin and EVE_CmdList_end */
+typedef struct EVE_CmdList
+{
+	uint8_t *Buffer; /**< Recorded commands */
+	uint32_t Size; /**< Size of the recorded commands in bytes, 0 while recording or when the recording failed */
+	uint32_t Hash; /**< Hash of the recorded commands, lists with the same hash share their copy in RAM_G */
+
+	/* Staging state, restored by EVE_CmdList_end */
+	uint8_t *PrevStage;
+	uint32_t PrevStageSize;
+	uint32_t PrevStageUsed;
+	uint32_t PrevStageFrame;
+} EVE_CmdList;
+
+/**********************
+ *  GLOBAL PROTOTYPES
+ **********************/
+
+/** Start recording the following EVE_CoCmd and EVE_CoDl calls into `buffer`, of `size` bytes, a multiple of 4.
+The commands are not written to the command buffer. Functions which read results
+from the command buffer, such as EVE_CoCmd_getPtr, must not be recorded.
+May be used while staging, see EVE_Cmd_stageBegin, the staged commands are kept */
+void EVE_CmdList_begin(EVE_HalContext *phost, EVE_CmdList *list, uint8_t *buffer, uint32_t size);
+
+/** Stop recording. Returns false when the commands did not fit the buffer, the list is empty then */
+bool EVE_CmdList_end(EVE_HalContext *phost, EVE_CmdList *list);
+
+/** Write the recorded commands to the command buffer at once.
+Returns false in case a coprocessor fault occurred */
+bool EVE_CmdList_play(EVE_HalContext *phost, const EVE_CmdList *list);
+
+/** Set the area in RAM_G for the lists uploaded by EVE_CmdList_call, 0 bytes to play lists from the host.
+Lists previously uploaded are forgotten when the area changes */
+void EVE_CmdList_setBudget(EVE_HalContext *phost, uint32_t addr, uint32_t size);
+
+/** Write a CMD_CALLLIST of the list. On the first call, uploads the list into RAM_G with CMD_NEWLIST,
+evicting the least recently called lists when the area is full. Plays the list when it does not fit the area.
+The uploaded list keeps a pointer to the buffer, to compare the commands of later lists with the same hash.
+The buffer must stay valid and unchanged until the list is evicted, see EVE_CmdList_evictAll.
+Returns false in case a coprocessor fault occurred */
+bool EVE_CmdList_call(EVE_HalContext *phost, const EVE_CmdList *list);
+
+/** Forget all lists uploaded into RAM_G, they are uploaded again on the next call */
+void EVE_CmdList_evictAll(EVE_HalContext *phost);
+
+#endif /* #ifndef EVE_CMDLIST__H */
+
+/* end of file */
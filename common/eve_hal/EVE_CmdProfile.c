@@ -0,0 +1,259 @@
+/**
+ * @file EVE_CmdProfile.c
+ * @brief Tally of the written commands per opcode
+ *
+ * @author Bridgetek
+ *
+ * @date 2025
+ *
+ * MIT License
+ *
+ * Copyright (c) [2025] [Bridgetek Pte Ltd (BRTChip)]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "EVE_CmdProfile.h"
+#if EVE_CMD_PROFILE
+
+#define PROFILE_NAME(cmd) { cmd, #cmd }
+
+/* Names of the display list instructions, by opcode */
+static const char *const s_DlNames[] = {
+	"DISPLAY", "BITMAP_SOURCE", "CLEAR_COLOR_RGB", "TAG", "COLOR_RGB", "BITMAP_HANDLE", "CELL",
+	"BITMAP_LAYOUT", "BITMAP_SIZE", "ALPHA_FUNC", "STENCIL_FUNC", "BLEND_FUNC", "STENCIL_OP",
+	"POINT_SIZE", "LINE_WIDTH", "CLEAR_COLOR_A", "COLOR_A", "CLEAR_STENCIL", "CLEAR_TAG",
+	"STENCIL_MASK", "TAG_MASK", "BITMAP_TRANSFORM_A", "BITMAP_TRANSFORM_B", "BITMAP_TRANSFORM_C",
+	"BITMAP_TRANSFORM_D", "BITMAP_TRANSFORM_E", "BITMAP_TRANSFORM_F", "SCISSOR_XY", "SCISSOR_SIZE",
+	"CALL", "JUMP", "BEGIN", "COLOR_MASK", "END", "SAVE_CONTEXT", "RESTORE_CONTEXT", "RETURN",
+	"MACRO", "CLEAR", "VERTEX_FORMAT", "BITMAP_LAYOUT_H", "BITMAP_SIZE_H", "PALETTE_SOURCE",
+	"VERTEX_TRANSLATE_X", "VERTEX_TRANSLATE_Y", "NOP", "BITMAP_EXT_FORMAT", "BITMAP_SWIZZLE", NULL,
+	"BITMAP_SOURCEH", "PALETTE_SOURCEH", "BITMAP_ZORDER", "REGION"
+};
+
+/* Names of the coprocessor commands */
+static const struct
+{
+	uint32_t Cmd;
+	const char *Name;
+} s_CmdNames[] = {
+	PROFILE_NAME(CMD_ANIMDRAW), PROFILE_NAME(CMD_ANIMFRAME), PROFILE_NAME(CMD_ANIMSTART),
+	PROFILE_NAME(CMD_ANIMSTOP), PROFILE_NAME(CMD_ANIMXY), PROFILE_NAME(CMD_APPEND),
+	PROFILE_NAME(CMD_APPENDF), PROFILE_NAME(CMD_ARC), PROFILE_NAME(CMD_BGCOLOR),
+	PROFILE_NAME(CMD_BITMAP_TRANSFORM), PROFILE_NAME(CMD_BUTTON), PROFILE_NAME(CMD_CALIBRATE),
+	PROFILE_NAME(CMD_CALIBRATESUB), PROFILE_NAME(CMD_CALLLIST), PROFILE_NAME(CMD_CGRADIENT),
+	PROFILE_NAME(CMD_CLOCK), PROFILE_NAME(CMD_COLDSTART), PROFILE_NAME(CMD_COPYLIST),
+	PROFILE_NAME(CMD_DDRSHUTDOWN), PROFILE_NAME(CMD_DDRSTARTUP), PROFILE_NAME(CMD_DIAL),
+	PROFILE_NAME(CMD_DLSTART), PROFILE_NAME(CMD_ENABLEREGION), PROFILE_NAME(CMD_ENDLIST),
+	PROFILE_NAME(CMD_FENCE), PROFILE_NAME(CMD_FGCOLOR), PROFILE_NAME(CMD_FILLWIDTH),
+	PROFILE_NAME(CMD_FLASHATTACH), PROFILE_NAME(CMD_FLASHDETACH), PROFILE_NAME(CMD_FLASHERASE),
+	PROFILE_NAME(CMD_FLASHFAST), PROFILE_NAME(CMD_FLASHPROGRAM), PROFILE_NAME(CMD_FLASHREAD),
+	PROFILE_NAME(CMD_FLASHSOURCE), PROFILE_NAME(CMD_FLASHSPIDESEL), PROFILE_NAME(CMD_FLASHSPIRX),
+	PROFILE_NAME(CMD_FLASHSPITX), PROFILE_NAME(CMD_FLASHUPDATE), PROFILE_NAME(CMD_FLASHWRITE),
+	PROFILE_NAME(CMD_FSDIR), PROFILE_NAME(CMD_FSOPTION), PROFILE_NAME(CMD_FSREAD),
+	PROFILE_NAME(CMD_FSSIZE), PROFILE_NAME(CMD_FSSOURCE), PROFILE_NAME(CMD_GAUGE),
+	PROFILE_NAME(CMD_GETIMAGE), PROFILE_NAME(CMD_GETMATRIX), PROFILE_NAME(CMD_GETPROPS),
+	PROFILE_NAME(CMD_GETPTR), PROFILE_NAME(CMD_GLOW), PROFILE_NAME(CMD_GRADCOLOR),
+	PROFILE_NAME(CMD_GRADIENT), PROFILE_NAME(CMD_GRADIENTA), PROFILE_NAME(CMD_GRAPHICSFINISH),
+	PROFILE_NAME(CMD_I2SSTARTUP), PROFILE_NAME(CMD_INFLATE), PROFILE_NAME(CMD_INTERRUPT),
+	PROFILE_NAME(CMD_KEYS), PROFILE_NAME(CMD_LOADASSET), PROFILE_NAME(CMD_LOADIDENTITY),
+	PROFILE_NAME(CMD_LOADIMAGE), PROFILE_NAME(CMD_LOADPATCH), PROFILE_NAME(CMD_LOADWAV),
+	PROFILE_NAME(CMD_LOGO), PROFILE_NAME(CMD_MEDIAFIFO), PROFILE_NAME(CMD_MEMCPY),
+	PROFILE_NAME(CMD_MEMCRC), PROFILE_NAME(CMD_MEMSET), PROFILE_NAME(CMD_MEMWRITE),
+	PROFILE_NAME(CMD_MEMZERO), PROFILE_NAME(CMD_NEWLIST), PROFILE_NAME(CMD_NOP),
+	PROFILE_NAME(CMD_NUMBER), PROFILE_NAME(CMD_PLAYVIDEO), PROFILE_NAME(CMD_PLAYWAV),
+	PROFILE_NAME(CMD_PROGRESS), PROFILE_NAME(CMD_REGREAD), PROFILE_NAME(CMD_REGWRITE),
+	PROFILE_NAME(CMD_RENDERTARGET), PROFILE_NAME(CMD_RESETFONTS), PROFILE_NAME(CMD_RESTORECONTEXT),
+	PROFILE_NAME(CMD_RESULT), PROFILE_NAME(CMD_RETURN), PROFILE_NAME(CMD_ROMFONT),
+	PROFILE_NAME(CMD_ROTATE), PROFILE_NAME(CMD_ROTATEAROUND), PROFILE_NAME(CMD_RUNANIM),
+	PROFILE_NAME(CMD_SAVECONTEXT), PROFILE_NAME(CMD_SCALE), PROFILE_NAME(CMD_SCREENSAVER),
+	PROFILE_NAME(CMD_SCROLLBAR), PROFILE_NAME(CMD_SDATTACH), PROFILE_NAME(CMD_SDBLOCKREAD),
+	PROFILE_NAME(CMD_SETBASE), PROFILE_NAME(CMD_SETBITMAP), PROFILE_NAME(CMD_SETFONT),
+	PROFILE_NAME(CMD_SETMATRIX), PROFILE_NAME(CMD_SETROTATE), PROFILE_NAME(CMD_SETSCRATCH),
+	PROFILE_NAME(CMD_SKETCH), PROFILE_NAME(CMD_SKIPCOND), PROFILE_NAME(CMD_SLIDER),
+	PROFILE_NAME(CMD_SNAPSHOT), PROFILE_NAME(CMD_SPINNER), PROFILE_NAME(CMD_STOP),
+	PROFILE_NAME(CMD_SWAP), PROFILE_NAME(CMD_SYNC), PROFILE_NAME(CMD_TESTCARD),
+	PROFILE_NAME(CMD_TEXT), PROFILE_NAME(CMD_TEXTDIM), PROFILE_NAME(CMD_TOGGLE),
+	PROFILE_NAME(CMD_TRACK), PROFILE_NAME(CMD_TRANSLATE), PROFILE_NAME(CMD_VIDEOFRAME),
+	PROFILE_NAME(CMD_VIDEOSTART), PROFILE_NAME(CMD_WAIT), PROFILE_NAME(CMD_WAITCHANGE),
+	PROFILE_NAME(CMD_WAITCOND), PROFILE_NAME(CMD_WATCHDOG)
+};
+
+/**
+ * @brief Start tallying the written commands
+ * 
+ * @param phost Pointer to Hal context
+ * @param profile Tallies, cleared
+ * @param perFrame Report and clear at every CMD_SWAP
+ */
+void EVE_CmdProfile_begin(EVE_HalContext *phost, EVE_CmdProfile *profile, bool perFrame)
+{
+	eve_assert(!phost->CmdProfOpen);
+	EVE_CmdProfile_clear(profile);
+	profile->PerFrame = perFrame;
+	phost->CmdProfile = profile;
+}
+
+/**
+ * @brief Stop tallying the written commands
+ * 
+ * @param phost Pointer to Hal context
+ */
+void EVE_CmdProfile_end(EVE_HalContext *phost)
+{
+	eve_assert(!phost->CmdProfOpen);
+	phost->CmdProfile = NULL;
+}
+
+/**
+ * @brief Clear the tallies
+ * 
+ * @param profile Tallies
+ */
+void EVE_CmdProfile_clear(EVE_CmdProfile *profile)
+{
+	memset(profile->Entries, 0, sizeof(profile->Entries));
+	profile->Frames = 0;
+}
+
+/**
+ * @brief Get the key of a command from its first word
+ * 
+ * @param word First word of the command
+ * @return uint32_t Key, index into the tallies
+ */
+uint32_t EVE_CmdProfile_key(uint32_t word)
+{
+	if ((word & 0xFFFFFF00UL) == 0xFFFFFF00UL)
+		return EVE_CMD_PROFILE_CMD + (word & 0xFF);
+	switch (word >> 30)
+	{
+	case 0:
+		return word >> 24;
+	case 1:
+		return EVE_CMD_PROFILE_VERTEX2F;
+	case 2:
+		return EVE_CMD_PROFILE_VERTEX2II;
+	default:
+		return EVE_CMD_PROFILE_DATA;
+	}
+}
+
+/**
+ * @brief Get the name of a key
+ * 
+ * @param key Key, see EVE_CmdProfile_key
+ * @return const char* Name, NULL when unknown
+ */
+const char *EVE_CmdProfile_name(uint32_t key)
+{
+	uint32_t i;
+	if (key < sizeof(s_DlNames) / sizeof(s_DlNames[0]))
+		return s_DlNames[key];
+	if (key == EVE_CMD_PROFILE_VERTEX2F)
+		return "VERTEX2F";
+	if (key == EVE_CMD_PROFILE_VERTEX2II)
+		return "VERTEX2II";
+	if (key == EVE_CMD_PROFILE_DATA)
+		return "(data)";
+	for (i = 0; i < sizeof(s_CmdNames) / sizeof(s_CmdNames[0]); ++i)
+	{
+		if (EVE_CmdProfile_key(s_CmdNames[i].Cmd) == key)
+			return s_CmdNames[i].Name;
+	}
+	return NULL;
+}
+
+/**
+ * @brief Print the tallies, sorted by bytes
+ * 
+ * @param profile Tallies
+ * @param lines Maximum number of opcodes to print, 0 for all
+ */
+void EVE_CmdProfile_report(const EVE_CmdProfile *profile, uint32_t lines)
+{
+	uint16_t order[EVE_CMD_PROFILE_KEYS];
+	uint32_t count = 0;
+	uint32_t calls = 0;
+	uint32_t bytes = 0;
+	uint64_t micros = 0;
+	uint32_t key;
+	uint32_t i;
+
+	/* Insertion sort of the used keys, by bytes, descending */
+	for (key = 0; key < EVE_CMD_PROFILE_KEYS; ++key)
+	{
+		const EVE_CmdProfileEntry *entry = &profile->Entries[key];
+		if (!entry->Calls)
+			continue;
+		calls += entry->Calls;
+		bytes += entry->Bytes;
+		micros += entry->Micros;
+		for (i = count++; i && profile->Entries[order[i - 1]].Bytes < entry->Bytes; --i)
+			order[i] = order[i - 1];
+		order[i] = (uint16_t)key;
+	}
+
+	eve_printf("Command profile: %u calls, %u bytes, %llu us blocked, %u frames\n",
+	    (unsigned int)calls, (unsigned int)bytes, (unsigned long long)micros, (unsigned int)profile->Frames);
+	if (lines && lines < count)
+		count = lines;
+	for (i = 0; i < count; ++i)
+	{
+		const EVE_CmdProfileEntry *entry = &profile->Entries[order[i]];
+		const char *name = EVE_CmdProfile_name(order[i]);
+		if (name)
+			eve_printf("  %-24s", name);
+		else
+			eve_printf("  0x%03x                   ", (unsigned int)order[i]);
+		eve_printf(" %8u calls %10u bytes %3u%% %10llu us\n", (unsigned int)entry->Calls, (unsigned int)entry->Bytes,
+		    (unsigned int)(bytes ? (uint64_t)entry->Bytes * 100 / bytes : 0), (unsigned long long)entry->Micros);
+	}
+}
+
+/**
+ * @brief Tally a written command
+ * 
+ * @param phost Pointer to Hal context
+ * @param key Key of the command, see EVE_CmdProfile_key
+ * @param bytes Bytes written
+ * @param micros Time blocked while writing
+ */
+void EVE_CmdProfile_add(EVE_HalContext *phost, uint32_t key, uint32_t bytes, uint32_t micros)
+{
+	EVE_CmdProfile *profile = phost->CmdProfile;
+	EVE_CmdProfileEntry *entry = &profile->Entries[key];
+	++entry->Calls;
+	entry->Bytes += bytes;
+	entry->Micros += micros;
+
+	if (key == EVE_CMD_PROFILE_CMD + (CMD_SWAP & 0xFF))
+	{
+		++profile->Frames;
+		if (profile->PerFrame)
+		{
+			EVE_CmdProfile_report(profile, 0);
+			EVE_CmdProfile_clear(profile);
+		}
+	}
+}
+
+#endif
+
+/* end of file */
@@ -0,0 +1,112 @@
+/**
+ * @file EVE_CmdProfile.h
+ * @brief Tally of the written commands per opcode
+ *
+ * @author Bridgetek
+ *
+ * @date 2025
+ *
+ * MIT License
+ *
+ * Copyright (c) [2025] [Bridgetek Pte Ltd (BRTChip)]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef EVE_CMDPROFILE__H
+#define EVE_CMDPROFILE__H
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "EVE_Hal.h"
+
+#if EVE_CMD_PROFILE
+
+/*
+With EVE_CMD_PROFILE, each command is tallied once it is written, or staged.
+Commands are told apart by their first word: the CMD_* opcode, or the
+display list instruction. Buffers written outside of a function, such as
+the inline data of CMD_INFLATE or a played EVE_CmdList, are tallied as data.
+The blocked time is the time spent waiting for free space in the command
+buffer while writing the command. While staging, the commands wait when
+they are written at once: for the command which filled the staging buffer,
+and in EVE_Cmd_stageSubmit, which is not tallied.
+*/
+
+/**********************
+ *      MACROS
+ **********************/
+#define EVE_CMD_PROFILE_VERTEX2F 0x40 /**< Key of VERTEX2F, after the other display list instructions */
+#define EVE_CMD_PROFILE_VERTEX2II 0x41
+#define EVE_CMD_PROFILE_CMD 0x100 /**< Key of the first CMD_* opcode, by its lowest byte */
+#define EVE_CMD_PROFILE_DATA 0x200 /**< Key of buffers written outside of a function */
+#define EVE_CMD_PROFILE_KEYS 0x201
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/** Tally of one opcode */
+typedef struct EVE_CmdProfileEntry
+{
+	uint32_t Calls;
+	uint32_t Bytes; /**< Bytes written, including arguments, strings and result space */
+	uint64_t Micros; /**< Time blocked on the free space of the command buffer */
+} EVE_CmdProfileEntry;
+
+/** Tallies by key, see EVE_CmdProfile_key */
+typedef struct EVE_CmdProfile
+{
+	EVE_CmdProfileEntry Entries[EVE_CMD_PROFILE_KEYS];
+	uint32_t Frames; /**< CMD_SWAP written since the last clear */
+	bool PerFrame; /**< Report and clear at every CMD_SWAP */
+} EVE_CmdProfile;
+
+/**********************
+ *  GLOBAL PROTOTYPES
+ **********************/
+
+/** Start tallying the written commands into `profile`, which is cleared.
+With `perFrame`, a report is printed and the tallies are cleared at every CMD_SWAP */
+void EVE_CmdProfile_begin(EVE_HalContext *phost, EVE_CmdProfile *profile, bool perFrame);
+
+/** Stop tallying. The tallies are kept for EVE_CmdProfile_report */
+void EVE_CmdProfile_end(EVE_HalContext *phost);
+
+/** Clear the tallies */
+void EVE_CmdProfile_clear(EVE_CmdProfile *profile);
+
+/** Print the tallies, sorted by bytes, at most `lines` opcodes, 0 for all */
+void EVE_CmdProfile_report(const EVE_CmdProfile *profile, uint32_t lines);
+
+/** Get the key of a command from its first word */
+uint32_t EVE_CmdProfile_key(uint32_t word);
+
+/** Get the name of a key, NULL when unknown */
+const char *EVE_CmdProfile_name(uint32_t key);
+
+/** Tally a written command, used by EVE_Cmd */
+void EVE_CmdProfile_add(EVE_HalContext *phost, uint32_t key, uint32_t bytes, uint32_t micros);
+
+#endif
+
+#endif /* #ifndef EVE_CMDPROFILE__H */
+
+/* end of file */
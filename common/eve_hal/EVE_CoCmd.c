@@ -47,41 +47,43 @@ void EVE_CoCmd_d(EVE_HalContext *phost, uint32_t cmd)
 
 void EVE_CoCmd_dd(EVE_HalContext *phost, uint32_t cmd, uint32_t d0)
 {
-	EVE_Cmd_startFunc(phost);
-	EVE_Cmd_wr32(phost, cmd);
-	EVE_Cmd_wr32(phost, d0);
+	if (!EVE_Cmd_startFuncReserve(phost, 8))
+		return;
+	EVE_Cmd_wr32Fast(phost, cmd);
+	EVE_Cmd_wr32Fast(phost, d0);
 	EVE_Cmd_endFunc(phost);
 }
 
 void EVE_CoCmd_ddd(EVE_HalContext *phost, uint32_t cmd, uint32_t d0, uint32_t d1)
 {
-	EVE_Cmd_startFunc(phost);
-	EVE_Cmd_wr32(phost, cmd);
-	EVE_Cmd_wr32(phost, d0);
-	EVE_Cmd_wr32(phost, d1);
+	if (!EVE_Cmd_startFuncReserve(phost, 12))
+		return;
+	EVE_Cmd_wr32Fast(phost, cmd);
+	EVE_Cmd_wr32Fast(phost, d0);
+	EVE_Cmd_wr32Fast(phost, d1);
 	EVE_Cmd_endFunc(phost);
 }
 
 void EVE_CoCmd_dddd(EVE_HalContext *phost, uint32_t cmd, uint32_t d0, uint32_t d1, uint32_t d2)
 {
-	EVE_Cmd_startFunc(phost);
-	EVE_Cmd_wr32(phost, cmd);
-	EVE_Cmd_wr32(phost, d0);
-	EVE_Cmd_wr32(phost, d1);
-	EVE_Cmd_wr32(phost, d2);
+	if (!EVE_Cmd_startFuncReserve(phost, 16))
+		return;
+	EVE_Cmd_wr32Fast(phost, cmd);
+	EVE_Cmd_wr32Fast(phost, d0);
+	EVE_Cmd_wr32Fast(phost, d1);
+	EVE_Cmd_wr32Fast(phost, d2);
 	EVE_Cmd_endFunc(phost);
 }
 
 void EVE_CoCmd_ddwww(EVE_HalContext *phost, uint32_t cmd,
     uint32_t d0, uint16_t w1, uint16_t w2, uint16_t w3)
 {
-	EVE_Cmd_startFunc(phost);
-	EVE_Cmd_wr32(phost, cmd);
-	EVE_Cmd_wr32(phost, d0);
-	EVE_Cmd_wr16(phost, w1);
-	EVE_Cmd_wr16(phost, w2);
-	EVE_Cmd_wr16(phost, w3);
-	EVE_Cmd_wr16(phost, 0);
+	if (!EVE_Cmd_startFuncReserve(phost, 16))
+		return;
+	EVE_Cmd_wr32Fast(phost, cmd);
+	EVE_Cmd_wr32Fast(phost, d0);
+	EVE_Cmd_wr32Fast(phost, w1 | ((uint32_t)w2 << 16));
+	EVE_Cmd_wr32Fast(phost, w3);
 	EVE_Cmd_endFunc(phost);
 }
 
@@ -89,54 +91,48 @@ void EVE_CoCmd_dwwdwwd(EVE_HalContext *phost, uint32_t cmd,
     uint16_t w0, uint16_t w1, uint32_t d2,
     uint16_t w3, uint16_t w4, uint32_t d5)
 {
-	EVE_Cmd_startFunc(phost);
-	EVE_Cmd_wr32(phost, cmd);
-	EVE_Cmd_wr16(phost, w0);
-	EVE_Cmd_wr16(phost, w1);
-	EVE_Cmd_wr32(phost, d2);
-	EVE_Cmd_wr16(phost, w3);
-	EVE_Cmd_wr16(phost, w4);
-	EVE_Cmd_wr32(phost, d5);
+	if (!EVE_Cmd_startFuncReserve(phost, 20))
+		return;
+	EVE_Cmd_wr32Fast(phost, cmd);
+	EVE_Cmd_wr32Fast(phost, w0 | ((uint32_t)w1 << 16));
+	EVE_Cmd_wr32Fast(phost, d2);
+	EVE_Cmd_wr32Fast(phost, w3 | ((uint32_t)w4 << 16));
+	EVE_Cmd_wr32Fast(phost, d5);
 	EVE_Cmd_endFunc(phost);
 }
 
 void EVE_CoCmd_dwwww(EVE_HalContext *phost, uint32_t cmd,
     uint16_t w0, uint16_t w1, uint16_t w2, uint16_t w3)
 {
-	EVE_Cmd_startFunc(phost);
-	EVE_Cmd_wr32(phost, cmd);
-	EVE_Cmd_wr16(phost, w0);
-	EVE_Cmd_wr16(phost, w1);
-	EVE_Cmd_wr16(phost, w2);
-	EVE_Cmd_wr16(phost, w3);
+	if (!EVE_Cmd_startFuncReserve(phost, 12))
+		return;
+	EVE_Cmd_wr32Fast(phost, cmd);
+	EVE_Cmd_wr32Fast(phost, w0 | ((uint32_t)w1 << 16));
+	EVE_Cmd_wr32Fast(phost, w2 | ((uint32_t)w3 << 16));
 	EVE_Cmd_endFunc(phost);
 }
 
 void EVE_CoCmd_dwwwww(EVE_HalContext *phost, uint32_t cmd,
     uint16_t w0, uint16_t w1, uint16_t w2, uint16_t w3, uint16_t w4)
 {
-	EVE_Cmd_startFunc(phost);
-	EVE_Cmd_wr32(phost, cmd);
-	EVE_Cmd_wr16(phost, w0);
-	EVE_Cmd_wr16(phost, w1);
-	EVE_Cmd_wr16(phost, w2);
-	EVE_Cmd_wr16(phost, w3);
-	EVE_Cmd_wr16(phost, w4);
-	EVE_Cmd_wr16(phost, 0);
+	if (!EVE_Cmd_startFuncReserve(phost, 16))
+		return;
+	EVE_Cmd_wr32Fast(phost, cmd);
+	EVE_Cmd_wr32Fast(phost, w0 | ((uint32_t)w1 << 16));
+	EVE_Cmd_wr32Fast(phost, w2 | ((uint32_t)w3 << 16));
+	EVE_Cmd_wr32Fast(phost, w4);
 	EVE_Cmd_endFunc(phost);
 }
 
 void EVE_CoCmd_dwwwwww(EVE_HalContext *phost, uint32_t cmd,
     uint16_t w0, uint16_t w1, uint16_t w2, uint16_t w3, uint16_t w4, uint16_t w5)
 {
-	EVE_Cmd_startFunc(phost);
-	EVE_Cmd_wr32(phost, cmd);
-	EVE_Cmd_wr16(phost, w0);
-	EVE_Cmd_wr16(phost, w1);
-	EVE_Cmd_wr16(phost, w2);
-	EVE_Cmd_wr16(phost, w3);
-	EVE_Cmd_wr16(phost, w4);
-	EVE_Cmd_wr16(phost, w5);
+	if (!EVE_Cmd_startFuncReserve(phost, 16))
+		return;
+	EVE_Cmd_wr32Fast(phost, cmd);
+	EVE_Cmd_wr32Fast(phost, w0 | ((uint32_t)w1 << 16));
+	EVE_Cmd_wr32Fast(phost, w2 | ((uint32_t)w3 << 16));
+	EVE_Cmd_wr32Fast(phost, w4 | ((uint32_t)w5 << 16));
 	EVE_Cmd_endFunc(phost);
 }
 
@@ -144,16 +140,13 @@ void EVE_CoCmd_dwwwwwww(EVE_HalContext *phost, uint32_t cmd,
     uint16_t w0, uint16_t w1, uint16_t w2, uint16_t w3,
     uint16_t w4, uint16_t w5, uint16_t w6)
 {
-	EVE_Cmd_startFunc(phost);
-	EVE_Cmd_wr32(phost, cmd);
-	EVE_Cmd_wr16(phost, w0);
-	EVE_Cmd_wr16(phost, w1);
-	EVE_Cmd_wr16(phost, w2);
-	EVE_Cmd_wr16(phost, w3);
-	EVE_Cmd_wr16(phost, w4);
-	EVE_Cmd_wr16(phost, w5);
-	EVE_Cmd_wr16(phost, w6);
-	EVE_Cmd_wr16(phost, 0);
+	if (!EVE_Cmd_startFuncReserve(phost, 20))
+		return;
+	EVE_Cmd_wr32Fast(phost, cmd);
+	EVE_Cmd_wr32Fast(phost, w0 | ((uint32_t)w1 << 16));
+	EVE_Cmd_wr32Fast(phost, w2 | ((uint32_t)w3 << 16));
+	EVE_Cmd_wr32Fast(phost, w4 | ((uint32_t)w5 << 16));
+	EVE_Cmd_wr32Fast(phost, w6);
 	EVE_Cmd_endFunc(phost);
 }
 
@@ -161,16 +154,13 @@ void EVE_CoCmd_dwwwwwwww(EVE_HalContext *phost, uint32_t cmd,
     uint16_t w0, uint16_t w1, uint16_t w2, uint16_t w3,
     uint16_t w4, uint16_t w5, uint16_t w6, uint16_t w7)
 {
-	EVE_Cmd_startFunc(phost);
-	EVE_Cmd_wr32(phost, cmd);
-	EVE_Cmd_wr16(phost, w0);
-	EVE_Cmd_wr16(phost, w1);
-	EVE_Cmd_wr16(phost, w2);
-	EVE_Cmd_wr16(phost, w3);
-	EVE_Cmd_wr16(phost, w4);
-	EVE_Cmd_wr16(phost, w5);
-	EVE_Cmd_wr16(phost, w6);
-	EVE_Cmd_wr16(phost, w7);
+	if (!EVE_Cmd_startFuncReserve(phost, 20))
+		return;
+	EVE_Cmd_wr32Fast(phost, cmd);
+	EVE_Cmd_wr32Fast(phost, w0 | ((uint32_t)w1 << 16));
+	EVE_Cmd_wr32Fast(phost, w2 | ((uint32_t)w3 << 16));
+	EVE_Cmd_wr32Fast(phost, w4 | ((uint32_t)w5 << 16));
+	EVE_Cmd_wr32Fast(phost, w6 | ((uint32_t)w7 << 16));
 	EVE_Cmd_endFunc(phost);
 }
 
@@ -185,6 +175,7 @@ void EVE_CoCmd_dlStart(EVE_HalContext *phost)
 void EVE_CoCmd_swap(EVE_HalContext *phost)
 {
 	EVE_CoCmd_d(phost, CMD_SWAP);
+	EVE_Cmd_publish(phost); /* Do not hold the frame back until the next batch */
 }
 
 void EVE_CoCmd_interrupt(EVE_HalContext *phost, uint32_t ms)
@@ -260,6 +251,17 @@ bool EVE_CoCmd_getMatrix(EVE_HalContext *phost, int32_t *m)
 	return true;
 }
 
+bool EVE_CoCmd_getMatrixQuery(EVE_HalContext *phost, EVE_CmdQuery *query, int32_t *m)
+{
+	bool res;
+
+	EVE_Cmd_startFunc(phost);
+	EVE_Cmd_wr32(phost, CMD_GETMATRIX);
+	res = EVE_Cmd_query(phost, query, (uint32_t *)m, 6 * 4);
+	EVE_Cmd_endFunc(phost);
+	return res;
+}
+
 void EVE_CoCmd_setRotate(EVE_HalContext *phost, uint32_t r)
 {
 	const bool swapXY = r & 0x2;
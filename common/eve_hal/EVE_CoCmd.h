@@ -43,6 +43,19 @@
 /** Change to `eve_pragma_error` to strictly disable use of unsupported commands */
 #define EVE_COCMD_UNSUPPORTED(cmd, res) eve_pragma_warning("Coprocessor command " #cmd " is not supported on this platform")(res)
 
+/**********************
+ *      TYPEDEFS
+ **********************/
+/** Text label for EVE_CoCmd_labels */
+typedef struct EVE_CoCmdLabel
+{
+	int16_t X; /**< x-coordinate of text base, in pixels */
+	int16_t Y; /**< y-coordinate of text base, in pixels */
+	int16_t Font; /**< Font to use for text, 0-31 */
+	uint16_t Options; /**< Text option, without OPT_FORMAT */
+	const char *Str; /**< Text string, UTF-8 encoding */
+} EVE_CoCmdLabel;
+
 /**********************
  *  GLOBAL PROTOTYPES
  **********************/
@@ -182,6 +195,16 @@ void EVE_CoCmd_copyList(EVE_HalContext *phost, uint32_t dst);
  */
 bool EVE_CoCmd_getMatrix(EVE_HalContext *phost, int32_t *m);
 
+/**
+ * @brief Send CMD_GETMATRIX, and read the result later with EVE_Cmd_resolve
+ *
+ * @param phost Pointer to Hal context
+ * @param query Handle of the result
+ * @param m output parameters; 6 values; written by EVE_Cmd_resolve
+ * @return bool Returns false in case of error
+ */
+bool EVE_CoCmd_getMatrixQuery(EVE_HalContext *phost, EVE_CmdQuery *query, int32_t *m);
+
 /**
  * @brief CMD_SETROTATE
  *
@@ -662,6 +685,18 @@ void EVE_CoCmd_runAnim(EVE_HalContext *phost, uint32_t waitmask, uint32_t play);
  */
 bool EVE_CoCmd_memCrc(EVE_HalContext *phost, uint32_t ptr, uint32_t num, uint32_t *result);
 
+/**
+ * @brief Send CMD_MEMCRC, and read the result later with EVE_Cmd_resolve
+ *
+ * @param phost Pointer to Hal context
+ * @param ptr starting address of the memory block
+ * @param num number of bytes in the source memory block
+ * @param query Handle of the result
+ * @param result output parameter; written with the CRC-32 by EVE_Cmd_resolve
+ * @return bool Returns false in case of error
+ */
+bool EVE_CoCmd_memCrcQuery(EVE_HalContext *phost, uint32_t ptr, uint32_t num, EVE_CmdQuery *query, uint32_t *result);
+
 /**
  * @brief Send CMD_REGREAD
  *
@@ -672,6 +707,17 @@ bool EVE_CoCmd_memCrc(EVE_HalContext *phost, uint32_t ptr, uint32_t num, uint32_
  */
 bool EVE_CoCmd_regRead(EVE_HalContext *phost, uint32_t ptr, uint32_t *result);
 
+/**
+ * @brief Send CMD_REGREAD, and read the result later with EVE_Cmd_resolve
+ *
+ * @param phost Pointer to Hal context
+ * @param ptr address of register to read
+ * @param query Handle of the result
+ * @param result output parameter; written with the register value by EVE_Cmd_resolve
+ * @return bool Returns false in case of error
+ */
+bool EVE_CoCmd_regReadQuery(EVE_HalContext *phost, uint32_t ptr, EVE_CmdQuery *query, uint32_t *result);
+
 /**
  * @brief Send CMD_REGWRITE
  *
@@ -689,6 +735,16 @@ void EVE_CoCmd_regWrite(EVE_HalContext *phost, uint32_t ptr, uint32_t value);
  */
 bool EVE_CoCmd_getPtr(EVE_HalContext *phost, uint32_t *result);
 
+/**
+ * @brief Get the first unallocated memory location later with EVE_Cmd_resolve
+ *
+ * @param phost Pointer to Hal context
+ * @param query Handle of the result
+ * @param result The first unallocated memory location, written by EVE_Cmd_resolve
+ * @return bool Returns false in case of error
+ */
+bool EVE_CoCmd_getPtrQuery(EVE_HalContext *phost, EVE_CmdQuery *query, uint32_t *result);
+
 /**
  * @brief Get the image properties decompressed by CMD_LOADIMAGE
  *
@@ -700,6 +756,16 @@ bool EVE_CoCmd_getPtr(EVE_HalContext *phost, uint32_t *result);
  */
 bool EVE_CoCmd_getProps(EVE_HalContext *phost, uint32_t *ptr, uint32_t *w, uint32_t *h);
 
+/**
+ * @brief Get the image properties decompressed by CMD_LOADIMAGE later with EVE_Cmd_resolve
+ *
+ * @param phost Pointer to Hal context
+ * @param query Handle of the result
+ * @param result 3 values; source address, width and height, written by EVE_Cmd_resolve
+ * @return bool Returns false on coprocessor fault
+ */
+bool EVE_CoCmd_getPropsQuery(EVE_HalContext *phost, EVE_CmdQuery *query, uint32_t *result);
+
 /**
  * @brief Send CMD_GETIMAGE
  *
@@ -713,6 +779,16 @@ bool EVE_CoCmd_getProps(EVE_HalContext *phost, uint32_t *ptr, uint32_t *w, uint3
  */
 bool EVE_CoCmd_getImage(EVE_HalContext *phost, uint32_t *source, uint32_t *fmt, uint32_t *w, uint32_t *h, uint32_t *palette);
 
+/**
+ * @brief Get the image properties later with EVE_Cmd_resolve
+ *
+ * @param phost Pointer to Hal context
+ * @param query Handle of the result
+ * @param result 5 values; source, format, width, height and palette, written by EVE_Cmd_resolve
+ * @return bool False on coprocessor error
+ */
+bool EVE_CoCmd_getImageQuery(EVE_HalContext *phost, EVE_CmdQuery *query, uint32_t *result);
+
 /**
  * @brief Send CMD_SDATTACH.
  *
@@ -758,6 +834,17 @@ void EVE_CoCmd_fsoption(EVE_HalContext *phost, uint32_t options);
  */
 uint32_t EVE_CoCmd_fssize(EVE_HalContext *phost, const char *file, uint32_t size);
 
+/**
+ * @brief Send CMD_FSSIZE, and read the result later with EVE_Cmd_resolve
+ *
+ * @param phost Pointer to Hal context
+ * @param file file name
+ * @param query Handle of the result
+ * @param result output parameter; written with the file size by EVE_Cmd_resolve
+ * @return bool Returns false in case of error
+ */
+bool EVE_CoCmd_fssizeQuery(EVE_HalContext *phost, const char *file, EVE_CmdQuery *query, uint32_t *result);
+
 /**
  * @brief Send CMD_FSDIR.
  *
@@ -992,6 +1079,33 @@ void EVE_CoCmd_text(EVE_HalContext *phost, int16_t x, int16_t y, int16_t font, u
  */
 void EVE_CoCmd_text_s(EVE_HalContext *phost, int16_t x, int16_t y, int16_t font, uint16_t options, const char *s, uint32_t length);
 
+/**
+ * @brief Send CMD_TEXT with a known length
+ *
+ * Writes exactly `length` characters, without scanning for the terminator.
+ * Option OPT_FORMAT is not supported.
+ *
+ * @param phost Pointer to Hal context
+ * @param x x-coordinate of text base, in pixels
+ * @param y y-coordinate of text base, in pixels
+ * @param font Font to use for text, 0-31
+ * @param options Text option
+ * @param s Text string, UTF-8 encoding, does not need to be terminated
+ * @param length Number of characters, up to EVE_CMD_STRING_MAX
+ */
+void EVE_CoCmd_textn(EVE_HalContext *phost, int16_t x, int16_t y, int16_t font, uint16_t options, const char *s, uint32_t length);
+
+/**
+ * @brief Send CMD_TEXT for many labels, encoded in as few reservations as possible
+ *
+ * Option OPT_FORMAT is not supported.
+ *
+ * @param phost Pointer to Hal context
+ * @param labels Labels to draw, strings up to EVE_CMD_STRING_MAX characters
+ * @param count Number of labels
+ */
+void EVE_CoCmd_labels(EVE_HalContext *phost, const EVE_CoCmdLabel *labels, uint32_t count);
+
 /**
  * @brief Send CMD_BUTTON
  *
@@ -1209,7 +1323,11 @@ void EVE_CoCmd_glow(EVE_HalContext *phost, int16_t x, int16_t y, int16_t w, uint
  */
 static inline void EVE_CoCmd_dl(EVE_HalContext *phost, uint32_t dl)
 {
-	EVE_CoCmd_d(phost, dl);
+	/* Inline while there is space left from EVE_Cmd_startFuncReserve */
+	if (phost->CmdFastPtr != phost->CmdFastEnd)
+		EVE_Cmd_wr32Fast(phost, dl);
+	else
+		EVE_CoCmd_d(phost, dl);
 }
 
 
@@ -33,26 +33,31 @@
 
 void EVE_CoCmd_memWrite(EVE_HalContext *phost, uint32_t ptr, uint32_t num)
 {
+	EVE_Hal_regShadowQueue(phost, ptr, num);
 	EVE_CoCmd_ddd(phost, CMD_MEMWRITE, ptr, num);
 }
 
 void EVE_CoCmd_memWrite32(EVE_HalContext *phost, uint32_t ptr, uint32_t value)
 {
+	EVE_Hal_regShadowUpdate(phost, ptr, value);
 	EVE_CoCmd_dddd(phost, CMD_MEMWRITE, ptr, 4, value);
 }
 
 void EVE_CoCmd_memSet(EVE_HalContext *phost, uint32_t ptr, uint32_t value, uint32_t num)
 {
+	EVE_Hal_regShadowQueue(phost, ptr, num);
 	EVE_CoCmd_dddd(phost, CMD_MEMSET, ptr, value, num);
 }
 
 void EVE_CoCmd_memZero(EVE_HalContext *phost, uint32_t ptr, uint32_t num)
 {
+	EVE_Hal_regShadowQueue(phost, ptr, num);
 	EVE_CoCmd_ddd(phost, CMD_MEMZERO, ptr, num);
 }
 
 void EVE_CoCmd_memCpy(EVE_HalContext *phost, uint32_t dest, uint32_t src, uint32_t num)
 {
+	EVE_Hal_regShadowQueue(phost, dest, num);
 	EVE_CoCmd_dddd(phost, CMD_MEMCPY, dest, src, num);
 }
 
@@ -289,6 +294,19 @@ bool EVE_CoCmd_memCrc(EVE_HalContext *phost, uint32_t ptr, uint32_t num, uint32_
 	return true;
 }
 
+bool EVE_CoCmd_memCrcQuery(EVE_HalContext *phost, uint32_t ptr, uint32_t num, EVE_CmdQuery *query, uint32_t *result)
+{
+	bool res;
+
+	EVE_Cmd_startFunc(phost);
+	EVE_Cmd_wr32(phost, CMD_MEMCRC);
+	EVE_Cmd_wr32(phost, ptr);
+	EVE_Cmd_wr32(phost, num);
+	res = EVE_Cmd_query(phost, query, result, 4);
+	EVE_Cmd_endFunc(phost);
+	return res;
+}
+
 bool EVE_CoCmd_regRead(EVE_HalContext *phost, uint32_t ptr, uint32_t *result)
 {
 	uint32_t resAddr;
@@ -309,8 +327,21 @@ bool EVE_CoCmd_regRead(EVE_HalContext *phost, uint32_t ptr, uint32_t *result)
 	return true;
 }
 
+bool EVE_CoCmd_regReadQuery(EVE_HalContext *phost, uint32_t ptr, EVE_CmdQuery *query, uint32_t *result)
+{
+	bool res;
+
+	EVE_Cmd_startFunc(phost);
+	EVE_Cmd_wr32(phost, CMD_REGREAD);
+	EVE_Cmd_wr32(phost, ptr);
+	res = EVE_Cmd_query(phost, query, result, 4);
+	EVE_Cmd_endFunc(phost);
+	return res;
+}
+
 void EVE_CoCmd_regWrite(EVE_HalContext *phost, uint32_t ptr, uint32_t value)
 {
+	EVE_Hal_regShadowUpdate(phost, ptr, value);
 	EVE_CoCmd_ddd(phost, CMD_REGWRITE, ptr, value);
 }
 
@@ -333,6 +364,17 @@ bool EVE_CoCmd_getPtr(EVE_HalContext *phost, uint32_t *result)
 	return true;
 }
 
+bool EVE_CoCmd_getPtrQuery(EVE_HalContext *phost, EVE_CmdQuery *query, uint32_t *result)
+{
+	bool res;
+
+	EVE_Cmd_startFunc(phost);
+	EVE_Cmd_wr32(phost, CMD_GETPTR);
+	res = EVE_Cmd_query(phost, query, result, 4);
+	EVE_Cmd_endFunc(phost);
+	return res;
+}
+
 bool EVE_CoCmd_getProps(EVE_HalContext *phost, uint32_t *ptr, uint32_t *w, uint32_t *h)
 {
 	uint32_t resAddr;
@@ -357,6 +399,17 @@ bool EVE_CoCmd_getProps(EVE_HalContext *phost, uint32_t *ptr, uint32_t *w, uint3
 	return true;
 }
 
+bool EVE_CoCmd_getPropsQuery(EVE_HalContext *phost, EVE_CmdQuery *query, uint32_t *result)
+{
+	bool res;
+
+	EVE_Cmd_startFunc(phost);
+	EVE_Cmd_wr32(phost, CMD_GETPROPS);
+	res = EVE_Cmd_query(phost, query, result, 12);
+	EVE_Cmd_endFunc(phost);
+	return res;
+}
+
 bool EVE_CoCmd_getImage(EVE_HalContext *phost, uint32_t *source, uint32_t *fmt, uint32_t *w, uint32_t *h, uint32_t *palette)
 {
 	uint32_t resAddr;
@@ -385,6 +438,17 @@ bool EVE_CoCmd_getImage(EVE_HalContext *phost, uint32_t *source, uint32_t *fmt,
 	return true;
 }
 
+bool EVE_CoCmd_getImageQuery(EVE_HalContext *phost, EVE_CmdQuery *query, uint32_t *result)
+{
+	bool res;
+
+	EVE_Cmd_startFunc(phost);
+	EVE_Cmd_wr32(phost, CMD_GETIMAGE);
+	res = EVE_Cmd_query(phost, query, result, 4 * 5);
+	EVE_Cmd_endFunc(phost);
+	return res;
+}
+
 uint32_t EVE_CoCmd_fssource(EVE_HalContext *phost, const char *file, uint32_t result)
 {
 	uint32_t wp;
@@ -442,6 +506,18 @@ uint32_t EVE_CoCmd_fssize(EVE_HalContext *phost, const char *file, uint32_t size
 	return EVE_Hal_rd32(phost, RAM_CMD + ((CMDBUF_SIZE - 4) & (wp - 4)));
 }
 
+bool EVE_CoCmd_fssizeQuery(EVE_HalContext *phost, const char *file, EVE_CmdQuery *query, uint32_t *result)
+{
+	bool res;
+
+	EVE_Cmd_startFunc(phost);
+	EVE_Cmd_wr32(phost, CMD_FSSIZE);
+	EVE_Cmd_wrString(phost, file, EVE_CMD_STRING_MAX);
+	res = EVE_Cmd_query(phost, query, result, 4); /* The size parameter is the result */
+	EVE_Cmd_endFunc(phost);
+	return res;
+}
+
 uint32_t EVE_CoCmd_fsdir(EVE_HalContext *phost, uint32_t dst, uint32_t num, const char *path, uint32_t result)
 {
 	uint32_t wp;
@@ -102,6 +102,86 @@ void EVE_CoCmd_text_s(EVE_HalContext *phost, int16_t x, int16_t y, int16_t font,
 	EVE_Cmd_endFunc(phost);
 }
 
+void EVE_CoCmd_textn(EVE_HalContext *phost, int16_t x, int16_t y, int16_t font, uint16_t options, const char *s, uint32_t length)
+{
+	eve_assert(!(options & OPT_FORMAT));
+	if (font >= 64)
+	{
+		eve_printf_debug("Invalid font handle specified: %i\n", (int)font);
+		return;
+	}
+
+	if (!EVE_Cmd_startFuncReserve(phost, 12))
+		return;
+	EVE_Cmd_wr32Fast(phost, CMD_TEXT);
+	EVE_Cmd_wr32Fast(phost, (((uint32_t)y << 16) | (x & 0xffff)));
+	EVE_Cmd_wr32Fast(phost, (((uint32_t)options << 16) | (font & 0xffff)));
+	EVE_Cmd_wrStringN(phost, s, length);
+	EVE_Cmd_endFunc(phost);
+}
+
+void EVE_CoCmd_labels(EVE_HalContext *phost, const EVE_CoCmdLabel *labels, uint32_t count)
+{
+	/* Each label takes at least 16 bytes */
+	uint16_t lengths[EVE_CMD_RESERVE_MAX / 16];
+	uint32_t first = 0;
+	uint32_t i;
+
+	while (first < count)
+	{
+		uint32_t size = 0;
+		uint32_t last = first;
+		uint8_t *ptr;
+
+		/* Group as many labels as fit in one reservation, without the invalid ones */
+		while (last < count && (last - first) < (EVE_CMD_RESERVE_MAX / 16))
+		{
+			const EVE_CoCmdLabel *label = &labels[last];
+			uint32_t length;
+			uint32_t labelSize;
+			eve_assert(!(label->Options & OPT_FORMAT));
+			if (label->Font >= 64)
+			{
+				eve_printf_debug("Invalid font handle specified: %i\n", (int)label->Font);
+				lengths[last - first] = UINT16_MAX;
+				++last;
+				continue;
+			}
+			length = EVE_Hal_stringLength(label->Str, EVE_CMD_STRING_MAX);
+			labelSize = 12 + ((length + 4) & ~0x3UL);
+			if (size + labelSize > EVE_CMD_RESERVE_MAX)
+				break;
+			lengths[last - first] = (uint16_t)length;
+			size += labelSize;
+			++last;
+		}
+		eve_assert(last > first);
+
+		if (size)
+		{
+			ptr = EVE_Cmd_reserve(phost, size);
+			if (!ptr)
+				return; /* Coprocessor fault */
+			for (i = first; i < last; ++i)
+			{
+				const EVE_CoCmdLabel *label = &labels[i];
+				uint32_t length = lengths[i - first];
+				uint32_t padded = (length + 4) & ~0x3UL;
+				if (length == UINT16_MAX)
+					continue;
+				ptr = EVE_Cmd_put32(ptr, CMD_TEXT);
+				ptr = EVE_Cmd_put32(ptr, (((uint32_t)label->Y << 16) | (label->X & 0xffff)));
+				ptr = EVE_Cmd_put32(ptr, (((uint32_t)label->Options << 16) | (label->Font & 0xffff)));
+				memcpy(ptr, label->Str, length);
+				memset(&ptr[length], 0, padded - length);
+				ptr += padded;
+			}
+			EVE_Cmd_commit(phost, size);
+		}
+		first = last;
+	}
+}
+
 void EVE_CoCmd_button(EVE_HalContext *phost, int16_t x, int16_t y, int16_t w, int16_t h, int16_t font, uint16_t options, const char *s, ...)
 {
 	va_list args;
@@ -59,6 +59,8 @@ Platform target:
 - FT4222_PLATFORM (set EVE_PLATFORM_FT4222)
 - MPSSE_PLATFORM (set EVE_PLATFORM_MPSSE)
 - RP2040_PLATFORM (set EVE_PLATFORM_RP2040)
+- LINUX_SPIDEV_PLATFORM (set EVE_PLATFORM_LINUX_SPIDEV)
+- SIM_PLATFORM (set EVE_PLATFORM_SIM)
 
 Display resolution:
 - DISPLAY_RESOLUTION_WUXGA
@@ -86,7 +88,7 @@ Additionally, the following support flags are set:
 #endif
 
 #if defined(EVE_PLATFORM_FT4222) || defined(EVE_PLATFORM_MPSSE) || defined(EVE_PLATFORM_RP2040) \
-    || defined(MM2040EV)
+    || defined(MM2040EV) || defined(EVE_PLATFORM_LINUX_SPIDEV) || defined(EVE_PLATFORM_SIM)
 #define EVE_PLATFORM_AVAILABLE
 #endif
 
@@ -181,6 +183,8 @@ Ultimately, the platform selection must set one of the following internal platfo
 - FT4222_PLATFORM
 - MPSSE_PLATFORM
 - RP2040_PLATFORM
+- LINUX_SPIDEV_PLATFORM
+- SIM_PLATFORM
 These may only be set by one of the platform target definitions, and should not be set manually by the user.
 
 */
@@ -197,6 +201,14 @@ These may only be set by one of the platform target definitions, and should not
 #elif defined(EVE_PLATFORM_RP2040)
 #define RP2040_PLATFORM
 #define EVE_HOST EVE_HOST_RP2040
+
+#elif defined(EVE_PLATFORM_LINUX_SPIDEV)
+#define LINUX_SPIDEV_PLATFORM
+#define EVE_HOST EVE_HOST_LINUX_SPIDEV
+
+#elif defined(EVE_PLATFORM_SIM)
+#define SIM_PLATFORM
+#define EVE_HOST EVE_HOST_SIM
 #endif
 
 #define EVE_CONFIG__STR(x) #x
@@ -222,6 +234,24 @@ These may only be set by one of the platform target definitions, and should not
 
 // Other options
 #define EVE_CMD_HOOKS 0 /**< Allow adding a callback hook into EVE_CoCmd calls using CoCmdHook in EVE_HalContext */
+#ifndef EVE_TRACE
+#define EVE_TRACE 0 /**< Allow recording and replaying bus transactions, see EVE_Trace.h */
+#endif
+#ifndef EVE_TRANSPORT_OPS
+#define EVE_TRANSPORT_OPS 0 /**< Dispatch the transport through a table in EVE_HalContext, to replace or decorate it at runtime, see EVE_HalTransport.h */
+#endif
+#ifndef EVE_REG_SHADOW
+#define EVE_REG_SHADOW 0 /**< Serve EVE_Hal_rd32 of registers which only the host changes from a copy in EVE_HalContext, see EVE_Hal_regShadowInvalidate */
+#endif
+#ifndef EVE_CMD_PROFILE
+#define EVE_CMD_PROFILE 0 /**< Allow tallying the written commands per opcode, see EVE_CmdProfile.h */
+#endif
+#ifndef EVE_SPI_CALIBRATE
+#define EVE_SPI_CALIBRATE 0 /**< Step up the SPI clock and channel mode in EVE_Util_bootupConfig, see EVE_Util_calibrateSpi */
+#endif
+#ifndef EVE_CMD_RING_SELECT
+#define EVE_CMD_RING_SELECT 0 /**< Choose between REG_CMDB_WRITE and direct RAM_CMD writes in EVE_Util_bootupConfig, see EVE_Util_selectCmdRing */
+#endif
 
 ///////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////
@@ -262,6 +292,27 @@ These may only be set by one of the platform target definitions, and should not
 #define EVE_BUFFER_WRITES
 #endif
 
+/* Write buffered data on a background thread on USB bridge platforms.
+Define EVE_ASYNC_WRITES as 0 to write synchronously */
+#if defined(FT4222_PLATFORM) || defined(MPSSE_PLATFORM)
+#ifndef EVE_ASYNC_WRITES
+#define EVE_ASYNC_WRITES 1
+#endif
+#else
+#undef EVE_ASYNC_WRITES
+#define EVE_ASYNC_WRITES 0
+#endif
+
+/* Send buffered writes with DMA, while the next packet is being filled, see EVE_HalDma.h.
+Define EVE_DMA_WRITES as 0 to write with blocking SPI calls */
+#ifndef EVE_DMA_WRITES
+#if defined(RP2040_PLATFORM)
+#define EVE_DMA_WRITES 1
+#else
+#define EVE_DMA_WRITES 0
+#endif
+#endif
+
 /* Enable FatFS by default on supported platforms */
 #if defined(RP2040_PLATFORM)
 #ifndef EVE_ENABLE_FATFS
@@ -282,7 +333,9 @@ These may only be set by one of the platform target definitions, and should not
 #endif
 #if ((defined(FT4222_PLATFORM) ? 1 : 0)   \
     + (defined(MPSSE_PLATFORM) ? 1 : 0)   \
-    + (defined(RP2040_PLATFORM) ? 1 : 0)) \
+    + (defined(RP2040_PLATFORM) ? 1 : 0)   \
+    + (defined(LINUX_SPIDEV_PLATFORM) ? 1 : 0)   \
+    + (defined(SIM_PLATFORM) ? 1 : 0)) \
     > 1
 #pragma message(__FILE__ "(" EVE_CONFIG_STR(__LINE__) "): warning PLATFORM: " \
                                                       "More than one platform has been selected")
@@ -291,6 +344,10 @@ These may only be set by one of the platform target definitions, and should not
 #pragma message(__FILE__ "(" EVE_CONFIG_STR(__LINE__) "): warning PLATFORM: " \
                                                       "No platform was selected")
 #endif
+#if EVE_TRACE && EVE_ENABLE_FATFS
+#pragma message(__FILE__ "(" EVE_CONFIG_STR(__LINE__) "): error EVE_TRACE: " \
+                                                      "Bus tracing requires a host platform with stdio file access")
+#endif
 
 #endif /* EVE_CONFIG__H */
 
@@ -31,8 +31,12 @@
 
 #include "EVE_Hal.h"
 
+#include <stdlib.h>
 #include <string.h>
 
+/* Maximum number of registers read in a single burst by EVE_Hal_rd32Multi */
+#define EVE_RD32_MULTI_BURST 16
+
 
 EVE_HalPlatform g_HalPlatform;
 /** @name INIT */
@@ -96,10 +100,34 @@ void EVE_Hal_defaults(EVE_HalParameters *parameters)
  */
 bool EVE_Hal_open(EVE_HalContext *phost, const EVE_HalParameters *parameters)
 {
+#if EVE_TRANSPORT_OPS
+	return EVE_Hal_openTransport(phost, parameters, &g_HalTransportPlatform);
+#else
 	memset(phost, 0, sizeof(EVE_HalContext));
 	phost->UserContext = parameters->UserContext;
 	return EVE_HalImpl_open(phost, parameters);
+#endif
+}
+
+#if EVE_TRANSPORT_OPS
+/**
+ * @brief Open the Eve_Hal framework on a specific device transport
+ * 
+ * @param phost Pointer to Hal context
+ * @param parameters Pointer to EVE_HalParameters
+ * @param device Device transport, for example g_HalTransportPlatform
+ * @return true True if ok
+ * @return false False if error
+ */
+bool EVE_Hal_openTransport(EVE_HalContext *phost, const EVE_HalParameters *parameters, EVE_HalTransport *device)
+{
+	memset(phost, 0, sizeof(EVE_HalContext));
+	phost->UserContext = parameters->UserContext;
+	device->Next = NULL;
+	phost->Transport = device;
+	return device->Ops->Open(phost, device, parameters);
 }
+#endif
 
 /**
  * @brief Close the Eve_Hal framework
@@ -130,7 +158,17 @@ void EVE_Hal_close(EVE_HalContext *phost)
 	}
 #endif
 #endif
+#if EVE_TRACE
+	EVE_Trace_stop(phost);
+#endif
+#if EVE_TRANSPORT_OPS
+	{
+		EVE_HalTransport *device = EVE_HalTransport_device(phost);
+		device->Ops->Close(phost, device);
+	}
+#else
 	EVE_HalImpl_close(phost);
+#endif
 	memset(phost, 0, sizeof(EVE_HalContext));
 }
 
@@ -141,7 +179,12 @@ void EVE_Hal_close(EVE_HalContext *phost)
  */
 void EVE_Hal_idle(EVE_HalContext *phost)
 {
+#if EVE_TRANSPORT_OPS
+	EVE_HalTransport *device = EVE_HalTransport_device(phost);
+	device->Ops->Idle(phost, device);
+#else
 	EVE_HalImpl_idle(phost);
+#endif
 }
 
 ///@}
@@ -152,6 +195,88 @@ void EVE_Hal_idle(EVE_HalContext *phost)
 
 /** @name TRANSFER HELPERS */
 ///@{
+
+#if EVE_REG_SHADOW
+/* Registers which only change when the host writes them. Sorted by address */
+static const uint32_t s_RegShadow[EVE_REG_SHADOW_COUNT] = {
+	REG_FREQUENCY,
+	REG_HCYCLE,
+	REG_HOFFSET,
+	REG_HSIZE,
+	REG_HSYNC0,
+	REG_HSYNC1,
+	REG_VCYCLE,
+	REG_VOFFSET,
+	REG_VSIZE,
+	REG_VSYNC0,
+	REG_VSYNC1,
+	REG_PCLK_POL,
+	REG_GPIO_DIR,
+	REG_DISP,
+	REG_PWM_HZ,
+	REG_PWM_DUTY,
+};
+
+/**
+ * @brief Find a register in the shadow
+ * 
+ * @param addr Register address
+ * @return int Index in the shadow, -1 if the register is not shadowed
+ */
+static inline int regShadowIndex(uint32_t addr)
+{
+	int i;
+	if ((addr < REG_FREQUENCY) || (addr > REG_PWM_DUTY))
+		return -1;
+	for (i = 0; i < EVE_REG_SHADOW_COUNT; ++i)
+	{
+		if (s_RegShadow[i] == addr)
+			return i;
+	}
+	return -1;
+}
+
+/**
+ * @brief Keep the value of a register written by the host
+ * 
+ * While a queued coprocessor command may still write the register, the
+ * value is not kept, as the command changes it afterwards.
+ * 
+ * @param phost Pointer to Hal context
+ * @param addr Register address
+ * @param value Value written
+ */
+static inline void regShadowWrite(EVE_HalContext *phost, uint32_t addr, uint32_t value)
+{
+	int shadow = regShadowIndex(addr);
+	if (shadow < 0)
+		return;
+	if (phost->RegShadowQueued & (1UL << shadow))
+	{
+		phost->RegShadowValid &= ~(1UL << shadow);
+		return;
+	}
+	phost->RegShadowValue[shadow] = value;
+	phost->RegShadowValid |= 1UL << shadow;
+}
+#else
+#define regShadowWrite(phost, addr, value) eve_noop()
+#endif
+
+/**
+ * @brief Send the recorded register writes before any other transfer, to keep them in order
+ * 
+ * A read may depend on the side effect of a recorded write, for example of
+ * REG_CMD_WRITE on REG_CMD_READ, so reads do not go ahead of them either.
+ * 
+ * @param phost Pointer to Hal context
+ */
+static inline void regBatchSync(EVE_HalContext *phost)
+{
+	if (phost->RegBatchCount)
+		EVE_Hal_regBatchFlush(phost);
+}
+
 /**
  * @brief Read 4 bytes from Coprocessor's memory
  * 
@@ -162,9 +287,27 @@ void EVE_Hal_idle(EVE_HalContext *phost)
 uint32_t EVE_Hal_rd32(EVE_HalContext *phost, uint32_t addr)
 {
 	uint32_t value;
+#if EVE_REG_SHADOW
+	int shadow = regShadowIndex(addr);
+	if ((shadow >= 0) && (phost->RegShadowValid & (1UL << shadow)))
+	{
+		++phost->Stats.RegShadowHits;
+		return phost->RegShadowValue[shadow];
+	}
+#endif
+
+	regBatchSync(phost);
 	EVE_Hal_startTransfer(phost, EVE_TRANSFER_READ, addr);
 	value = EVE_Hal_transfer32(phost, 0);
 	EVE_Hal_endTransfer(phost);
+
+#if EVE_REG_SHADOW
+	if ((shadow >= 0) && !(phost->RegShadowQueued & (1UL << shadow)) && (phost->Status != EVE_STATUS_ERROR))
+	{
+		phost->RegShadowValue[shadow] = value;
+		phost->RegShadowValid |= 1UL << shadow;
+	}
+#endif
 	return value;
 }
 
@@ -178,11 +321,60 @@ uint32_t EVE_Hal_rd32(EVE_HalContext *phost, uint32_t addr)
  */
 void EVE_Hal_rdMem(EVE_HalContext *phost, uint8_t *result, uint32_t addr, uint32_t size)
 {
+	regBatchSync(phost);
 	EVE_Hal_startTransfer(phost, EVE_TRANSFER_READ, addr);
 	EVE_Hal_transferMem(phost, result, NULL, size);
 	EVE_Hal_endTransfer(phost);
 }
 
+/**
+ * @brief Read a list of 4 bytes registers from Coprocessor's memory
+ * 
+ * Runs of consecutive addresses are read in a single burst transfer, so the
+ * number of bus round trips is the number of disjoint ranges.
+ * 
+ * @param phost Pointer to Hal context
+ * @param addrs Word aligned addresses to read
+ * @param result Buffer receiving one value per address
+ * @param count Number of addresses
+ */
+void EVE_Hal_rd32Multi(EVE_HalContext *phost, const uint32_t *addrs, uint32_t *result, uint32_t count)
+{
+	uint8_t buffer[EVE_RD32_MULTI_BURST * 4];
+	uint32_t i = 0;
+
+	while (i < count)
+	{
+		uint32_t run = 1;
+		uint32_t j;
+
+		eve_assert(!(addrs[i] & 3));
+		while (i + run < count && run < EVE_RD32_MULTI_BURST
+		    && addrs[i + run] == addrs[i] + (run << 2))
+			++run;
+
+		if (run == 1)
+		{
+			result[i] = EVE_Hal_rd32(phost, addrs[i]);
+		}
+		else
+		{
+			regBatchSync(phost);
+			EVE_Hal_startTransfer(phost, EVE_TRANSFER_READ, addrs[i]);
+			EVE_Hal_transferMem(phost, buffer, NULL, run << 2);
+			EVE_Hal_endTransfer(phost);
+			for (j = 0; j < run; ++j)
+			{
+				result[i + j] = (uint32_t)buffer[j << 2]
+				    | (uint32_t)buffer[(j << 2) + 1] << 8
+				    | (uint32_t)buffer[(j << 2) + 2] << 16
+				    | (uint32_t)buffer[(j << 2) + 3] << 24;
+			}
+		}
+		i += run;
+	}
+}
+
 /**
  * @brief Write 4 bytes to Coprocessor's memory
  * 
@@ -192,6 +384,17 @@ void EVE_Hal_rdMem(EVE_HalContext *phost, uint8_t *result, uint32_t addr, uint32
  */
 void EVE_Hal_wr32(EVE_HalContext *phost, uint32_t addr, uint32_t v)
 {
+	regShadowWrite(phost, addr, v);
+	if (phost->RegBatchDepth)
+	{
+		if (phost->RegBatchCount == EVE_REG_BATCH_MAX)
+			EVE_Hal_regBatchFlush(phost);
+		phost->RegBatchAddr[phost->RegBatchCount] = addr;
+		phost->RegBatchValue[phost->RegBatchCount] = v;
+		++phost->RegBatchCount;
+		return;
+	}
+
 	EVE_Hal_startTransfer(phost, EVE_TRANSFER_WRITE, addr);
 	EVE_Hal_transfer32(phost, v);
 	EVE_Hal_endTransfer(phost);
@@ -207,11 +410,75 @@ void EVE_Hal_wr32(EVE_HalContext *phost, uint32_t addr, uint32_t v)
  */
 void EVE_Hal_wrMem(EVE_HalContext *phost, uint32_t addr, const uint8_t *buffer, uint32_t size)
 {
+	regBatchSync(phost);
+	EVE_Hal_regShadowInvalidate(phost, addr, size);
 	EVE_Hal_startTransfer(phost, EVE_TRANSFER_WRITE, addr);
 	EVE_Hal_transferMem(phost, NULL, buffer, size);
 	EVE_Hal_endTransfer(phost);
 }
 
+/**
+ * @brief Order segments by destination address
+ * 
+ * @param a Pointer to EVE_HalMemSegment
+ * @param b Pointer to EVE_HalMemSegment
+ * @return int Comparison result for qsort
+ */
+static int compareSegments(const void *a, const void *b)
+{
+	uint32_t addrA = ((const EVE_HalMemSegment *)a)->Addr;
+	uint32_t addrB = ((const EVE_HalMemSegment *)b)->Addr;
+	return (addrA > addrB) - (addrA < addrB);
+}
+
+/**
+ * @brief Write a list of buffers to Coprocessor's memory
+ * 
+ * Segments are sorted by address, and runs of adjacent segments are written
+ * in a single transfer, so the number of address phases is the number of
+ * disjoint ranges. Platforms which queue writes submit them together.
+ * 
+ * @param phost Pointer to Hal context
+ * @param segments Segments to write, reordered by address on return
+ * @param count Number of segments
+ */
+void EVE_Hal_wrMemv(EVE_HalContext *phost, EVE_HalMemSegment *segments, uint32_t count)
+{
+	uint32_t i;
+	uint32_t end;
+
+	regBatchSync(phost);
+	for (i = 1; i < count; ++i)
+	{
+		if (segments[i].Addr < segments[i - 1].Addr)
+		{
+			qsort(segments, count, sizeof(EVE_HalMemSegment), compareSegments);
+			break;
+		}
+	}
+
+	i = 0;
+	while (i < count)
+	{
+		if (!segments[i].Size)
+		{
+			++i;
+			continue;
+		}
+
+		EVE_Hal_startTransfer(phost, EVE_TRANSFER_WRITE, segments[i].Addr);
+		do
+		{
+			EVE_Hal_regShadowInvalidate(phost, segments[i].Addr, segments[i].Size);
+			eve_assert(i + 1 >= count || segments[i + 1].Addr >= segments[i].Addr + segments[i].Size);
+			EVE_Hal_transferMem(phost, NULL, segments[i].Buffer, segments[i].Size);
+			end = segments[i].Addr + segments[i].Size;
+			++i;
+		} while (i < count && segments[i].Addr == end && !(end & 3));
+		EVE_Hal_endTransfer(phost);
+	}
+}
+
 /**
  * @brief Write a string to Coprocessor's memory
  * 
@@ -224,12 +491,336 @@ void EVE_Hal_wrMem(EVE_HalContext *phost, uint32_t addr, const uint8_t *buffer,
  */
 void EVE_Hal_wrString(EVE_HalContext *phost, uint32_t addr, const char *str, uint32_t index, uint32_t size, uint32_t padMask)
 {
+	regBatchSync(phost);
+	EVE_Hal_regShadowInvalidate(phost, addr, padMask + 1);
 	EVE_Hal_startTransfer(phost, EVE_TRANSFER_WRITE, addr);
 	EVE_Hal_transferString(phost, str, index, size, padMask);
 	EVE_Hal_endTransfer(phost);
 }
 ///@}
 
+/*******************
+** REGISTER BATCH **
+*******************/
+
+/** @name REGISTER BATCH */
+///@{
+
+/**
+ * @brief Start recording register writes
+ * 
+ * Until the matching EVE_Hal_regBatchEnd, EVE_Hal_wr32 only records the
+ * write. Any read, and any transfer other than EVE_Hal_wr32, sends the
+ * recorded writes first, so reads see their side effects. Reads served
+ * from the register shadow do not send them.
+ * 
+ * @param phost Pointer to Hal context
+ */
+void EVE_Hal_regBatchBegin(EVE_HalContext *phost)
+{
+	eve_assert(phost->RegBatchDepth < 0xFF);
+	++phost->RegBatchDepth;
+}
+
+/**
+ * @brief End recording register writes
+ * 
+ * @param phost Pointer to Hal context
+ */
+void EVE_Hal_regBatchEnd(EVE_HalContext *phost)
+{
+	eve_assert(phost->RegBatchDepth);
+	if (!--phost->RegBatchDepth)
+		EVE_Hal_regBatchFlush(phost);
+}
+
+/**
+ * @brief Send the recorded register writes
+ * 
+ * Writes are sent in the order they were recorded. A write to the address
+ * following the previous one continues the same transfer.
+ * 
+ * @param phost Pointer to Hal context
+ */
+void EVE_Hal_regBatchFlush(EVE_HalContext *phost)
+{
+	uint8_t count = phost->RegBatchCount;
+	uint8_t i = 0;
+
+	phost->RegBatchCount = 0;
+	while (i < count)
+	{
+		uint32_t addr = phost->RegBatchAddr[i];
+		EVE_Hal_startTransfer(phost, EVE_TRANSFER_WRITE, addr);
+		do
+		{
+			EVE_Hal_transfer32(phost, phost->RegBatchValue[i]);
+			addr += 4;
+			++i;
+		} while (i < count && phost->RegBatchAddr[i] == addr);
+		EVE_Hal_endTransfer(phost);
+	}
+}
+///@}
+
+#if EVE_REG_SHADOW
+/********************
+** REGISTER SHADOW **
+********************/
+
+/** @name REGISTER SHADOW */
+///@{
+
+/**
+ * @brief Forget the shadowed registers in a range
+ * 
+ * EVE_Hal_wr32 keeps the shadow up to date. Call this when the registers are
+ * changed by the host in any other way. For queued coprocessor commands, use
+ * EVE_Hal_regShadowQueue or EVE_Hal_regShadowUpdate instead.
+ * 
+ * @param phost Pointer to Hal context
+ * @param addr Start of the range
+ * @param size Size of the range
+ */
+void EVE_Hal_regShadowInvalidate(EVE_HalContext *phost, uint32_t addr, uint32_t size)
+{
+	int i;
+	if ((addr > REG_PWM_DUTY) || (addr + size <= REG_FREQUENCY))
+		return;
+	for (i = 0; i < EVE_REG_SHADOW_COUNT; ++i)
+	{
+		if ((s_RegShadow[i] >= addr) && (s_RegShadow[i] - addr < size))
+			phost->RegShadowValid &= ~(1UL << i);
+	}
+}
+
+/**
+ * @brief Forget all shadowed registers
+ * 
+ * @param phost Pointer to Hal context
+ */
+void EVE_Hal_regShadowClear(EVE_HalContext *phost)
+{
+	phost->RegShadowValid = 0;
+	phost->RegShadowQueued = 0;
+}
+
+/**
+ * @brief Forget the shadowed registers which a queued coprocessor command changes
+ * 
+ * A read which runs before the command would otherwise copy the old value
+ * again. The registers are not copied until EVE_Hal_regShadowSettle, which
+ * EVE_Cmd_waitFlush calls once the command buffer is empty.
+ * 
+ * @param phost Pointer to Hal context
+ * @param addr Start of the range
+ * @param size Size of the range
+ */
+void EVE_Hal_regShadowQueue(EVE_HalContext *phost, uint32_t addr, uint32_t size)
+{
+	int i;
+	if ((addr > REG_PWM_DUTY) || (addr + size <= REG_FREQUENCY))
+		return;
+	for (i = 0; i < EVE_REG_SHADOW_COUNT; ++i)
+	{
+		if ((s_RegShadow[i] >= addr) && (s_RegShadow[i] - addr < size))
+		{
+			phost->RegShadowValid &= ~(1UL << i);
+			phost->RegShadowQueued |= 1UL << i;
+		}
+	}
+}
+
+/**
+ * @brief Keep the value of a register written by a coprocessor command
+ * 
+ * The value is known as soon as the command is queued. Invalidating instead
+ * would let a read which runs before the command put the old value back.
+ * Until the command buffer is empty, a write by the host does not replace it,
+ * as the command changes the register afterwards.
+ * 
+ * @param phost Pointer to Hal context
+ * @param addr Register address
+ * @param value Value written
+ */
+void EVE_Hal_regShadowUpdate(EVE_HalContext *phost, uint32_t addr, uint32_t value)
+{
+	int shadow = regShadowIndex(addr);
+	if (shadow >= 0)
+	{
+		phost->RegShadowValue[shadow] = value;
+		phost->RegShadowValid |= 1UL << shadow;
+		phost->RegShadowQueued |= 1UL << shadow;
+	}
+}
+///@}
+#endif
+
+/**********
+** STATS **
+**********/
+
+/** @name STATS */
+///@{
+
+/**
+ * @brief Get the performance counters
+ * 
+ * Counters accumulate from EVE_Hal_open or the last EVE_Hal_resetStats.
+ * 
+ * @param phost Pointer to Hal context
+ * @param stats Receives a copy of the counters
+ */
+void EVE_Hal_getStats(EVE_HalContext *phost, EVE_HalStats *stats)
+{
+	*stats = phost->Stats;
+}
+
+/**
+ * @brief Reset the performance counters
+ * 
+ * @param phost Pointer to Hal context
+ */
+void EVE_Hal_resetStats(EVE_HalContext *phost)
+{
+	memset(&phost->Stats, 0, sizeof(phost->Stats));
+}
+///@}
+
+/*********
+** WAIT **
+*********/
+
+/** @name WAIT */
+///@{
+
+#ifndef EVE_WAIT_MAX_MICROS
+#define EVE_WAIT_MAX_MICROS 2000 /**< Default longest single pause */
+#endif
+#define EVE_WAIT_MIN_MICROS 10 /**< First backoff pause */
+
+/**
+ * @brief Pause without bus traffic
+ * 
+ * Sleeps for whole milliseconds, shorter pauses are spent on the host only.
+ * 
+ * @param micros Time to pause
+ */
+static void waitMicros(uint32_t micros)
+{
+	uint64_t end;
+	if (micros >= 1000)
+	{
+		EVE_sleep(micros / 1000);
+		return;
+	}
+	end = EVE_micros64() + micros;
+	while (EVE_micros64() < end)
+		;
+}
+
+/**
+ * @brief Choose how the coprocessor is waited for
+ * 
+ * The policy applies to EVE_Cmd_waitSpace, EVE_Cmd_waitFlush, EVE_Cmd_waitRead32,
+ * EVE_MediaFifo_waitSpace and EVE_MediaFifo_waitFlush. EVE_WAIT_INTERRUPT enables
+ * INT_CMDEMPTY and takes over reading REG_INT_FLAGS; on platforms without an
+ * interrupt line it behaves as EVE_WAIT_BACKOFF.
+ * 
+ * @param phost Pointer to Hal context
+ * @param policy Wait policy
+ * @param maxMicros Longest single pause in microseconds, 0 for the default
+ */
+void EVE_Hal_setWaitPolicy(EVE_HalContext *phost, EVE_WAIT_POLICY_T policy, uint32_t maxMicros)
+{
+	phost->WaitPolicy = policy;
+	phost->WaitMaxMicros = maxMicros ? maxMicros : EVE_WAIT_MAX_MICROS;
+	if (policy == EVE_WAIT_INTERRUPT)
+	{
+		EVE_Hal_wr32(phost, REG_INT_MASK, EVE_Hal_rd32(phost, REG_INT_MASK) | (1 << INT_CMDEMPTY));
+		EVE_Hal_wr32(phost, REG_INT_EN, 1);
+		EVE_Hal_rd32(phost, REG_INT_FLAGS); /* Clear */
+	}
+}
+
+/**
+ * @brief Start a wait loop
+ * 
+ * @param phost Pointer to Hal context
+ * @param wait Wait loop state
+ * @param rate Consumption rate of the FIFO, kept in the context across waits
+ * @param flush True when waiting for the command FIFO to empty
+ */
+void EVE_Hal_waitBegin(EVE_HalContext *phost, EVE_HalWait *wait, uint32_t *rate, bool flush)
+{
+	wait->Time = phost->WaitPolicy == EVE_WAIT_SPIN ? 0 : EVE_micros64();
+	wait->Pending = 0;
+	wait->Pause = EVE_WAIT_MIN_MICROS;
+	wait->Rate = rate;
+	wait->Flush = flush;
+}
+
+/**
+ * @brief Pause in a wait loop according to the wait policy
+ * 
+ * Called once per loop, after reading the FIFO state and before reading it again.
+ * 
+ * @param phost Pointer to Hal context
+ * @param wait Wait loop state
+ * @param pending Bytes still to be consumed before the wait ends
+ */
+void EVE_Hal_waitPause(EVE_HalContext *phost, EVE_HalWait *wait, uint32_t pending)
+{
+	uint32_t maxMicros = phost->WaitMaxMicros ? phost->WaitMaxMicros : EVE_WAIT_MAX_MICROS;
+	uint32_t micros;
+	uint64_t now;
+
+	switch (phost->WaitPolicy)
+	{
+	case EVE_WAIT_SPIN:
+		return;
+	case EVE_WAIT_BACKOFF:
+		waitMicros(wait->Pause);
+		wait->Pause = min(wait->Pause << 1, maxMicros);
+		return;
+	case EVE_WAIT_INTERRUPT:
+		if (wait->Flush)
+		{
+			/* Poll the line rather than the bus, flags are cleared before the FIFO is read again */
+			uint64_t end = EVE_micros64() + maxMicros;
+			while (!EVE_Hal_getInterrupt(phost) && EVE_micros64() < end)
+			{
+				waitMicros(wait->Pause);
+				wait->Pause = min(wait->Pause << 1, maxMicros);
+			}
+			EVE_Hal_rd32(phost, REG_INT_FLAGS);
+			return;
+		}
+		/* fall through */
+	case EVE_WAIT_ESTIMATE:
+		/* Update the consumption rate from the progress since the previous loop */
+		now = EVE_micros64();
+		if (wait->Pending > pending && now > wait->Time)
+		{
+			uint32_t sample = (uint32_t)min((uint64_t)(wait->Pending - pending) * 1000 / (now - wait->Time), 0xFFFFFFFFULL);
+			*wait->Rate = *wait->Rate ? ((*wait->Rate * 3) + sample) >> 2 : sample;
+		}
+		wait->Time = now;
+		wait->Pending = pending;
+		if (!*wait->Rate)
+		{
+			/* Nothing observed yet */
+			waitMicros(wait->Pause);
+			wait->Pause = min(wait->Pause << 1, maxMicros);
+			return;
+		}
+		micros = (uint32_t)min((uint64_t)pending * 1000 / *wait->Rate, (uint64_t)maxMicros);
+		waitMicros(max(micros, EVE_WAIT_MIN_MICROS));
+		return;
+	}
+}
+///@}
+
 /****************
 ** SPI command **
 ****************/
@@ -36,6 +36,9 @@
 ** INCLUDES **
 *************/
 #include "EVE_HalImpl.h"
+#include "EVE_Trace.h"
+#include "EVE_HalTransport.h"
+#include "EVE_HalDma.h"
 
 /**********************
 ** GLOBAL PROTOTYPES **
@@ -62,12 +65,71 @@ void EVE_Hal_idle(EVE_HalContext *phost);
 ///@{
 uint32_t EVE_Hal_rd32(EVE_HalContext *phost, uint32_t addr);
 void EVE_Hal_rdMem(EVE_HalContext *phost, uint8_t *result, uint32_t addr, uint32_t size);
+/** Read a list of registers, reading runs of consecutive addresses in a single burst */
+void EVE_Hal_rd32Multi(EVE_HalContext *phost, const uint32_t *addrs, uint32_t *result, uint32_t count);
 
 void EVE_Hal_wr32(EVE_HalContext *phost, uint32_t addr, uint32_t v);
 void EVE_Hal_wrMem(EVE_HalContext *phost, uint32_t addr, const uint8_t *buffer, uint32_t size);
+/** Write a list of non-overlapping segments, merging adjacent ranges into a single transfer.
+The segments are sorted by address in place */
+void EVE_Hal_wrMemv(EVE_HalContext *phost, EVE_HalMemSegment *segments, uint32_t count);
 void EVE_Hal_wrString(EVE_HalContext *phost, uint32_t addr, const char *str, uint32_t index, uint32_t size, uint32_t padMask);
 ///@}
 
+/** @name REGISTER BATCH */
+///@{
+/** Start recording EVE_Hal_wr32 calls instead of sending them. Scopes nest */
+void EVE_Hal_regBatchBegin(EVE_HalContext *phost);
+/** End the scope. The outermost scope sends the recorded writes */
+void EVE_Hal_regBatchEnd(EVE_HalContext *phost);
+/** Send the recorded writes in order, merging runs of consecutive addresses into a single transfer */
+void EVE_Hal_regBatchFlush(EVE_HalContext *phost);
+///@}
+
+/** @name REGISTER SHADOW */
+///@{
+#if EVE_REG_SHADOW
+/** Forget the shadowed registers in the range, when they are changed other than by EVE_Hal_wr32 */
+void EVE_Hal_regShadowInvalidate(EVE_HalContext *phost, uint32_t addr, uint32_t size);
+/** Forget all shadowed registers, when the device is reset */
+void EVE_Hal_regShadowClear(EVE_HalContext *phost);
+/** Keep the value of a register written by a coprocessor command */
+void EVE_Hal_regShadowUpdate(EVE_HalContext *phost, uint32_t addr, uint32_t value);
+/** Forget the shadowed registers in the range, and do not copy them again until the command buffer is empty,
+when a queued coprocessor command changes them with a value which is not known */
+void EVE_Hal_regShadowQueue(EVE_HalContext *phost, uint32_t addr, uint32_t size);
+/** Copy the registers again, once the command buffer is empty and the queued commands are done */
+static inline void EVE_Hal_regShadowSettle(EVE_HalContext *phost)
+{
+	phost->RegShadowQueued = 0;
+}
+#else
+#define EVE_Hal_regShadowInvalidate(phost, addr, size) ((void)0)
+#define EVE_Hal_regShadowUpdate(phost, addr, value) ((void)0)
+#define EVE_Hal_regShadowQueue(phost, addr, size) ((void)0)
+#define EVE_Hal_regShadowSettle(phost) ((void)0)
+#define EVE_Hal_regShadowClear(phost) ((void)0)
+#endif
+///@}
+
+/** @name STATS */
+///@{
+/** Copy the performance counters accumulated since open or the last reset */
+void EVE_Hal_getStats(EVE_HalContext *phost, EVE_HalStats *stats);
+/** Reset the performance counters, for example at the start of each frame */
+void EVE_Hal_resetStats(EVE_HalContext *phost);
+///@}
+
+/** @name WAIT */
+///@{
+/** Choose how the coprocessor is waited for. `maxMicros` caps a single pause, 0 for the default */
+void EVE_Hal_setWaitPolicy(EVE_HalContext *phost, EVE_WAIT_POLICY_T policy, uint32_t maxMicros);
+/** Start a wait loop on the command FIFO (`rate` is &phost->CmdRate) or the media FIFO */
+void EVE_Hal_waitBegin(EVE_HalContext *phost, EVE_HalWait *wait, uint32_t *rate, bool flush);
+/** Pause in a wait loop according to the wait policy, `pending` is the number of bytes still to be consumed */
+void EVE_Hal_waitPause(EVE_HalContext *phost, EVE_HalWait *wait, uint32_t pending);
+///@}
+
 /** @name SPI command */
 ///@{
 void EVE_Hal_SPICmd_pwr_state(EVE_HalContext *phost, EVE_PWR_STATE_T state);
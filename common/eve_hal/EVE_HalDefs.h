@@ -49,6 +49,13 @@
 ***********/
 
 #define RAM_REPORT_MAX 128
+#define EVE_CMD_RESERVE_MAX 2048 /**< Largest EVE_Cmd_reserve, in bytes */
+#define EVE_REG_BATCH_MAX 32 /**< Register writes recorded by EVE_Hal_regBatchBegin before they are sent */
+#define EVE_CMDLIST_CACHE_MAX 16 /**< Command lists kept in RAM_G by EVE_CmdList_call */
+#define EVE_REG_SHADOW_COUNT 16 /**< Registers kept in the shadow with EVE_REG_SHADOW */
+#ifndef EVE_SPI_WRBUF_SIZE
+#define EVE_SPI_WRBUF_SIZE 65536 /**< Size of SpiWrBuf, on platforms which buffer writes */
+#endif
 
 /*************
 ** TYPEDEFS **
@@ -81,8 +88,10 @@ typedef enum EVE_HOST_T
 	EVE_HOST_UNKNOWN = 0, /**< 0 */
 	EVE_HOST_FT4222, /**< 1 */
 	EVE_HOST_MPSSE, /**< 2 */
+	EVE_HOST_LINUX_SPIDEV, /**< 3 */
+	EVE_HOST_SIM, /**< 4 */
 
-	EVE_HOST_NB /**< 3 */
+	EVE_HOST_NB /**< 5 */
 } EVE_HOST_T;
 
 typedef enum EVE_PWR_STATE_T
@@ -151,6 +160,8 @@ typedef bool (*EVE_Callback)(EVE_HalContext *phost);
 typedef int (*EVE_CoCmdHook)(EVE_HalContext *phost, uint32_t cmd, uint32_t state);
 /** Hook into coprocessor reset */
 typedef void (*EVE_ResetCallback)(EVE_HalContext *phost, bool fault);
+/** Write one packet of buffered data to the device, see EVE_AsyncWrite_start */
+typedef bool (*EVE_AsyncWriteFunc)(EVE_HalContext *phost, uint32_t addr, uint8_t *buffer, uint32_t size);
 
 typedef struct EVE_DeviceInfo
 {
@@ -161,6 +172,96 @@ typedef struct EVE_DeviceInfo
 
 } EVE_DeviceInfo;
 
+/** One destination range of a scatter-gather write, see EVE_Hal_wrMemv */
+typedef struct EVE_HalMemSegment
+{
+	uint32_t Addr; /**< Destination address, 4 byte aligned */
+	const uint8_t *Buffer;
+	uint32_t Size; /**< Number of bytes, multiple of 4 */
+} EVE_HalMemSegment;
+
+/** Result of a coprocessor command which is read later, see EVE_Cmd_query and EVE_Cmd_resolve */
+typedef struct EVE_CmdQuery
+{
+	uint32_t Offset; /**< Position of the result in RAM_CMD */
+	uint32_t Gen; /**< Command bytes written before the result, see CmdWritten */
+	uint32_t Size; /**< Size of the result in bytes */
+	uint32_t *Result; /**< Written with Size / 4 words by EVE_Cmd_resolve */
+} EVE_CmdQuery;
+
+/** Command list uploaded into RAM_G, see EVE_CmdList_call */
+typedef struct EVE_CmdListEntry
+{
+	const uint8_t *Buffer; /**< Host buffer of the recorded commands, compared when the hash matches */
+	uint32_t Hash; /**< Hash of the recorded commands */
+	uint32_t Size; /**< Size of the recorded commands in bytes */
+	uint32_t Addr; /**< Address of the list in RAM_G */
+	uint32_t LastUse; /**< Value of CmdListClock at the last call */
+} EVE_CmdListEntry;
+
+/** How the host waits for the coprocessor, see EVE_Hal_setWaitPolicy */
+typedef enum EVE_WAIT_POLICY_T
+{
+	EVE_WAIT_SPIN = 0, /**< 0, read the registers continuously */
+	EVE_WAIT_BACKOFF, /**< 1, pause between reads, doubling up to WaitMaxMicros */
+	EVE_WAIT_ESTIMATE, /**< 2, sleep for the time the coprocessor is estimated to need, from its observed consumption rate */
+	EVE_WAIT_INTERRUPT, /**< 3, wait for INT_N with INT_CMDEMPTY when flushing, otherwise as EVE_WAIT_ESTIMATE */
+} EVE_WAIT_POLICY_T;
+
+/** State of a single wait loop, see EVE_Hal_waitPause */
+typedef struct EVE_HalWait
+{
+	uint64_t Time; /**< Time of the previous sample */
+	uint32_t Pending; /**< Bytes pending at the previous sample */
+	uint32_t Pause; /**< Current backoff pause, in microseconds */
+	uint32_t *Rate; /**< Consumption rate of the FIFO being waited on, in bytes per millisecond */
+	bool Flush; /**< Waiting for the command FIFO to empty */
+} EVE_HalWait;
+
+/** Performance counters of a HAL context, see EVE_Hal_getStats */
+typedef struct EVE_HalStats
+{
+	/** @name Bus traffic */
+	///@{
+	uint64_t BytesWritten;
+	uint64_t BytesRead;
+	uint32_t Transfers; /**< startTransfer and endTransfer pairs */
+	uint32_t Flushes; /**< Submissions of buffered or queued data to the bus, on platforms which batch transfers */
+	uint32_t RegShadowHits; /**< EVE_Hal_rd32 calls served from the register shadow, with EVE_REG_SHADOW */
+	uint32_t CmdWpPublishes; /**< Writes of REG_CMD_WRITE for commands written directly into RAM_CMD, see EVE_Cmd_setRing */
+	///@}
+
+	/** @name Coprocessor back-pressure, time in microseconds spent blocked */
+	///@{
+	uint32_t CmdWaitSpaceCalls;
+	uint32_t CmdWaitSpaceLoops;
+	uint64_t CmdWaitSpaceMicros;
+	uint32_t CmdWaitFlushCalls;
+	uint32_t CmdWaitFlushLoops;
+	uint64_t CmdWaitFlushMicros;
+	uint32_t CmdSpaceReads; /**< Reads of REG_CMDB_SPACE */
+	uint32_t CmdSpaceReadsAvoided; /**< Command writes which went ahead on the cached free space */
+	uint32_t MediaFifoWaitCalls;
+	uint32_t MediaFifoWaitLoops;
+	uint64_t MediaFifoWaitMicros; /**< Includes the time of the nested command FIFO waits */
+	///@}
+
+	/** @name Frame staging, see EVE_Cmd_stageBegin */
+	///@{
+	uint32_t CmdStageFrames; /**< Frames sent by EVE_Cmd_stageSubmit */
+	uint32_t CmdStageLastBytes; /**< Command bytes of the last staged frame */
+	uint32_t CmdStagePeakBytes; /**< Command bytes of the largest staged frame */
+	///@}
+
+	/** @name Command lists, see EVE_CmdList_call */
+	///@{
+	uint32_t CmdListCalls;
+	uint32_t CmdListUploads; /**< Lists written into RAM_G with CMD_NEWLIST */
+	uint32_t CmdListUploadBytes;
+	uint32_t CmdListEvictions; /**< Lists dropped from RAM_G to make room for others */
+	///@}
+} EVE_HalStats;
+
 /** Hal parameters */
 typedef struct EVE_HalParameters
 {
@@ -192,6 +293,21 @@ typedef struct EVE_HalParameters
 	uint8_t PowerDownPin; /**< BT8XX power down pin number */
 #endif
 
+#if defined(LINUX_SPIDEV_PLATFORM)
+	char SpiDevice[64]; /**< spidev device node, for example /dev/spidev0.0 */
+	char GpioDevice[64]; /**< GPIO character device carrying the PD_N and INT lines */
+	uint8_t PowerDownPin; /**< BT8XX power down line offset, EVE_SPIDEV_PIN_NONE if not connected */
+	uint8_t InterruptPin; /**< BT8XX INT_N line offset, EVE_SPIDEV_PIN_NONE if not connected */
+	uint32_t SpiClockrateKHz; /**< In kHz */
+#endif
+
+#if defined(SIM_PLATFORM)
+	uint32_t SimRamGSize; /**< Bytes of RAM_G modelled in host memory */
+	uint32_t SimCmdRateKBps; /**< Command FIFO drain rate in kB/s, 0 to drain instantly */
+	uint32_t SimMediaFifoRateKBps; /**< Media FIFO drain rate in kB/s, 0 to drain instantly */
+	uint32_t SimSpiClockMaxKHz; /**< Highest SPI clock with reliable reads, 0 for no limit. Reads are corrupted above it */
+#endif
+
 } EVE_HalParameters;
 
 typedef struct EVE_HalContext
@@ -221,6 +337,9 @@ typedef struct EVE_HalContext
 
 #if defined(MPSSE_PLATFORM)
 	uint32_t MpsseChannelNo; /**< MPSSE channel number */
+	bool SpiRdReady; /**< Ready byte received in the ongoing read transaction */
+	uint8_t SpiRdCarrySize;
+	uint8_t SpiRdCarry[EVE_MPSSE_READ_CARRY]; /**< Data received ahead of the caller in the ongoing read transaction */
 #endif
 #if defined(FT4222_PLATFORM)
 	uint8_t SpiCsPin; /**< SPI chip select number of BT8XX chip */
@@ -232,24 +351,171 @@ typedef struct EVE_HalContext
 	uint8_t SpiMosiPin;
 	uint8_t SpiMisoPin;
 	uint8_t PowerDownPin; /**< BT8XX power down pin number */
+	uint32_t SpiClockrateKHz; /**< Currently configured SPI clock rate. In kHz */
+#if EVE_DMA_WRITES
+	int SpiDmaChannel; /**< DMA channel feeding the SPI port */
+#endif
+#endif
+#if defined(LINUX_SPIDEV_PLATFORM)
+	int SpiFd; /**< spidev file descriptor */
+	int PowerDownFd; /**< GPIO line handle for PD_N, -1 if not connected */
+	int InterruptFd; /**< GPIO line handle for INT_N, -1 if not connected */
+	uint32_t SpiClockrateKHz; /**< Currently configured SPI clock rate. In kHz */
+	uint32_t SpiModeCaps; /**< Multi-line mode bits accepted by the kernel driver */
+	uint32_t SpiBufSize; /**< Maximum bytes carried by one SPI_IOC_MESSAGE */
+	struct spi_ioc_transfer SpiXfer[EVE_SPIDEV_SEGMENTS_MAX]; /**< Segments queued for the next SPI_IOC_MESSAGE */
+	uint32_t SpiXferCount;
+	uint32_t SpiXferBytes; /**< Total length of the queued segments */
+	bool SpiWrOpen; /**< Last queued segment is a write that may still be extended */
+	uint8_t SpiRdBuf[EVE_SPIDEV_POLLING_BYTES + EVE_SPIDEV_DATA_LENGTH];
+#endif
+#if defined(SIM_PLATFORM)
+	uint8_t *SimRamG;
+	uint32_t SimRamGSize;
+	uint8_t SimCore[EVE_SIM_CORE_SIZE]; /**< RAM_CMD, registers, RAM_REPORT and RAM_DL */
+	uint8_t SimPeriph[EVE_SIM_PERIPH_SIZE]; /**< REG_SYS and neighbouring register blocks */
+	uint32_t SimAddr; /**< Address of the ongoing transfer */
+	uint32_t SimCmdRateKBps;
+	uint32_t SimMediaFifoRateKBps;
+	uint32_t SpiClockrateKHz; /**< Modelled SPI clock rate, only compared against SimSpiClockMaxKHz. In kHz */
+	uint32_t SimSpiClockMaxKHz;
+	uint64_t SimCmdCredit; /**< Command FIFO bytes the model may still consume, in 1/1000 bytes */
+	uint64_t SimMediaFifoCredit; /**< Media FIFO bytes the model may still consume, in 1/1000 bytes */
+	uint64_t SimMicros; /**< Time of the last model update */
+	uint64_t SimBootMicros; /**< Time of the last power cycle, base of REG_CLOCK and REG_FRAMES */
+	uint32_t SimMediaFifoBase;
+	uint32_t SimMediaFifoSize;
+	uint32_t SimPayloadAddr; /**< Destination of the CMD_MEMWRITE data being consumed */
+	uint32_t SimPayloadRemaining; /**< Padded bytes of CMD_MEMWRITE data left in the command FIFO */
+	uint32_t SimPayloadStore; /**< Bytes of CMD_MEMWRITE data left to store */
+	uint8_t SimCmdTail; /**< String or data of unknown length being consumed after the fixed words of a command */
+
+	/** @name Device model throughput counters, never reset by the model */
+	///@{
+	uint64_t SimCmdBytesIn; /**< Bytes written to REG_CMDB_WRITE */
+	uint64_t SimCmdBytesDone; /**< Bytes consumed from the command FIFO */
+	uint32_t SimCmdPolls; /**< Reads of REG_CMD_READ, REG_CMDB_SPACE and REG_MEDIAFIFO_READ */
+	uint32_t SimCmdOverflows; /**< REG_CMDB_WRITE writes dropped on a full FIFO */
+	uint32_t SimSwaps; /**< CMD_SWAP commands and REG_DLSWAP writes */
+	///@}
 #endif
 
 	/** @name Write buffer to optimize writes into larger batches */
 	///@{
-#if defined(EVE_BUFFER_WRITES) || defined(FT4222_PLATFORM)
-	uint8_t SpiWrBuf[65536];
+#if defined(EVE_BUFFER_WRITES) || defined(FT4222_PLATFORM) || defined(LINUX_SPIDEV_PLATFORM) || EVE_DMA_WRITES
+	uint8_t SpiWrBuf[EVE_SPI_WRBUF_SIZE];
 	uint32_t SpiWrBufIndex;
 	uint32_t SpiRamGAddr; /**< Current RAM_G address of ongoing SPI write transaction */
+#endif
+#if EVE_ASYNC_WRITES || EVE_DMA_WRITES
+	uint8_t SpiWrHalf; /**< Half of SpiWrBuf being filled, the other half may be written in the background */
+#endif
+#if EVE_DMA_WRITES
+	struct EVE_HalDma *Dma; /**< Engine sending the packets of SpiWrBuf, see EVE_HalDma.h */
 #endif
 	///@}
 
+#if EVE_ASYNC_WRITES
+	/** @name Background write worker, see EVE_AsyncWrite_start */
+	///@{
+	void *AsyncWrThread;
+	void *AsyncWrStart; /**< Signalled when a packet is handed to the worker */
+	void *AsyncWrDone; /**< Signalled by the worker when the packet is written */
+	EVE_AsyncWriteFunc AsyncWrFunc;
+	uint32_t AsyncWrAddr;
+	uint8_t *AsyncWrBuffer;
+	uint32_t AsyncWrSize;
+	bool AsyncWrPending; /**< A packet is owned by the worker */
+	bool AsyncWrFailed; /**< A background write failed since the last wait */
+	bool AsyncWrQuit;
+	///@}
+#endif
+
 	/** @name Buffer cmd smaller than a full cmd command */
 	///@{
 	uint8_t CmdBuffer[4];
 	uint8_t CmdBufferIndex;
 	uint32_t CmdSpace; /**< Free space, cached value */
+	uint32_t CmdWritten; /**< Command bytes written since opening, wraps around, see EVE_Cmd_query */
+	uint32_t CmdSpaceLow; /**< Refresh the free space once it falls below, 0 for the default, see EVE_Cmd_setSpaceWatermarks */
+	uint32_t CmdSpaceHigh; /**< Free space to wait for when blocked, 0 for the default */
+	bool CmdSpaceRefresh; /**< Free space fell below the low watermark, refresh at the next transfer */
 	///@}
 
+	/** @name Space handed out by EVE_Cmd_reserve */
+	///@{
+	uint8_t *CmdReservePtr; /**< Reserved space, in the transport write buffer or in CmdReserveBuf */
+	uint32_t CmdReserved; /**< Bytes reserved, 0 when no reservation is pending */
+	uint8_t CmdReserveBuf[EVE_CMD_RESERVE_MAX]; /**< Staging for transports without a write buffer */
+	uint8_t *CmdFastPtr; /**< Next word in the space reserved by EVE_Cmd_startFuncReserve */
+	uint8_t *CmdFastEnd; /**< End of the space reserved by EVE_Cmd_startFuncReserve, NULL when none */
+	uint32_t CmdFastSize; /**< Size of the space reserved by EVE_Cmd_startFuncReserve */
+	///@}
+
+	/** @name Commands collected since EVE_Cmd_stageBegin */
+	///@{
+	uint8_t *CmdStage; /**< Host buffer, NULL when not staging */
+	uint32_t CmdStageSize; /**< Capacity of the host buffer */
+	uint32_t CmdStageUsed; /**< Bytes collected and not written yet */
+	uint32_t CmdStageFrame; /**< Bytes of commands since EVE_Cmd_stageBegin */
+	bool CmdRecord; /**< The host buffer records an EVE_CmdList, and is never written */
+	bool CmdRecordFull; /**< The recording did not fit the host buffer */
+	///@}
+
+	/** @name Command lists kept in RAM_G, see EVE_CmdList_setBudget */
+	///@{
+	uint32_t CmdListAddr; /**< Start of the area in RAM_G */
+	uint32_t CmdListBudget; /**< Size of the area in RAM_G, 0 to replay lists from the host */
+	uint32_t CmdListClock; /**< Counts the calls, for least recently used eviction */
+	EVE_CmdListEntry CmdListEntries[EVE_CMDLIST_CACHE_MAX];
+	uint8_t CmdListCount;
+	///@}
+
+	/** @name Direct RAM_CMD writes, see EVE_Cmd_setRing */
+	///@{
+	bool CmdRing; /**< Commands are written into RAM_CMD instead of REG_CMDB_WRITE */
+	uint32_t CmdWp; /**< Offset in RAM_CMD of the next command */
+	uint32_t CmdWpPublished; /**< Last value written to REG_CMD_WRITE */
+	///@}
+
+	/** @name Sequence fences, see EVE_Cmd_fence */
+	///@{
+	uint32_t CmdFenceAddr; /**< Slot in RAM_G written by the fences, 0 when not set */
+	uint32_t CmdFenceSeq; /**< Last sequence number issued */
+	uint32_t CmdFenceDone; /**< Last sequence number seen in the slot */
+	uint32_t CmdFenceDropped; /**< Last sequence number dropped by a coprocessor reset */
+	bool CmdFenceReady; /**< The slot is initialized */
+	///@}
+
+#if EVE_CMD_PROFILE
+	/** @name Command stream profiler, see EVE_CmdProfile_begin */
+	///@{
+	struct EVE_CmdProfile *CmdProfile; /**< Tallies of the written commands, NULL when not profiling */
+	uint32_t CmdProfWord; /**< First word of the command being written */
+	uint32_t CmdProfBytes; /**< Command bytes written or staged when the command started */
+	uint64_t CmdProfMicros; /**< Blocked time when the command started, see CmdWaitSpaceMicros */
+	bool CmdProfOpen; /**< A command is being written */
+	bool CmdProfKeyed; /**< CmdProfWord is known */
+	///@}
+#endif
+
+	/** @name Register writes recorded since EVE_Hal_regBatchBegin */
+	///@{
+	uint32_t RegBatchAddr[EVE_REG_BATCH_MAX];
+	uint32_t RegBatchValue[EVE_REG_BATCH_MAX];
+	uint8_t RegBatchCount; /**< Writes recorded and not sent yet */
+	uint8_t RegBatchDepth; /**< Nesting of EVE_Hal_regBatchBegin */
+	///@}
+
+#if EVE_REG_SHADOW
+	/** @name Copy of the registers which only the host changes */
+	///@{
+	uint32_t RegShadowValue[EVE_REG_SHADOW_COUNT];
+	uint32_t RegShadowValid; /**< One bit per register, set when the value is known */
+	uint32_t RegShadowQueued; /**< One bit per register, set while a queued coprocessor command may write it */
+	///@}
+
+#endif
 	/** @name Media FIFO state */
 	///@{
 #if defined(EVE_SUPPORT_MEDIAFIFO)
@@ -278,6 +544,26 @@ typedef struct EVE_HalContext
 
 	uint32_t DDR_RamSize; /**< DDR RAM SIZE from REG_RAM_SIZE For BT82X */
 
+	EVE_HalStats Stats; /**< Performance counters, see EVE_Hal_getStats */
+
+	/** @name Wait policy, see EVE_Hal_setWaitPolicy */
+	///@{
+	EVE_WAIT_POLICY_T WaitPolicy;
+	uint32_t WaitMaxMicros; /**< Longest single pause */
+	uint32_t CmdRate; /**< Observed command FIFO consumption, in bytes per millisecond */
+	uint32_t CmdRateRp; /**< REG_CMD_READ at the previous sample of EVE_Cmd_spaceMicros */
+	uint64_t CmdRateTime; /**< Time of the previous sample of EVE_Cmd_spaceMicros, 0 when the space was free */
+	uint32_t MediaFifoRate; /**< Observed media FIFO consumption, in bytes per millisecond */
+	///@}
+
+#if EVE_TRANSPORT_OPS
+	struct EVE_HalTransport *Transport; /**< Top of the transport stack, see EVE_HalTransport.h */
+#endif
+
+#if EVE_TRACE
+	struct EVE_TraceRecorder *Trace; /**< Active bus trace recording, see EVE_Trace.h */
+#endif
+
 } EVE_HalContext;
 
 typedef struct EVE_HalPlatform
@@ -0,0 +1,282 @@
+/**
+ * @file EVE_HalDma.c
+ * @brief Double buffered write packets, sent by a DMA engine
+ *
+ * @author Bridgetek
+ *
+ * @date 2025
+ *
+ * MIT License
+ *
+ * Copyright (c) [2025] [Bridgetek Pte Ltd (BRTChip)]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "EVE_Hal.h"
+#if EVE_DMA_WRITES
+
+#define DMA_HEADER_SIZE 4
+/* Each half of SpiWrBuf holds one packet, header included */
+#define DMA_PACKET_SIZE (sizeof(((EVE_HalContext *)0)->SpiWrBuf) / 2)
+#define DMA_DATA_MAX ((DMA_PACKET_SIZE - DMA_HEADER_SIZE) & ~3UL)
+#define DMA_PACKET(phost) (&(phost)->SpiWrBuf[(phost)->SpiWrHalf * DMA_PACKET_SIZE])
+
+/*************
+** PACKETS **
+*************/
+
+/**
+ * @brief Increase RAM_G adress
+ *
+ * @param addr Address offset
+ * @param inc Number of bytes to increase
+ * @return uint32_t New address in RAM_G
+ */
+static inline uint32_t incrementRamGAddr(uint32_t addr, uint32_t inc)
+{
+	if (addr != REG_CMDB_WRITE)
+	{
+		bool wrapCmdAddr = (addr >= RAM_CMD) && (addr < (RAM_CMD + EVE_CMD_FIFO_SIZE));
+		addr += inc;
+		if (wrapCmdAddr)
+			addr = RAM_CMD + (addr & EVE_CMD_FIFO_MASK);
+	}
+	return addr;
+}
+
+/**
+ * @brief Attach the DMA engine, and reset the write buffer
+ *
+ * @param phost Pointer to Hal context
+ * @param dma DMA engine
+ */
+void EVE_HalDma_attach(EVE_HalContext *phost, EVE_HalDma *dma)
+{
+	dma->Pending = false;
+	phost->Dma = dma;
+	phost->SpiWrHalf = 0;
+	phost->SpiWrBufIndex = 0;
+	phost->SpiRamGAddr = 0;
+}
+
+/**
+ * @brief Start a write transfer
+ *
+ * @param phost Pointer to Hal context
+ * @param addr Address to write
+ */
+void EVE_HalDma_startWrite(EVE_HalContext *phost, uint32_t addr)
+{
+	if (addr != incrementRamGAddr(phost->SpiRamGAddr, phost->SpiWrBufIndex))
+	{
+		/* Close any write transfer that was left open, if the address changed */
+		EVE_HalDma_flush(phost);
+		phost->SpiRamGAddr = addr;
+	}
+}
+
+/**
+ * @brief End a write transfer
+ *
+ * @param phost Pointer to Hal context
+ */
+void EVE_HalDma_endWrite(EVE_HalContext *phost)
+{
+	/* Transfers to FIFO and DL are kept open */
+	uint32_t addr = phost->SpiRamGAddr;
+	if ((addr != REG_CMDB_WRITE)
+	    && !((addr >= RAM_CMD) && (addr < (RAM_CMD + EVE_CMD_FIFO_SIZE)))
+	    && !((addr >= RAM_DL) && (addr < (RAM_DL + EVE_DL_SIZE))))
+	{
+		EVE_HalDma_flush(phost);
+	}
+}
+
+/**
+ * @brief Write a block of data
+ *
+ * @param phost Pointer to Hal context
+ * @param buffer Data buffer to write
+ * @param size Size of buffer
+ * @return true True if ok
+ * @return false False if error
+ */
+bool EVE_HalDma_write(EVE_HalContext *phost, const uint8_t *buffer, uint32_t size)
+{
+	while (size)
+	{
+		uint32_t part = min(DMA_DATA_MAX - phost->SpiWrBufIndex, size);
+		if (!part)
+		{
+			/* Packet is full */
+			if (!EVE_HalDma_flush(phost))
+				return false;
+			continue;
+		}
+		memcpy(&DMA_PACKET(phost)[DMA_HEADER_SIZE + phost->SpiWrBufIndex], buffer, part);
+		phost->SpiWrBufIndex += part;
+		buffer += part;
+		size -= part;
+	}
+	return true;
+}
+
+/**
+ * @brief Reserve space in the packet being filled
+ *
+ * @param phost Pointer to Hal context
+ * @param size Number of bytes to reserve
+ * @return uint8_t* Pointer into the packet, NULL if not available
+ */
+uint8_t *EVE_HalDma_reserve(EVE_HalContext *phost, uint32_t size)
+{
+	if (size > DMA_DATA_MAX)
+		return NULL;
+	if ((phost->SpiWrBufIndex + size > DMA_DATA_MAX) && !EVE_HalDma_flush(phost))
+		return NULL;
+	return &DMA_PACKET(phost)[DMA_HEADER_SIZE + phost->SpiWrBufIndex];
+}
+
+/**
+ * @brief Commit data written into space obtained from EVE_HalDma_reserve
+ *
+ * @param phost Pointer to Hal context
+ * @param size Number of bytes written
+ */
+void EVE_HalDma_commit(EVE_HalContext *phost, uint32_t size)
+{
+	eve_assert(phost->SpiWrBufIndex + size <= DMA_DATA_MAX);
+	phost->SpiWrBufIndex += size;
+}
+
+/**
+ * @brief Send the packet being filled, and continue filling the other half
+ *
+ * Waits for the previous packet, which owns the other half, but not for this one
+ *
+ * @param phost Pointer to Hal context
+ * @return true True if ok
+ * @return false False if error
+ */
+bool EVE_HalDma_flush(EVE_HalContext *phost)
+{
+	EVE_HalDma *dma = phost->Dma;
+	uint8_t *packet = DMA_PACKET(phost);
+	uint32_t addr = phost->SpiRamGAddr;
+	uint32_t size = phost->SpiWrBufIndex;
+
+	if (!size)
+		return true;
+
+	++phost->Stats.Flushes;
+	phost->SpiWrBufIndex = 0;
+	phost->SpiRamGAddr = incrementRamGAddr(addr, size);
+	if (!EVE_HalDma_wait(phost))
+		return false;
+
+	/* Compose the HOST MEMORY WRITE packet */
+	packet[0] = (addr >> 24) | 0x80; /* MSB bits 10 for WRITE */
+	packet[1] = (addr >> 16) & 0xFF;
+	packet[2] = (addr >> 8) & 0xFF;
+	packet[3] = addr & 0xFF;
+
+	if (!dma->Start(dma, packet, size + DMA_HEADER_SIZE))
+	{
+		eve_printf_debug("DMA start failed\n");
+		phost->Status = EVE_STATUS_ERROR;
+		return false;
+	}
+	dma->Pending = true;
+	phost->SpiWrHalf ^= 1;
+	return true;
+}
+
+/**
+ * @brief Wait for the packet in flight
+ *
+ * @param phost Pointer to Hal context
+ * @return true True if ok
+ * @return false False if the packet was not sent
+ */
+bool EVE_HalDma_wait(EVE_HalContext *phost)
+{
+	EVE_HalDma *dma = phost->Dma;
+	if (!dma->Pending)
+		return true;
+
+	dma->Pending = false;
+	if (!dma->Wait(dma))
+	{
+		eve_printf_debug("DMA write failed\n");
+		phost->Status = EVE_STATUS_ERROR;
+		return false;
+	}
+	return true;
+}
+
+/**********
+** MOCK **
+**********/
+
+static bool mockStart(EVE_HalDma *dma, const uint8_t *packet, uint32_t size)
+{
+	EVE_HalDmaMock *mock = dma->UserContext;
+	uint32_t addr;
+
+	eve_assert(size > DMA_HEADER_SIZE);
+	eve_assert(packet[0] & 0x80);
+	addr = ((uint32_t)(packet[0] & 0x7F) << 24)
+	    | ((uint32_t)packet[1] << 16)
+	    | ((uint32_t)packet[2] << 8)
+	    | (uint32_t)packet[3];
+
+	++mock->Packets;
+	mock->Result = mock->Sink(mock->SinkContext, addr, packet + DMA_HEADER_SIZE, size - DMA_HEADER_SIZE);
+	return true;
+}
+
+static bool mockWait(EVE_HalDma *dma)
+{
+	EVE_HalDmaMock *mock = dma->UserContext;
+	return mock->Result;
+}
+
+/**
+ * @brief Initialize the synchronous mock engine
+ *
+ * @param mock Mock engine
+ * @param sink Called with each packet when it is started
+ * @param sinkContext Passed to the sink
+ * @return EVE_HalDma* Engine to attach
+ */
+EVE_HalDma *EVE_HalDma_initMock(EVE_HalDmaMock *mock, EVE_HalDmaSinkFunc sink, void *sinkContext)
+{
+	memset(mock, 0, sizeof(EVE_HalDmaMock));
+	mock->Dma.Start = mockStart;
+	mock->Dma.Wait = mockWait;
+	mock->Dma.UserContext = mock;
+	mock->Sink = sink;
+	mock->SinkContext = sinkContext;
+	return &mock->Dma;
+}
+
+#endif /* EVE_DMA_WRITES */
+
+/* end of file */
@@ -0,0 +1,112 @@
+/**
+ * @file EVE_HalDma.h
+ * @brief Double buffered write packets, sent by a DMA engine
+ *
+ * @author Bridgetek
+ *
+ * @date 2025
+ *
+ * MIT License
+ *
+ * Copyright (c) [2025] [Bridgetek Pte Ltd (BRTChip)]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef EVE_HAL_DMA__H
+#define EVE_HAL_DMA__H
+
+#include "EVE_HalImpl.h"
+
+#if EVE_DMA_WRITES
+
+/*
+With EVE_DMA_WRITES, the transport collects writes into packets in the two
+halves of SpiWrBuf. Each packet starts with the 4-byte HOST MEMORY WRITE
+header, followed by the data, so it is sent by the engine in a single run
+with the chip selected. While one half is in flight, the other half is being
+filled, which lets the caller read the next file block into the packet with
+EVE_Hal_transferReserve while the previous one is being sent.
+
+The packetizing below is platform independent. The platform provides the
+engine, and calls these functions from its transport. The SIM transport,
+built with EVE_DMA_WRITES, sends all its writes through the packets, and
+attaches the synchronous mock engine to hand them to the device model, so
+the packetizing runs under the applications and tools on the host.
+*/
+
+typedef struct EVE_HalDma EVE_HalDma;
+
+/** DMA engine sending write packets to the SPI bus */
+struct EVE_HalDma
+{
+	/** Select the chip and start sending the packet. The packet stays untouched until Wait returns */
+	bool (*Start)(EVE_HalDma *dma, const uint8_t *packet, uint32_t size);
+	/** Wait until the packet is sent, and deselect the chip. Returns false if the transfer failed */
+	bool (*Wait)(EVE_HalDma *dma);
+	void *UserContext;
+	bool Pending; /**< A packet is owned by the engine */
+};
+
+/** @name PACKETS
+Called by the platform transport, with the Dma engine attached to the context */
+///@{
+/* Attach the engine, and reset the write buffer */
+void EVE_HalDma_attach(EVE_HalContext *phost, EVE_HalDma *dma);
+/* Continue the packet being filled if addr follows it, or start a new one */
+void EVE_HalDma_startWrite(EVE_HalContext *phost, uint32_t addr);
+/* Send the packet, unless writing to the command FIFO or display list */
+void EVE_HalDma_endWrite(EVE_HalContext *phost);
+/* Append data, sending full packets */
+bool EVE_HalDma_write(EVE_HalContext *phost, const uint8_t *buffer, uint32_t size);
+/* Space for size bytes in the packet being filled, NULL if size does not fit a packet */
+uint8_t *EVE_HalDma_reserve(EVE_HalContext *phost, uint32_t size);
+/* Append size bytes written into space from EVE_HalDma_reserve */
+void EVE_HalDma_commit(EVE_HalContext *phost, uint32_t size);
+/* Send the packet being filled, without waiting */
+bool EVE_HalDma_flush(EVE_HalContext *phost);
+/* Wait for the packet in flight. Returns false, and sets EVE_STATUS_ERROR, if it failed */
+bool EVE_HalDma_wait(EVE_HalContext *phost);
+///@}
+
+/** @name MOCK */
+///@{
+
+/* Receives the packets of the mock engine, with the header decoded */
+typedef bool (*EVE_HalDmaSinkFunc)(void *sinkContext, uint32_t addr, const uint8_t *data, uint32_t size);
+
+/** Synchronous engine, which hands each packet to the sink as soon as it is started */
+typedef struct EVE_HalDmaMock
+{
+	EVE_HalDma Dma;
+	EVE_HalDmaSinkFunc Sink;
+	void *SinkContext;
+	bool Result; /**< Result of the sink for the last packet */
+	uint32_t Packets; /**< Packets started */
+} EVE_HalDmaMock;
+
+/* Initialize the mock engine, returns the engine to attach */
+EVE_HalDma *EVE_HalDma_initMock(EVE_HalDmaMock *mock, EVE_HalDmaSinkFunc sink, void *sinkContext);
+///@}
+
+#endif /* EVE_DMA_WRITES */
+
+#endif /* #ifndef EVE_HAL_DMA__H */
+
+/* end of file */
@@ -47,6 +47,38 @@
  **********************/
 #define EVE_CMD_STRING_MAX 511
 
+/** Length of a string, up to `maxLength` characters.
+Scans with memchr, which the C library implements a word or a vector at a time */
+static inline uint32_t EVE_Hal_stringLength(const char *str, uint32_t maxLength)
+{
+	const char *end = (const char *)memchr(str, 0, maxLength);
+	return end ? (uint32_t)(end - str) : maxLength;
+}
+
+/* With EVE_TRACE or EVE_TRANSPORT_OPS, the platform transport is implemented under the
+EVE_HalImpl_ prefix. EVE_Trace.c provides the public EVE_Hal_ functions which record each
+call before forwarding it, and EVE_HalTransport.c provides them by dispatching through the
+transport table of the context. Platform implementation files define EVE_HALIMPL_TRANSPORT
+before including this header */
+#if (EVE_TRACE || EVE_TRANSPORT_OPS) && defined(EVE_HALIMPL_TRANSPORT)
+#define EVE_Hal_startTransfer EVE_HalImpl_startTransfer
+#define EVE_Hal_endTransfer EVE_HalImpl_endTransfer
+#define EVE_Hal_transfer32 EVE_HalImpl_transfer32
+#define EVE_Hal_transferMem EVE_HalImpl_transferMem
+#define EVE_Hal_transferString EVE_HalImpl_transferString
+#define EVE_Hal_transferReserve EVE_HalImpl_transferReserve
+#define EVE_Hal_transferCommit EVE_HalImpl_transferCommit
+#define EVE_Hal_flush EVE_HalImpl_flush
+#define EVE_Hal_spiCommand EVE_HalImpl_spiCommand
+#define EVE_Hal_powerCycle EVE_HalImpl_powerCycle
+#define EVE_Hal_setSPI EVE_HalImpl_setSPI
+#endif
+#if EVE_TRANSPORT_OPS && defined(EVE_HALIMPL_TRANSPORT)
+#define EVE_Hal_restoreSPI EVE_HalImpl_restoreSPI
+#define EVE_Hal_setSPIClock EVE_HalImpl_setSPIClock
+#define EVE_Hal_getInterrupt EVE_HalImpl_getInterrupt
+#endif
+
 /**********************
  *  EXTERN VARIABLES
  **********************/
@@ -82,9 +114,54 @@ void EVE_Hal_endTransfer(EVE_HalContext *phost);
 uint32_t EVE_Hal_transfer32(EVE_HalContext *phost, uint32_t value);
 void EVE_Hal_transferMem(EVE_HalContext *phost, uint8_t *result, const uint8_t *buffer, uint32_t size);
 uint32_t EVE_Hal_transferString(EVE_HalContext *phost, const char *str, uint32_t index, uint32_t size, uint32_t padMask);
+/* Get a pointer into the transport write buffer for the next `size` bytes of the ongoing write transfer.
+Returns NULL when the transport does not buffer writes, the caller then uses EVE_Hal_transferMem */
+uint8_t *EVE_Hal_transferReserve(EVE_HalContext *phost, uint32_t size);
+/* Commit `size` bytes written into the space from EVE_Hal_transferReserve, at most the reserved size */
+void EVE_Hal_transferCommit(EVE_HalContext *phost, uint32_t size);
 void EVE_Hal_flush(EVE_HalContext *phost);
 ///@}
 
+#if EVE_TRACE || EVE_TRANSPORT_OPS
+/** @name PLATFORM TRANSPORT */
+///@{
+void EVE_HalImpl_startTransfer(EVE_HalContext *phost, EVE_TRANSFER_T rw, uint32_t addr);
+void EVE_HalImpl_endTransfer(EVE_HalContext *phost);
+uint32_t EVE_HalImpl_transfer32(EVE_HalContext *phost, uint32_t value);
+void EVE_HalImpl_transferMem(EVE_HalContext *phost, uint8_t *result, const uint8_t *buffer, uint32_t size);
+uint32_t EVE_HalImpl_transferString(EVE_HalContext *phost, const char *str, uint32_t index, uint32_t size, uint32_t padMask);
+uint8_t *EVE_HalImpl_transferReserve(EVE_HalContext *phost, uint32_t size);
+void EVE_HalImpl_transferCommit(EVE_HalContext *phost, uint32_t size);
+void EVE_HalImpl_flush(EVE_HalContext *phost);
+void EVE_HalImpl_spiCommand(EVE_HalContext *phost, uint8_t *cmd);
+bool EVE_HalImpl_powerCycle(EVE_HalContext *phost, bool up);
+void EVE_HalImpl_setSPI(EVE_HalContext *phost, EVE_SPI_CHANNELS_T numchnls);
+#if EVE_TRANSPORT_OPS
+void EVE_HalImpl_restoreSPI(EVE_HalContext *phost);
+uint32_t EVE_HalImpl_setSPIClock(EVE_HalContext *phost, uint32_t clockKHz);
+bool EVE_HalImpl_getInterrupt(EVE_HalContext *phost);
+#endif
+///@}
+#endif
+
+#if EVE_TRACE && EVE_TRANSPORT_OPS
+/** @name TRACED TRANSPORT
+Recording layer between the transport table and the platform, see EVE_Trace.c */
+///@{
+void EVE_HalTrace_startTransfer(EVE_HalContext *phost, EVE_TRANSFER_T rw, uint32_t addr);
+void EVE_HalTrace_endTransfer(EVE_HalContext *phost);
+uint32_t EVE_HalTrace_transfer32(EVE_HalContext *phost, uint32_t value);
+void EVE_HalTrace_transferMem(EVE_HalContext *phost, uint8_t *result, const uint8_t *buffer, uint32_t size);
+uint32_t EVE_HalTrace_transferString(EVE_HalContext *phost, const char *str, uint32_t index, uint32_t size, uint32_t padMask);
+uint8_t *EVE_HalTrace_transferReserve(EVE_HalContext *phost, uint32_t size);
+void EVE_HalTrace_transferCommit(EVE_HalContext *phost, uint32_t size);
+void EVE_HalTrace_flush(EVE_HalContext *phost);
+void EVE_HalTrace_spiCommand(EVE_HalContext *phost, uint8_t *cmd);
+bool EVE_HalTrace_powerCycle(EVE_HalContext *phost, bool up);
+void EVE_HalTrace_setSPI(EVE_HalContext *phost, EVE_SPI_CHANNELS_T numchnls);
+///@}
+#endif
+
 /** @name UTILITY */
 ///@{
 /* This API sends a SPI command to the phost */
@@ -95,11 +172,27 @@ bool EVE_Hal_powerCycle(EVE_HalContext *phost, bool up);
 void EVE_Hal_setSPI(EVE_HalContext *phost, EVE_SPI_CHANNELS_T numchnls);
 /* Restore platform to previously configured EVE SPI channel mode */
 void EVE_Hal_restoreSPI(EVE_HalContext *phost);
+/* Change the host SPI clock. Returns the clock rate actually configured, in kHz */
+uint32_t EVE_Hal_setSPIClock(EVE_HalContext *phost, uint32_t clockKHz);
 /* Get interrupt status */
 bool EVE_Hal_getInterrupt(EVE_HalContext *phost);
 ///@}
 
 
+#if EVE_ASYNC_WRITES
+/** @name ASYNC WRITES */
+///@{
+/* Start the background write worker. Packets are written by calling func on the worker thread */
+bool EVE_AsyncWrite_start(EVE_HalContext *phost, EVE_AsyncWriteFunc func);
+/* Wait for the pending packet and stop the worker */
+void EVE_AsyncWrite_stop(EVE_HalContext *phost);
+/* Hand a packet to the worker, after waiting for the previous one. The buffer must stay untouched until the next wait */
+void EVE_AsyncWrite_submit(EVE_HalContext *phost, uint32_t addr, uint8_t *buffer, uint32_t size);
+/* Wait until the pending packet is written. Returns false if any background write failed */
+bool EVE_AsyncWrite_wait(EVE_HalContext *phost);
+///@}
+#endif
+
 /** @name MISC */
 ///@{
 
@@ -110,6 +203,7 @@ void EVE_Millis_initialize();
 void EVE_Millis_release();
 uint32_t EVE_millis();
 uint64_t EVE_millis64();
+uint64_t EVE_micros64();
 void EVE_sleep(uint32_t ms);
 
 ///@}
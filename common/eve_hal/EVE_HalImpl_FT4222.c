@@ -29,6 +29,7 @@
  * SOFTWARE.
 */
 
+#define EVE_HALIMPL_TRANSPORT
 #include "EVE_HalImpl.h"
 #if defined(FT4222_PLATFORM)
 
@@ -45,6 +46,21 @@
 #define READ_TIMEOUT 5
 #define DATA_LENGTH 1024
 
+#if EVE_ASYNC_WRITES
+/* Each half of SpiWrBuf is filled in turn, while the other half is written in the background */
+#define FT4222_WRBUF_SIZE (sizeof(((EVE_HalContext *)0)->SpiWrBuf) / 2)
+#define FT4222_WRBUF(phost) (&(phost)->SpiWrBuf[(phost)->SpiWrHalf * FT4222_WRBUF_SIZE])
+#else
+#define FT4222_WRBUF_SIZE (sizeof(((EVE_HalContext *)0)->SpiWrBuf))
+#define FT4222_WRBUF(phost) ((phost)->SpiWrBuf)
+#endif
+/* Data bytes in one write packet, which must fit a single 16-bit transfer */
+#define FT4222_PACKET_DATA_MAX ((min(FT4222_WRBUF_SIZE, FT4222_TRANSFER_SIZE_MAX) - FT4222_WRITE_HEADER_SIZE) & ~3UL)
+
+static bool flush(EVE_HalContext *phost);
+static bool writePacket(EVE_HalContext *phost, uint32_t addr, uint8_t *packet, uint32_t size);
+static bool flushSync(EVE_HalContext *phost);
+
 DWORD s_NumDevsD2XX;
 
 /** @name INIT */
@@ -169,29 +185,27 @@ bool EVE_HalImpl_defaults(EVE_HalParameters *parameters, size_t deviceIdx)
  * @param phost Pointer to Hal context
  * @param sysclk System clock
  * @param sysdivisor SPI clock divisor
- * @param parameters EVE_Hal framework's parameters
+ * @param clockKHz User requested SPI communication clock
  * @return true True if ok
  * @return false False if error
  */
-bool computeCLK(EVE_HalContext *phost, FT4222_ClockRate *sysclk, FT4222_SPIClock *sysdivisor, const EVE_HalParameters *parameters)
+bool computeCLK(EVE_HalContext *phost, FT4222_ClockRate *sysclk, FT4222_SPIClock *sysdivisor, uint32_t clockKHz)
 {
-	/* phost->Parameters.SpiClockrateKHz is the user requested SPI communication clock */
-
-	if (parameters->SpiClockrateKHz <= 5000)
+	if (clockKHz <= 5000)
 	{
 		/* set to 5000 KHz */
 		*sysclk = SYS_CLK_80;
 		*sysdivisor = CLK_DIV_16;
 		phost->SpiClockrateKHz = 5000;
 	}
-	else if (parameters->SpiClockrateKHz <= 10000)
+	else if (clockKHz <= 10000)
 	{
 		/* set to 10000 KHz */
 		*sysclk = SYS_CLK_80;
 		*sysdivisor = CLK_DIV_8;
 		phost->SpiClockrateKHz = 10000;
 	}
-	else if (parameters->SpiClockrateKHz <= 15000)
+	else if (clockKHz <= 15000)
 	{
 		/* This is the default */
 		/* set to 15000 KHz */
@@ -199,7 +213,7 @@ bool computeCLK(EVE_HalContext *phost, FT4222_ClockRate *sysclk, FT4222_SPIClock
 		*sysdivisor = CLK_DIV_4;
 		phost->SpiClockrateKHz = 15000;
 	}
-	else if (parameters->SpiClockrateKHz <= 20000)
+	else if (clockKHz <= 20000)
 	{
 		/* set to 20000 KHz */
 		*sysclk = SYS_CLK_80;
@@ -214,7 +228,7 @@ bool computeCLK(EVE_HalContext *phost, FT4222_ClockRate *sysclk, FT4222_SPIClock
 		*sysdivisor = CLK_DIV_2;
 		phost->SpiClockrateKHz = 30000;
 	}
-	eve_printf_debug("User Selected SPI clk : %d KHz\n", (int)parameters->SpiClockrateKHz);
+	eve_printf_debug("User Selected SPI clk : %d KHz\n", (int)clockKHz);
 	eve_printf_debug("Configured clk : %d KHz, Ft4222 sys clk enum = %d , divisor enum = %d\n", (int)phost->SpiClockrateKHz, *sysclk, *sysdivisor);
 	return true;
 }
@@ -318,7 +332,7 @@ bool EVE_HalImpl_open(EVE_HalContext *phost, const EVE_HalParameters *parameters
 
 	if (ret)
 	{
-		if (!computeCLK(phost, &selclk, &seldiv, parameters))
+		if (!computeCLK(phost, &selclk, &seldiv, parameters->SpiClockrateKHz))
 		{
 			eve_printf_debug("Requested clock %d KHz is not supported in FT4222\n", parameters->SpiClockrateKHz);
 			ret = false;
@@ -395,6 +409,10 @@ bool EVE_HalImpl_open(EVE_HalContext *phost, const EVE_HalParameters *parameters
 		phost->SpiChannels = EVE_SPI_SINGLE_CHANNEL;
 		phost->Status = EVE_STATUS_OPENED;
 		++g_HalPlatform.OpenedDevices;
+#if EVE_ASYNC_WRITES
+		/* Falls back to synchronous writes if the worker cannot be started */
+		EVE_AsyncWrite_start(phost, writePacket);
+#endif
 	}
 
 	return ret;
@@ -408,6 +426,10 @@ bool EVE_HalImpl_open(EVE_HalContext *phost, const EVE_HalParameters *parameters
 void EVE_HalImpl_close(EVE_HalContext *phost)
 {
 	FT4222_STATUS status;
+#if EVE_ASYNC_WRITES
+	flush(phost);
+	EVE_AsyncWrite_stop(phost);
+#endif
 	phost->Status = EVE_STATUS_CLOSED;
 	--g_HalPlatform.OpenedDevices;
 
@@ -618,6 +640,69 @@ static inline bool rdBuffer(EVE_HalContext *phost, uint8_t *buffer, uint32_t siz
 	return true;
 }
 
+/**
+ * @brief Write a HOST MEMORY WRITE packet
+ * 
+ * Called on the background write worker when EVE_ASYNC_WRITES is enabled
+ * 
+ * @param phost Pointer to Hal context
+ * @param addr Address to write
+ * @param packet Header space followed by the data
+ * @param size Size of the packet, including the header
+ * @return true True if ok
+ * @return false False if error
+ */
+static bool writePacket(EVE_HalContext *phost, uint32_t addr, uint8_t *packet, uint32_t size)
+{
+	FT4222_STATUS status;
+
+	/* Compose the HOST MEMORY WRITE packet */
+	packet[0] = (addr >> 24) | 0x80; /* MSB bits 10 for WRITE */
+	packet[1] = (addr >> 16) & 0xFF;
+	packet[2] = (addr >> 8) & 0xFF;
+	packet[3] = addr & 0xFF;
+
+	if (phost->SpiChannels == EVE_SPI_SINGLE_CHANNEL)
+	{
+		uint16_t sizeWritten;
+
+		status = FT4222_SPIMaster_SingleWrite(
+		    phost->SpiHandle,
+		    packet,
+		    (uint16_t)size,
+		    &sizeWritten,
+		    TRUE);
+
+		if ((status != FT4222_OK) || (sizeWritten != size))
+		{
+			eve_printf_debug("%d FT4222_SPIMaster_SingleWrite failed, sizeTransferred is %d with status %d\n", __LINE__, sizeWritten, status);
+			return false;
+		}
+	}
+	else
+	{
+		uint8_t dummyRead[8];
+		uint32_t sizeTransferred;
+
+		status = FT4222_SPIMaster_MultiReadWrite(
+		    phost->SpiHandle,
+		    dummyRead,
+		    packet,
+		    0,
+		    (uint16_t)size,
+		    0,
+		    &sizeTransferred);
+
+		if (status != FT4222_OK)
+		{
+			eve_printf_debug("FT4222_SPIMaster_MultiReadWrite failed, status %d\n", status);
+			return false;
+		}
+	}
+
+	return true;
+}
+
 /**
  * @brief Write a block data to Coprocessor
  * 
@@ -629,17 +714,16 @@ static inline bool rdBuffer(EVE_HalContext *phost, uint8_t *buffer, uint32_t siz
  */
 static inline bool wrBuffer(EVE_HalContext *phost, const uint8_t *buffer, uint32_t size)
 {
-	FT4222_STATUS status;
 	if (size & 3)
 	{
 		size = (size + 3) & ~3UL;
 		eve_printf_debug("Data size should be align to 4 bytes\n");
 	}
 
-	if (buffer && (size < (sizeof(phost->SpiWrBuf) - phost->SpiWrBufIndex - FT4222_WRITE_HEADER_SIZE)))
+	if (buffer && (phost->SpiWrBufIndex + size <= FT4222_PACKET_DATA_MAX))
 	{
 		/* Write to buffer */
-		memcpy(&phost->SpiWrBuf[phost->SpiWrBufIndex + FT4222_WRITE_HEADER_SIZE], buffer, size);
+		memcpy(&FT4222_WRBUF(phost)[phost->SpiWrBufIndex + FT4222_WRITE_HEADER_SIZE], buffer, size);
 		phost->SpiWrBufIndex += size;
 		return true;
 	}
@@ -652,7 +736,7 @@ static inline bool wrBuffer(EVE_HalContext *phost, const uint8_t *buffer, uint32
 				return false;
 
 			/* Write to buffer */
-			if (size < (sizeof(phost->SpiWrBuf) - FT4222_WRITE_HEADER_SIZE))
+			if (size <= FT4222_PACKET_DATA_MAX)
 				return wrBuffer(phost, buffer, size);
 		}
 
@@ -670,86 +754,30 @@ static inline bool wrBuffer(EVE_HalContext *phost, const uint8_t *buffer, uint32
 
 			while (size)
 			{
-				uint32_t sizeTransferred;
-				uint32_t bytesPerWrite;
-
-				if (size <= FT4222_WRITE_SIZE_MAX)
-					bytesPerWrite = size + FT4222_WRITE_HEADER_SIZE;
-				else
-					bytesPerWrite = FT4222_TRANSFER_SIZE_MAX;
-				if (bytesPerWrite & 3)
-				{
-					bytesPerWrite = (bytesPerWrite + 3) & ~3UL;
-					eve_printf_debug("Data size should be align to 4 bytes\n");
-				}
+				uint8_t *packet = FT4222_WRBUF(phost);
+				uint32_t dataSize = min(size, FT4222_PACKET_DATA_MAX);
 
 				if (buffer)
 				{
 					/* Writing large buffer */
-					memcpy(phost->SpiWrBuf + FT4222_WRITE_HEADER_SIZE, buffer, (bytesPerWrite - FT4222_WRITE_HEADER_SIZE));
+					memcpy(packet + FT4222_WRITE_HEADER_SIZE, buffer, dataSize);
+					buffer += dataSize;
 				}
 
-				/* Compose the HOST MEMORY WRITE packet */
-				phost->SpiWrBuf[0] = (addr >> 24) | 0x80; /* MSB bits 10 for WRITE */
-				phost->SpiWrBuf[1] = (addr >> 16) & 0xFF;
-				phost->SpiWrBuf[2] = (addr >> 8) & 0xFF;
-				phost->SpiWrBuf[3] = addr & 0xFF;
-
-				if (phost->SpiChannels == EVE_SPI_SINGLE_CHANNEL)
+#if EVE_ASYNC_WRITES
+				/* Written in the background, while the other half is being filled */
+				EVE_AsyncWrite_submit(phost, addr, packet, dataSize + FT4222_WRITE_HEADER_SIZE);
+				phost->SpiWrHalf ^= 1;
+#else
+				if (!writePacket(phost, addr, packet, dataSize + FT4222_WRITE_HEADER_SIZE))
 				{
-					uint16_t sizeWritten;
-
-					status = FT4222_SPIMaster_SingleWrite(
-					    phost->SpiHandle,
-					    phost->SpiWrBuf,
-					    bytesPerWrite,
-					    &sizeWritten,
-					    TRUE);
-
-					if ((status != FT4222_OK) || (sizeWritten != bytesPerWrite))
-					{
-						eve_printf_debug("%d FT4222_SPIMaster_SingleWrite failed, sizeTransferred is %d with status %d\n", __LINE__, sizeWritten, status);
-						if (sizeWritten != bytesPerWrite)
-							phost->Status = EVE_STATUS_ERROR;
-						return false;
-					}
-
-					sizeTransferred = sizeWritten;
-				}
-				else
-				{
-					uint8_t dummyRead[8];
-
-					status = FT4222_SPIMaster_MultiReadWrite(
-					    phost->SpiHandle,
-					    dummyRead,
-					    phost->SpiWrBuf,
-					    0,
-					    bytesPerWrite,
-					    0,
-					    &sizeTransferred);
-
-					if (status != FT4222_OK)
-					{
-						eve_printf_debug("FT4222_SPIMaster_MultiReadWrite failed, status %d\n", status);
-						return false;
-					}
-
-					sizeTransferred = bytesPerWrite;
-				}
-
-				if (buffer)
-				{
-					buffer += sizeTransferred - FT4222_WRITE_HEADER_SIZE;
-				}
-				if (size)
-				{
-					eve_assert_ex((sizeTransferred - FT4222_WRITE_HEADER_SIZE) <= (int32_t)size, "Cannot have transferred more than size\n");
-					size -= sizeTransferred - FT4222_WRITE_HEADER_SIZE;
-					// eve_assert_ex(!(buffer && size), "Cannot have space left after flushing buffer\n");
+					phost->Status = EVE_STATUS_ERROR;
+					return false;
 				}
+#endif
 
-				addr = incrementRamGAddr(phost, addr, (sizeTransferred - FT4222_WRITE_HEADER_SIZE));
+				size -= dataSize;
+				addr = incrementRamGAddr(phost, addr, dataSize);
 				phost->SpiRamGAddr = addr;
 			}
 		}
@@ -768,8 +796,15 @@ static inline bool wrBuffer(EVE_HalContext *phost, const uint8_t *buffer, uint32
 void EVE_Hal_startTransfer(EVE_HalContext *phost, EVE_TRANSFER_T rw, uint32_t addr)
 {
 	eve_assert(phost->Status == EVE_STATUS_OPENED);
+	++phost->Stats.Transfers;
 
-	if (addr != incrementRamGAddr(phost, phost->SpiRamGAddr, phost->SpiWrBufIndex) || rw == EVE_TRANSFER_READ)
+	if (rw == EVE_TRANSFER_READ)
+	{
+		/* Reads must observe all previous writes */
+		flushSync(phost);
+		phost->SpiRamGAddr = addr;
+	}
+	else if (addr != incrementRamGAddr(phost, phost->SpiRamGAddr, phost->SpiWrBufIndex))
 	{
 		/* Close any write transfer that was left open, if the address changed */
 		flush(phost);
@@ -821,12 +856,33 @@ static bool flush(EVE_HalContext *phost)
 	bool res = true;
 	if (phost->SpiWrBufIndex)
 	{
+		++phost->Stats.Flushes;
 		res = wrBuffer(phost, NULL, 0);
 	}
 	eve_assert(!phost->SpiWrBufIndex);
 	return res;
 }
 
+/**
+ * @brief Flush data to Coprocessor, and wait until all data is written
+ * 
+ * @param phost Pointer to Hal context
+ * @return true True if ok
+ * @return false False if error
+ */
+static bool flushSync(EVE_HalContext *phost)
+{
+	bool res = flush(phost);
+#if EVE_ASYNC_WRITES
+	if (!EVE_AsyncWrite_wait(phost))
+	{
+		phost->Status = EVE_STATUS_ERROR;
+		res = false;
+	}
+#endif
+	return res;
+}
+
 /**
  * @brief Flush data to Coprocessor
  * 
@@ -835,7 +891,7 @@ static bool flush(EVE_HalContext *phost)
 void EVE_Hal_flush(EVE_HalContext *phost)
 {
 	eve_assert(phost->Status == EVE_STATUS_OPENED);
-	flush(phost);
+	flushSync(phost);
 }
 
 /**
@@ -850,6 +906,7 @@ uint32_t EVE_Hal_transfer32(EVE_HalContext *phost, uint32_t value)
 	uint8_t buffer[4];
 	if (phost->Status == EVE_STATUS_READING)
 	{
+		phost->Stats.BytesRead += 4;
 		rdBuffer(phost, buffer, 4);
 		return (uint32_t)buffer[0]
 		    | (uint32_t)buffer[1] << 8
@@ -862,6 +919,7 @@ uint32_t EVE_Hal_transfer32(EVE_HalContext *phost, uint32_t value)
 		buffer[1] = (value >> 8) & 0xFF;
 		buffer[2] = (value >> 16) & 0xFF;
 		buffer[3] = value >> 24;
+		phost->Stats.BytesWritten += 4;
 		wrBuffer(phost, buffer, 4);
 		return 0;
 	}
@@ -887,14 +945,49 @@ void EVE_Hal_transferMem(EVE_HalContext *phost, uint8_t *result, const uint8_t *
 	}
 	else if (result)
 	{
+		phost->Stats.BytesRead += size;
 		rdBuffer(phost, result, size);
 	}
 	else if (buffer)
 	{
+		phost->Stats.BytesWritten += size;
 		wrBuffer(phost, buffer, size);
 	}
 }
 
+/**
+ * @brief Reserve space for an ongoing write directly in the transfer buffer
+ * 
+ * @param phost Pointer to Hal context
+ * @param size Number of bytes to reserve, multiple of 4
+ * @return uint8_t* Pointer into the write buffer, NULL if not available
+ */
+uint8_t *EVE_Hal_transferReserve(EVE_HalContext *phost, uint32_t size)
+{
+	eve_assert(phost->Status == EVE_STATUS_WRITING);
+	eve_assert(!(size & 3));
+
+	if (size > FT4222_PACKET_DATA_MAX)
+		return NULL;
+	if ((phost->SpiWrBufIndex + size > FT4222_PACKET_DATA_MAX) && !flush(phost))
+		return NULL;
+	return &FT4222_WRBUF(phost)[phost->SpiWrBufIndex + FT4222_WRITE_HEADER_SIZE];
+}
+
+/**
+ * @brief Commit data written into space obtained from EVE_Hal_transferReserve
+ * 
+ * @param phost Pointer to Hal context
+ * @param size Number of bytes written, multiple of 4
+ */
+void EVE_Hal_transferCommit(EVE_HalContext *phost, uint32_t size)
+{
+	eve_assert(!(size & 3));
+	eve_assert(phost->SpiWrBufIndex + size <= FT4222_PACKET_DATA_MAX);
+	phost->Stats.BytesWritten += size;
+	phost->SpiWrBufIndex += size;
+}
+
 /**
  * @brief Transfer a string to EVE platform
  * 
@@ -921,33 +1014,18 @@ uint32_t EVE_Hal_transferString(EVE_HalContext *phost, const char *str, uint32_t
 	transferred = 0;
 	if (phost->Status == EVE_STATUS_WRITING)
 	{
-		uint8_t buffer[EVE_CMD_STRING_MAX + 1];
-
-		for (;;)
-		{
-			char c = str[index + (transferred)];
-			buffer[transferred++] = c;
-			// putchar(c ? c : '_');
-			if (!c)
-			{
-				break;
-			}
-			if (transferred >= size)
-			{
-				buffer[transferred++] = 0;
-				// putchar('_');
-				break;
-			}
-		}
-		while (transferred & padMask)
-		{
-			buffer[transferred++] = 0;
-			// putchar('_');
-		}
-
-		eve_assert(transferred);
-
-		wrBuffer(phost, buffer, transferred);
+		uint8_t tail[4] = { 0 };
+		uint32_t length = EVE_Hal_stringLength(&str[index], size);
+		uint32_t aligned = length & ~0x3UL;
+
+		/* Whole words of characters, then the last characters with the terminator and padding as one word */
+		eve_assert(padMask <= 0x3);
+		transferred = (length + 1 + padMask) & ~padMask;
+		memcpy(tail, &str[index + aligned], length - aligned);
+		if (aligned)
+			wrBuffer(phost, (const uint8_t *)&str[index], aligned);
+		wrBuffer(phost, tail, transferred - aligned);
+		phost->Stats.BytesWritten += transferred;
 	}
 	else
 	{
@@ -979,7 +1057,7 @@ void EVE_Hal_spiCommand(EVE_HalContext *phost, uint8_t *cmd)
 	uint16_t sizeTransferred;
 	uint32_t sizeOfRead;
 
-	flush(phost);
+	flushSync(phost);
 	eve_printf_debug("SPI cmd: 0x%x, 0x%x, 0x%x, 0x%x, 0x%x\n", cmd[0], cmd[1], cmd[2], cmd[3], cmd[4]);
 
 	transferArray[0] = cmd[0];
@@ -1036,7 +1114,7 @@ void setSPI(EVE_HalContext *phost, EVE_SPI_CHANNELS_T numchnls)
 	FT4222_STATUS ftstatus;
 	FT4222_SPIMode spimode;
 
-	flush(phost);
+	flushSync(phost);
 
 	/* switch FT4222 to relevant multi channel SPI communication mode */
 	if (numchnls == EVE_SPI_DUAL_CHANNEL)
@@ -1065,7 +1143,7 @@ void setSPI(EVE_HalContext *phost, EVE_SPI_CHANNELS_T numchnls)
 bool EVE_Hal_powerCycle(EVE_HalContext *phost, bool up)
 {
 	bool res = true;
-	flush(phost);
+	flushSync(phost);
 
 	if (up)
 	{
@@ -1129,6 +1207,7 @@ void EVE_Hal_setSPI(EVE_HalContext *phost, EVE_SPI_CHANNELS_T numchnls)
 	EVE_Hal_startTransfer(phost, EVE_TRANSFER_READ, REG_SYS_CFG);
 	syscfg = EVE_Hal_transfer32(phost, 0);
 	EVE_Hal_endTransfer(phost);
+	syscfg &= ~(SPI_WIDTH_2bit | SPI_WIDTH_4bit);
 	if (numchnls == EVE_SPI_DUAL_CHANNEL)
 	{
 		syscfg |= SPI_WIDTH_2bit;
@@ -1156,6 +1235,42 @@ void EVE_Hal_restoreSPI(EVE_HalContext *phost)
 	setSPI(phost, phost->SpiChannels);
 }
 
+/**
+ * @brief Change the SPI clock
+ * 
+ * The clock is rounded up to the next rate supported by computeCLK.
+ * Reinitializes the SPI master, keeping the current channel mode.
+ * 
+ * @param phost Pointer to Hal context
+ * @param clockKHz Requested clock rate in kHz
+ * @return uint32_t Configured clock rate in kHz
+ */
+uint32_t EVE_Hal_setSPIClock(EVE_HalContext *phost, uint32_t clockKHz)
+{
+	FT4222_ClockRate selclk;
+	FT4222_SPIClock seldiv;
+	FT4222_STATUS status;
+
+	flushSync(phost);
+	computeCLK(phost, &selclk, &seldiv, clockKHz);
+
+	status = FT4222_SetClock(phost->SpiHandle, selclk);
+	if (status != FT4222_OK)
+		eve_printf_debug("FT4222_SetClock failed!\n");
+
+	status = FT4222_SPIMaster_Init(phost->SpiHandle, SPI_IO_SINGLE, seldiv, CLK_IDLE_LOW, CLK_LEADING, phost->SpiCsPin);
+	if (status != FT4222_OK)
+	{
+		eve_printf_debug("Init FT4222 as SPI master device failed!\n");
+		phost->Status = EVE_STATUS_ERROR;
+	}
+	FT4222_SPI_SetDrivingStrength(phost->SpiHandle, DS_4MA, DS_4MA, DS_4MA);
+
+	/* Init resets the lines to single channel */
+	setSPI(phost, phost->SpiChannels);
+	return phost->SpiClockrateKHz;
+}
+
 /**
  * @brief Get interrupt status
  * 
@@ -0,0 +1,162 @@
+/**
+ * @file EVE_HalImpl_LINUX.c
+ * @brief Eve_Hal framework APIs for Linux host platform
+ *
+ * @author Bridgetek
+ *
+ * @date 2025
+ *
+ * MIT License
+ *
+ * Copyright (c) [2025] [Bridgetek Pte Ltd (BRTChip)]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "EVE_HalImpl.h"
+#if defined(__linux__)
+
+/*********
+** INIT **
+*********/
+
+/** @name INIT */
+///@{
+
+/**
+ * @brief Init host MCU
+ * 
+ */
+void EVE_Mcu_initialize()
+{
+	/* no-op */
+}
+
+/**
+ * @brief Release host MCU
+ * 
+ */
+void EVE_Mcu_release()
+{
+	/* no-op */
+}
+///@}
+
+/*********
+** MISC **
+*********/
+
+static uint64_t s_Millis64_Start;
+static uint64_t s_Micros64_Start;
+/** @name MISC */
+///@{
+
+/**
+ * @brief Get monotonic clock in milisecond
+ * 
+ * @return uint64_t Clock number
+ */
+static inline uint64_t monotonicMillis()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + (uint64_t)(ts.tv_nsec / 1000000);
+}
+
+/**
+ * @brief Get monotonic clock in microsecond
+ * 
+ * @return uint64_t Clock number
+ */
+static inline uint64_t monotonicMicros()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)(ts.tv_nsec / 1000);
+}
+
+/**
+ * @brief Init timer
+ * 
+ */
+void EVE_Millis_initialize()
+{
+	s_Millis64_Start = monotonicMillis();
+	s_Micros64_Start = monotonicMicros();
+}
+
+/**
+ * @brief Release timer
+ * 
+ */
+void EVE_Millis_release()
+{
+	/* no-op */
+}
+
+/**
+ * @brief Get clock in miliseond
+ * 
+ * global counter to loopback after ~49.71 days
+ * 
+ * @return uint32_t Clock number
+ */
+uint32_t EVE_millis()
+{
+	return (uint32_t)(monotonicMillis() - s_Millis64_Start);
+}
+
+/**
+* @brief Get clock in miliseond
+* 
+* @return uint64_t Clock number
+*/
+uint64_t EVE_millis64()
+{
+	return monotonicMillis() - s_Millis64_Start;
+}
+
+/**
+* @brief Get clock in microsecond
+* 
+* @return uint64_t Clock number
+*/
+uint64_t EVE_micros64()
+{
+	return monotonicMicros() - s_Micros64_Start;
+}
+
+/**
+ * @brief Sleep in milisecond
+ * 
+ * @param ms Milisecond
+ */
+void EVE_sleep(uint32_t ms)
+{
+	struct timespec ts;
+	ts.tv_sec = ms / 1000;
+	ts.tv_nsec = (long)(ms % 1000) * 1000000L;
+	while (nanosleep(&ts, &ts) && errno == EINTR)
+		;
+}
+///@}
+
+#endif
+
+/* end of file */
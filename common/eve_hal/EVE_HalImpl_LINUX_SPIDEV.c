@@ -0,0 +1,942 @@
+/**
+ * @file EVE_HalImpl_LINUX_SPIDEV.c
+ * @brief Eve_Hal framework APIs for Linux spidev host platform
+ *
+ * @author Bridgetek
+ *
+ * @date 2025
+ *
+ * MIT License
+ *
+ * Copyright (c) [2025] [Bridgetek Pte Ltd (BRTChip)]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define EVE_HALIMPL_TRANSPORT
+#include "EVE_HalImpl.h"
+#if defined(LINUX_SPIDEV_PLATFORM)
+
+#define LINUX_SPIDEV_HEADER_SIZE (4)
+
+#define POLLING_BYTES EVE_SPIDEV_POLLING_BYTES
+#define READ_TIMEOUT 5
+#define DATA_LENGTH EVE_SPIDEV_DATA_LENGTH
+
+static bool flush(EVE_HalContext *phost);
+
+/** @name INIT */
+///@{
+/**
+ * @brief Initialize HAL platform
+ *
+ */
+void EVE_HalImpl_initialize()
+{
+	/* no-op */
+}
+
+/**
+ * @brief Release HAL platform
+ *
+ */
+void EVE_HalImpl_release()
+{
+	/* no-op */
+}
+
+/**
+ * @brief Get the default configuration parameters
+ *
+ * @param parameters EVE_Hal framework's parameters
+ * @param deviceIdx Chip select on SPI bus 0, or -1 for the default device
+ * @return true True if ok
+ * @return false False if error
+ */
+bool EVE_HalImpl_defaults(EVE_HalParameters *parameters, size_t deviceIdx)
+{
+	if (deviceIdx < 16)
+		snprintf(parameters->SpiDevice, sizeof(parameters->SpiDevice), "/dev/spidev0.%u", (unsigned int)deviceIdx);
+	else
+		snprintf(parameters->SpiDevice, sizeof(parameters->SpiDevice), "%s", EVE_DEFAULT_SPIDEV_DEVICE);
+	snprintf(parameters->GpioDevice, sizeof(parameters->GpioDevice), "%s", EVE_DEFAULT_SPIDEV_GPIOCHIP);
+	parameters->PowerDownPin = EVE_DEFAULT_SPIDEV_PWD;
+	parameters->InterruptPin = EVE_DEFAULT_SPIDEV_INT;
+	parameters->SpiClockrateKHz = EVE_DEFAULT_SPIDEV_CLOCKRATE_KHZ;
+	return access(parameters->SpiDevice, R_OK | W_OK) == 0;
+}
+
+/**
+ * @brief Request a single line from the GPIO character device
+ *
+ * @param chipFd GPIO chip file descriptor
+ * @param line Line offset
+ * @param output True to request as output, driven high
+ * @return int Line handle, -1 if error
+ */
+static int requestLine(int chipFd, uint8_t line, bool output)
+{
+	struct gpiohandle_request req;
+
+	if (chipFd < 0 || line == EVE_SPIDEV_PIN_NONE)
+		return -1;
+
+	memset(&req, 0, sizeof(req));
+	req.lineoffsets[0] = line;
+	req.lines = 1;
+	req.flags = output ? GPIOHANDLE_REQUEST_OUTPUT : GPIOHANDLE_REQUEST_INPUT;
+	req.default_values[0] = 1;
+	snprintf(req.consumer_label, sizeof(req.consumer_label), "eve_hal");
+	if (ioctl(chipFd, GPIO_GET_LINEHANDLE_IOCTL, &req) < 0)
+	{
+		eve_printf_debug("GPIO line %d request failed, errno %d\n", (int)line, errno);
+		return -1;
+	}
+	return req.fd;
+}
+
+/**
+ * @brief Drive a GPIO line
+ *
+ * @param fd Line handle
+ * @param value Level to drive
+ * @return true True if ok
+ * @return false False if error
+ */
+static bool writeLine(int fd, uint8_t value)
+{
+	struct gpiohandle_data data;
+
+	if (fd < 0)
+		return false;
+
+	memset(&data, 0, sizeof(data));
+	data.values[0] = value;
+	return ioctl(fd, GPIOHANDLE_SET_LINE_VALUES_IOCTL, &data) >= 0;
+}
+
+/**
+ * @brief Read the spidev message size limit
+ *
+ * @return uint32_t Value of the spidev `bufsiz` module parameter
+ */
+static uint32_t readBufSize()
+{
+	uint32_t bufsiz = EVE_SPIDEV_BUFSIZ_DEFAULT;
+	FILE *f = fopen("/sys/module/spidev/parameters/bufsiz", "r");
+	if (f)
+	{
+		unsigned int value;
+		if (fscanf(f, "%u", &value) == 1 && value)
+			bufsiz = value;
+		fclose(f);
+	}
+	return bufsiz;
+}
+
+/**
+ * @brief Check which multi-line modes the kernel driver accepts
+ *
+ * The SPI core silently clears mode bits the controller does not support,
+ * so the mode is read back after writing it.
+ *
+ * @param phost Pointer to Hal context
+ * @return uint32_t Supported SPI_TX_DUAL/SPI_RX_DUAL/SPI_TX_QUAD/SPI_RX_QUAD bits
+ */
+static uint32_t probeModeCaps(EVE_HalContext *phost)
+{
+	const uint32_t probes[2] = { SPI_TX_DUAL | SPI_RX_DUAL, SPI_TX_QUAD | SPI_RX_QUAD };
+	uint32_t caps = 0;
+	uint32_t mode;
+
+	for (int i = 0; i < 2; ++i)
+	{
+		mode = SPI_MODE_0 | probes[i];
+		if (ioctl(phost->SpiFd, SPI_IOC_WR_MODE32, &mode) < 0)
+			continue;
+		if (ioctl(phost->SpiFd, SPI_IOC_RD_MODE32, &mode) < 0)
+			continue;
+		if ((mode & probes[i]) == probes[i])
+			caps |= probes[i];
+	}
+
+	mode = SPI_MODE_0;
+	ioctl(phost->SpiFd, SPI_IOC_WR_MODE32, &mode);
+	return caps;
+}
+
+/**
+ * @brief Opens a new HAL context using the specified parameters
+ *
+ * @param phost Pointer to Hal context
+ * @param parameters EVE_Hal framework's parameters
+ * @return true True if ok
+ * @return false False if error
+ */
+bool EVE_HalImpl_open(EVE_HalContext *phost, const EVE_HalParameters *parameters)
+{
+	uint32_t mode = SPI_MODE_0;
+	uint8_t bits = 8;
+	uint32_t speed;
+	int chipFd;
+
+	phost->PowerDownFd = -1;
+	phost->InterruptFd = -1;
+
+	phost->SpiFd = open(parameters->SpiDevice, O_RDWR);
+	if (phost->SpiFd < 0)
+	{
+		eve_printf_debug("Open %s failed, errno %d\n", parameters->SpiDevice, errno);
+		return false;
+	}
+
+	speed = (parameters->SpiClockrateKHz ? parameters->SpiClockrateKHz : EVE_DEFAULT_SPIDEV_CLOCKRATE_KHZ) * 1000;
+	if (ioctl(phost->SpiFd, SPI_IOC_WR_MODE32, &mode) < 0
+	    || ioctl(phost->SpiFd, SPI_IOC_WR_BITS_PER_WORD, &bits) < 0
+	    || ioctl(phost->SpiFd, SPI_IOC_WR_MAX_SPEED_HZ, &speed) < 0)
+	{
+		eve_printf_debug("Configure %s failed, errno %d\n", parameters->SpiDevice, errno);
+		close(phost->SpiFd);
+		phost->SpiFd = -1;
+		return false;
+	}
+	ioctl(phost->SpiFd, SPI_IOC_RD_MAX_SPEED_HZ, &speed);
+	phost->SpiClockrateKHz = speed / 1000;
+
+	phost->SpiModeCaps = probeModeCaps(phost);
+	phost->SpiBufSize = min(readBufSize(), (uint32_t)sizeof(phost->SpiWrBuf));
+	phost->SpiBufSize &= ~3UL;
+	if (phost->SpiBufSize < LINUX_SPIDEV_HEADER_SIZE + POLLING_BYTES + 64)
+	{
+		eve_printf_debug("spidev bufsiz %d is too small\n", (int)phost->SpiBufSize);
+		close(phost->SpiFd);
+		phost->SpiFd = -1;
+		return false;
+	}
+
+	eve_printf_debug("Open %s for EVE, %d kHz, bufsiz %d, dual %s, quad %s\n",
+	    parameters->SpiDevice, (int)phost->SpiClockrateKHz, (int)phost->SpiBufSize,
+	    (phost->SpiModeCaps & SPI_TX_DUAL) ? "yes" : "no",
+	    (phost->SpiModeCaps & SPI_TX_QUAD) ? "yes" : "no");
+
+	chipFd = open(parameters->GpioDevice, O_RDWR);
+	if (chipFd >= 0)
+	{
+		phost->PowerDownFd = requestLine(chipFd, parameters->PowerDownPin, true);
+		phost->InterruptFd = requestLine(chipFd, parameters->InterruptPin, false);
+		close(chipFd);
+	}
+	else
+	{
+		eve_printf_debug("Open %s failed, PD_N and INT_N are not available\n", parameters->GpioDevice);
+	}
+
+	phost->SpiChannels = EVE_SPI_SINGLE_CHANNEL;
+	phost->Status = EVE_STATUS_OPENED;
+	++g_HalPlatform.OpenedDevices;
+
+	return true;
+}
+
+/**
+ * @brief Close a HAL context
+ *
+ * @param phost Pointer to Hal context
+ */
+void EVE_HalImpl_close(EVE_HalContext *phost)
+{
+	flush(phost);
+
+	phost->Status = EVE_STATUS_CLOSED;
+	--g_HalPlatform.OpenedDevices;
+
+	if (phost->InterruptFd >= 0)
+		close(phost->InterruptFd);
+	if (phost->PowerDownFd >= 0)
+		close(phost->PowerDownFd);
+	close(phost->SpiFd);
+	phost->InterruptFd = -1;
+	phost->PowerDownFd = -1;
+	phost->SpiFd = -1;
+}
+
+/**
+ * @brief Idle. Call regularly to update frequently changing internal state
+ *
+ * @param phost Pointer to Hal context
+ */
+void EVE_HalImpl_idle(EVE_HalContext *phost)
+{
+	/* no-op */
+}
+///@}
+
+/*************
+** TRANSFER **
+*************/
+
+/** @name TRANSFER */
+///@{
+
+/**
+ * @brief Increase RAM_G adress
+ *
+ * @param phost Pointer to Hal context
+ * @param addr Address offset
+ * @param inc Number of bytes to increase
+ * @return uint32_t New address in RAM_G
+ */
+static inline uint32_t incrementRamGAddr(EVE_HalContext *phost, uint32_t addr, uint32_t inc)
+{
+	if (addr != REG_CMDB_WRITE)
+	{
+		bool wrapCmdAddr = (addr >= RAM_CMD) && (addr < (RAM_CMD + EVE_CMD_FIFO_SIZE));
+		addr += inc;
+		if (wrapCmdAddr)
+			addr = RAM_CMD + (addr & EVE_CMD_FIFO_MASK);
+	}
+	return addr;
+}
+
+/**
+ * @brief Number of data lines used for the current channel mode
+ *
+ * @param phost Pointer to Hal context
+ * @return uint8_t Value for tx_nbits/rx_nbits
+ */
+static inline uint8_t channelBits(EVE_HalContext *phost)
+{
+	if (phost->SpiChannels == EVE_SPI_QUAD_CHANNEL)
+		return 4;
+	if (phost->SpiChannels == EVE_SPI_DUAL_CHANNEL)
+		return 2;
+	return 1;
+}
+
+/**
+ * @brief Check if the queued message has room for more segments
+ *
+ * @param phost Pointer to Hal context
+ * @param segments Number of segments to add
+ * @param size Number of bytes to add
+ * @return true True if they fit in the current message
+ */
+static inline bool hasRoom(EVE_HalContext *phost, uint32_t segments, uint32_t size)
+{
+	return (phost->SpiXferCount + segments <= EVE_SPIDEV_SEGMENTS_MAX)
+	    && (phost->SpiXferBytes + size <= phost->SpiBufSize);
+}
+
+/**
+ * @brief Queue one segment of the next SPI_IOC_MESSAGE
+ *
+ * Chip select is released after every segment unless `keepCs` is set,
+ * so each segment (or pair of segments) forms one EVE transaction.
+ *
+ * @param phost Pointer to Hal context
+ * @param tx Data to send, NULL when reading
+ * @param rx Buffer to receive, NULL when writing
+ * @param size Number of bytes
+ * @param keepCs Keep chip select asserted into the next segment
+ * @return struct spi_ioc_transfer* The queued segment
+ */
+static inline struct spi_ioc_transfer *queueSegment(EVE_HalContext *phost, const uint8_t *tx, uint8_t *rx, uint32_t size, bool keepCs)
+{
+	struct spi_ioc_transfer *xfer = &phost->SpiXfer[phost->SpiXferCount++];
+	uint8_t nbits = channelBits(phost);
+
+	eve_assert(phost->SpiXferCount <= EVE_SPIDEV_SEGMENTS_MAX);
+	memset(xfer, 0, sizeof(struct spi_ioc_transfer));
+	xfer->tx_buf = (uintptr_t)tx;
+	xfer->rx_buf = (uintptr_t)rx;
+	xfer->len = size;
+	xfer->tx_nbits = tx ? nbits : 0;
+	xfer->rx_nbits = rx ? nbits : 0;
+	xfer->cs_change = keepCs ? 0 : 1;
+	phost->SpiXferBytes += size;
+	return xfer;
+}
+
+/**
+ * @brief Queue the address header of a transaction
+ *
+ * @param phost Pointer to Hal context
+ * @param addr Address to read/write
+ * @param write True for a write transaction
+ * @param keepCs Keep chip select asserted into the next segment
+ */
+static inline void queueHeader(EVE_HalContext *phost, uint32_t addr, bool write, bool keepCs)
+{
+	uint8_t *header = &phost->SpiWrBuf[phost->SpiWrBufIndex];
+	header[0] = write ? ((addr >> 24) | 0x80) : ((addr >> 24) & 0xFF); /* MSB bits 10 for WRITE */
+	header[1] = (addr >> 16) & 0xFF;
+	header[2] = (addr >> 8) & 0xFF;
+	header[3] = addr & 0xFF;
+	phost->SpiWrBufIndex += LINUX_SPIDEV_HEADER_SIZE;
+	queueSegment(phost, header, NULL, LINUX_SPIDEV_HEADER_SIZE, keepCs);
+}
+
+/**
+ * @brief Read a block data from Coprocessor
+ *
+ * Each slice is queued behind any pending writes, so the writes and the read
+ * go out in the same SPI_IOC_MESSAGE.
+ *
+ * @param phost Pointer to Hal context
+ * @param buffer Buffer to get result
+ * @param size Number of bytes to read
+ * @return true True if ok
+ * @return false False if error
+ */
+static inline bool rdBuffer(EVE_HalContext *phost, uint8_t *buffer, uint32_t size)
+{
+	phost->Stats.BytesRead += size;
+	while (size)
+	{
+		uint32_t addr = phost->SpiRamGAddr;
+		uint32_t bytesPerRead = min(size, min((uint32_t)DATA_LENGTH, phost->SpiBufSize - LINUX_SPIDEV_HEADER_SIZE - POLLING_BYTES));
+		uint32_t bytesAligned = (bytesPerRead + 3) & ~3UL;
+		uint32_t bytesMessage = LINUX_SPIDEV_HEADER_SIZE + POLLING_BYTES + bytesAligned;
+		bool readyRecved = false;
+		uint8_t retry = 0;
+
+		while (!readyRecved)
+		{
+			if (!hasRoom(phost, 2, bytesMessage) && !flush(phost))
+				return false;
+
+			queueHeader(phost, addr, false, true);
+			queueSegment(phost, NULL, phost->SpiRdBuf, POLLING_BYTES + bytesAligned, false);
+			if (!flush(phost))
+				return false;
+
+			for (uint8_t i = 0; i < POLLING_BYTES; i++)
+			{
+				if (phost->SpiRdBuf[i] == 0x01)
+				{
+					readyRecved = true;
+					memcpy(buffer, &phost->SpiRdBuf[i + 1], bytesPerRead);
+					break;
+				}
+			}
+
+			if (!readyRecved && ++retry >= READ_TIMEOUT)
+			{
+				eve_printf_debug("Read ready byte not received from 0x%x\n", (unsigned int)addr);
+				return false;
+			}
+		}
+
+		buffer += bytesPerRead;
+		size -= bytesPerRead;
+		phost->SpiRamGAddr = incrementRamGAddr(phost, addr, bytesAligned);
+	}
+
+	return true;
+}
+
+/**
+ * @brief Write a block data to Coprocessor
+ *
+ * Data is appended to the open write segment, or to a new segment with its
+ * own address header. The message is only submitted when it is full.
+ *
+ * @param phost Pointer to Hal context
+ * @param buffer Data buffer to write
+ * @param size Size of buffer
+ * @return true True if ok
+ * @return false False if error
+ */
+static inline bool wrBuffer(EVE_HalContext *phost, const uint8_t *buffer, uint32_t size)
+{
+	phost->Stats.BytesWritten += size;
+	while (size)
+	{
+		struct spi_ioc_transfer *xfer;
+		uint32_t bytesPerWrite;
+
+		if (!phost->SpiWrOpen)
+		{
+			if (!hasRoom(phost, 1, LINUX_SPIDEV_HEADER_SIZE + 4) && !flush(phost))
+				return false;
+			queueHeader(phost, phost->SpiRamGAddr, true, false);
+			phost->SpiWrOpen = true;
+		}
+
+		bytesPerWrite = min(size, phost->SpiBufSize - phost->SpiXferBytes);
+		if (bytesPerWrite < size)
+			bytesPerWrite &= ~3UL;
+		if (!bytesPerWrite)
+		{
+			/* Message is full, submit and continue with a new header */
+			if (!flush(phost))
+				return false;
+			continue;
+		}
+
+		xfer = &phost->SpiXfer[phost->SpiXferCount - 1];
+		memcpy(&phost->SpiWrBuf[phost->SpiWrBufIndex], buffer, bytesPerWrite);
+		phost->SpiWrBufIndex += bytesPerWrite;
+		phost->SpiXferBytes += bytesPerWrite;
+		xfer->len += bytesPerWrite;
+
+		phost->SpiRamGAddr = incrementRamGAddr(phost, phost->SpiRamGAddr, bytesPerWrite);
+		buffer += bytesPerWrite;
+		size -= bytesPerWrite;
+	}
+
+	return true;
+}
+
+/**
+ * @brief Start data transfer to Coprocessor
+ *
+ * @param phost Pointer to Hal context
+ * @param rw Read or Write
+ * @param addr Address to read/write
+ */
+void EVE_Hal_startTransfer(EVE_HalContext *phost, EVE_TRANSFER_T rw, uint32_t addr)
+{
+	eve_assert(phost->Status == EVE_STATUS_OPENED);
+
+	++phost->Stats.Transfers;
+	if (rw == EVE_TRANSFER_READ || addr != phost->SpiRamGAddr)
+	{
+		/* Start a new segment, the open one stays queued */
+		phost->SpiWrOpen = false;
+		phost->SpiRamGAddr = addr;
+	}
+
+	if (phost->Status != EVE_STATUS_ERROR)
+	{
+		if (rw == EVE_TRANSFER_READ)
+			phost->Status = EVE_STATUS_READING;
+		else
+			phost->Status = EVE_STATUS_WRITING;
+	}
+}
+
+/**
+ * @brief End data transfer
+ *
+ * @param phost Pointer to Hal context
+ */
+void EVE_Hal_endTransfer(EVE_HalContext *phost)
+{
+	uint32_t addr;
+
+	eve_assert(phost->Status == EVE_STATUS_READING || phost->Status == EVE_STATUS_WRITING);
+
+	/* Transfers to FIFO and DL are kept open */
+	addr = phost->SpiRamGAddr;
+	if ((phost->Status == EVE_STATUS_WRITING)
+	    && (addr != REG_CMDB_WRITE)
+	    && !((addr >= RAM_CMD) && (addr < (RAM_CMD + EVE_CMD_FIFO_SIZE)))
+	    && !((addr >= RAM_DL) && (addr < (RAM_DL + EVE_DL_SIZE))))
+	{
+		flush(phost);
+	}
+
+	if (phost->Status != EVE_STATUS_ERROR)
+		phost->Status = EVE_STATUS_OPENED;
+}
+
+/**
+ * @brief Submit all queued segments in one SPI_IOC_MESSAGE
+ *
+ * @param phost Pointer to Hal context
+ * @return true True if ok
+ * @return false False if error
+ */
+static bool flush(EVE_HalContext *phost)
+{
+	bool res = true;
+	if (phost->SpiXferCount)
+	{
+		++phost->Stats.Flushes;
+		/* Release chip select at the end of the message */
+		phost->SpiXfer[phost->SpiXferCount - 1].cs_change = 0;
+		if (ioctl(phost->SpiFd, SPI_IOC_MESSAGE(phost->SpiXferCount), phost->SpiXfer) < 0)
+		{
+			eve_printf_debug("SPI_IOC_MESSAGE of %d segments failed, errno %d\n", (int)phost->SpiXferCount, errno);
+			phost->Status = EVE_STATUS_ERROR;
+			res = false;
+		}
+	}
+	phost->SpiXferCount = 0;
+	phost->SpiXferBytes = 0;
+	phost->SpiWrBufIndex = 0;
+	phost->SpiWrOpen = false;
+	return res;
+}
+
+/**
+ * @brief Flush data to Coprocessor
+ *
+ * @param phost Pointer to Hal context
+ */
+void EVE_Hal_flush(EVE_HalContext *phost)
+{
+	eve_assert(phost->Status == EVE_STATUS_OPENED);
+	flush(phost);
+}
+
+/**
+ * @brief Write 4 bytes to Coprocessor
+ *
+ * @param phost Pointer to Hal context
+ * @param value Value to write
+ * @return uint32_t Number of bytes transfered
+ */
+uint32_t EVE_Hal_transfer32(EVE_HalContext *phost, uint32_t value)
+{
+	uint8_t buffer[4];
+	if (phost->Status == EVE_STATUS_READING)
+	{
+		rdBuffer(phost, buffer, 4);
+		return (uint32_t)buffer[0]
+		    | (uint32_t)buffer[1] << 8
+		    | (uint32_t)buffer[2] << 16
+		    | (uint32_t)buffer[3] << 24;
+	}
+	else
+	{
+		buffer[0] = value & 0xFF;
+		buffer[1] = (value >> 8) & 0xFF;
+		buffer[2] = (value >> 16) & 0xFF;
+		buffer[3] = value >> 24;
+		wrBuffer(phost, buffer, 4);
+		return 0;
+	}
+}
+
+/**
+ * @brief Transfer (read/write) a block data to Coprocessor
+ *
+ * @param phost Pointer to Hal context
+ * @param result Buffer to get data transfered, NULL when write
+ * @param buffer Buffer where data is transfered, NULL when read
+ * @param size Size of buffer
+ */
+void EVE_Hal_transferMem(EVE_HalContext *phost, uint8_t *result, const uint8_t *buffer, uint32_t size)
+{
+	if (!size)
+		return;
+
+	if (result && buffer)
+	{
+		/* not implemented */
+		eve_debug_break();
+	}
+	else if (result)
+	{
+		rdBuffer(phost, result, size);
+	}
+	else if (buffer)
+	{
+		wrBuffer(phost, buffer, size);
+	}
+}
+
+/**
+ * @brief Reserve space for an ongoing write directly in the transfer buffer
+ *
+ * The space is appended to the open write segment, or to a new segment with
+ * its own address header.
+ *
+ * @param phost Pointer to Hal context
+ * @param size Number of bytes to reserve, multiple of 4
+ * @return uint8_t* Pointer into the write buffer, NULL if not available
+ */
+uint8_t *EVE_Hal_transferReserve(EVE_HalContext *phost, uint32_t size)
+{
+	eve_assert(phost->Status == EVE_STATUS_WRITING);
+	eve_assert(!(size & 3));
+
+	if (LINUX_SPIDEV_HEADER_SIZE + size > phost->SpiBufSize)
+		return NULL;
+	if (phost->SpiWrOpen && (phost->SpiXferBytes + size > phost->SpiBufSize) && !flush(phost))
+		return NULL;
+	if (!phost->SpiWrOpen)
+	{
+		if (!hasRoom(phost, 1, LINUX_SPIDEV_HEADER_SIZE + size) && !flush(phost))
+			return NULL;
+		queueHeader(phost, phost->SpiRamGAddr, true, false);
+		phost->SpiWrOpen = true;
+	}
+	return &phost->SpiWrBuf[phost->SpiWrBufIndex];
+}
+
+/**
+ * @brief Commit data written into space obtained from EVE_Hal_transferReserve
+ *
+ * @param phost Pointer to Hal context
+ * @param size Number of bytes written, multiple of 4
+ */
+void EVE_Hal_transferCommit(EVE_HalContext *phost, uint32_t size)
+{
+	eve_assert(!(size & 3));
+	eve_assert(phost->SpiWrOpen);
+	eve_assert(phost->SpiXferBytes + size <= phost->SpiBufSize);
+
+	phost->Stats.BytesWritten += size;
+	phost->SpiWrBufIndex += size;
+	phost->SpiXferBytes += size;
+	phost->SpiXfer[phost->SpiXferCount - 1].len += size;
+	phost->SpiRamGAddr = incrementRamGAddr(phost, phost->SpiRamGAddr, size);
+}
+
+/**
+ * @brief Transfer a string to EVE platform
+ *
+ * @param phost Pointer to Hal context
+ * @param str String to transfer
+ * @param index Start position in the string
+ * @param size Size of string
+ * @param padMask Padding mask
+ * @return uint32_t Numer of bytes transfered
+ */
+uint32_t EVE_Hal_transferString(EVE_HalContext *phost, const char *str, uint32_t index, uint32_t size, uint32_t padMask)
+{
+	uint32_t transferred;
+
+	if (!size)
+	{
+		/* TODO: Support different padding options */
+		eve_assert(padMask == 0x3);
+		EVE_Hal_transfer32(phost, 0);
+		return 4;
+	}
+
+	eve_assert(size <= EVE_CMD_STRING_MAX);
+	transferred = 0;
+	if (phost->Status == EVE_STATUS_WRITING)
+	{
+		uint8_t tail[4] = { 0 };
+		uint32_t length = EVE_Hal_stringLength(&str[index], size);
+		uint32_t aligned = length & ~0x3UL;
+
+		/* Whole words of characters, then the last characters with the terminator and padding as one word */
+		eve_assert(padMask <= 0x3);
+		transferred = (length + 1 + padMask) & ~padMask;
+		memcpy(tail, &str[index + aligned], length - aligned);
+		if (aligned)
+			wrBuffer(phost, (const uint8_t *)&str[index], aligned);
+		wrBuffer(phost, tail, transferred - aligned);
+	}
+	else
+	{
+		/* not implemented */
+		eve_debug_break();
+	}
+	return transferred;
+}
+///@}
+
+/************
+** UTILITY **
+************/
+
+/** @name UTILITY */
+///@{
+/**
+ * @brief This API sends a 5byte command to the phost
+ *
+ * @param phost Pointer to Hal context
+ * @param cmd Command to send
+ */
+void EVE_Hal_spiCommand(EVE_HalContext *phost, uint8_t *cmd)
+{
+	eve_assert(phost->Status == EVE_STATUS_OPENED);
+	eve_printf_debug("SPI cmd: 0x%x, 0x%x, 0x%x, 0x%x, 0x%x\n", cmd[0], cmd[1], cmd[2], cmd[3], cmd[4]);
+
+	flush(phost);
+	memcpy(phost->SpiWrBuf, cmd, 5);
+	queueSegment(phost, phost->SpiWrBuf, NULL, 5, false);
+	phost->SpiWrBufIndex += 5;
+	flush(phost);
+}
+
+/**
+ * @brief Set number of SPI channel
+ *
+ * @param phost Pointer to Hal context
+ * @param numchnls Number of channel
+ */
+static void setSPI(EVE_HalContext *phost, EVE_SPI_CHANNELS_T numchnls)
+{
+	uint32_t mode = SPI_MODE_0;
+
+	flush(phost);
+
+	/* switch spidev to relevant multi channel SPI communication mode */
+	if (numchnls == EVE_SPI_DUAL_CHANNEL)
+		mode |= SPI_TX_DUAL | SPI_RX_DUAL;
+	else if (numchnls == EVE_SPI_QUAD_CHANNEL)
+		mode |= SPI_TX_QUAD | SPI_RX_QUAD;
+
+	if (ioctl(phost->SpiFd, SPI_IOC_WR_MODE32, &mode) < 0)
+		eve_printf_debug("SPI_IOC_WR_MODE32 0x%x failed, errno %d\n", (unsigned int)mode, errno);
+
+	/* EVE switched to dual/quad mode, now update global HAL context */
+	phost->SpiChannels = numchnls;
+}
+
+/**
+ * @brief Toggle PD_N pin of BT820 board for a power cycle
+ *
+ * @param phost Pointer to Hal context
+ * @param up Up or Down
+ * @return true True if ok
+ * @return false False if error
+ */
+bool EVE_Hal_powerCycle(EVE_HalContext *phost, bool up)
+{
+	bool res = true;
+	flush(phost);
+
+	if (phost->PowerDownFd < 0)
+	{
+		eve_printf_debug("PD_N is not connected, skip power cycle\n");
+	}
+	else if (up)
+	{
+		res = writeLine(phost->PowerDownFd, 0) && res;
+		EVE_sleep(20);
+
+		res = writeLine(phost->PowerDownFd, 1) && res;
+		EVE_sleep(20);
+	}
+	else
+	{
+		res = writeLine(phost->PowerDownFd, 1) && res;
+		EVE_sleep(20);
+
+		res = writeLine(phost->PowerDownFd, 0) && res;
+		EVE_sleep(20);
+	}
+
+	/* Reset to single channel SPI mode */
+	setSPI(phost, EVE_SPI_SINGLE_CHANNEL);
+
+	return res;
+}
+
+/**
+ * @brief Set number of SPI channel
+ *
+ * @param phost Pointer to Hal context
+ * @param numchnls Number of channel
+ */
+void EVE_Hal_setSPI(EVE_HalContext *phost, EVE_SPI_CHANNELS_T numchnls)
+{
+	int32_t syscfg;
+
+	flush(phost);
+
+	if (numchnls > EVE_SPI_QUAD_CHANNEL)
+		return; // error
+
+	/* Fall back to the widest mode the kernel driver supports */
+	if (numchnls == EVE_SPI_QUAD_CHANNEL && !(phost->SpiModeCaps & SPI_TX_QUAD))
+		numchnls = EVE_SPI_DUAL_CHANNEL;
+	if (numchnls == EVE_SPI_DUAL_CHANNEL && !(phost->SpiModeCaps & SPI_TX_DUAL))
+		numchnls = EVE_SPI_SINGLE_CHANNEL;
+
+	/* Switch EVE to multi channel SPI mode */
+	EVE_Hal_startTransfer(phost, EVE_TRANSFER_READ, REG_SYS_CFG);
+	syscfg = EVE_Hal_transfer32(phost, 0);
+	EVE_Hal_endTransfer(phost);
+	syscfg &= ~(SPI_WIDTH_2bit | SPI_WIDTH_4bit);
+	if (numchnls == EVE_SPI_DUAL_CHANNEL)
+	{
+		syscfg |= SPI_WIDTH_2bit;
+	}
+	else if (numchnls == EVE_SPI_QUAD_CHANNEL)
+	{
+		syscfg |= SPI_WIDTH_4bit;
+	}
+	EVE_Hal_startTransfer(phost, EVE_TRANSFER_WRITE, REG_SYS_CFG);
+	EVE_Hal_transfer32(phost, syscfg);
+	EVE_Hal_endTransfer(phost);
+
+	/* Switch spidev to multi channel SPI mode */
+	setSPI(phost, numchnls);
+}
+
+/**
+ * @brief Restore platform to previously configured EVE SPI channel mode
+ *
+ * @param phost Pointer to Hal context
+ */
+void EVE_Hal_restoreSPI(EVE_HalContext *phost)
+{
+	flush(phost);
+	setSPI(phost, phost->SpiChannels);
+}
+
+/**
+ * @brief Change the SPI clock
+ *
+ * The kernel driver may round the clock down to what the controller supports.
+ *
+ * @param phost Pointer to Hal context
+ * @param clockKHz Requested clock rate in kHz
+ * @return uint32_t Configured clock rate in kHz
+ */
+uint32_t EVE_Hal_setSPIClock(EVE_HalContext *phost, uint32_t clockKHz)
+{
+	uint32_t speed = clockKHz * 1000;
+
+	flush(phost);
+	if (ioctl(phost->SpiFd, SPI_IOC_WR_MAX_SPEED_HZ, &speed) < 0)
+	{
+		eve_printf_debug("Set SPI clock %d kHz failed, errno %d\n", (int)clockKHz, errno);
+		return phost->SpiClockrateKHz;
+	}
+	ioctl(phost->SpiFd, SPI_IOC_RD_MAX_SPEED_HZ, &speed);
+	phost->SpiClockrateKHz = speed / 1000;
+	return phost->SpiClockrateKHz;
+}
+
+/**
+ * @brief Get interrupt status
+ *
+ * @param phost Pointer to Hal context
+ * @return True on interrupt happened or otherwise
+ */
+bool EVE_Hal_getInterrupt(EVE_HalContext *phost)
+{
+	struct gpiohandle_data data;
+
+	if (phost->InterruptFd < 0)
+		return false;
+
+	memset(&data, 0, sizeof(data));
+	if (ioctl(phost->InterruptFd, GPIOHANDLE_GET_LINE_VALUES_IOCTL, &data) < 0)
+		return false;
+
+	/* INT_N is active low */
+	return data.values[0] == 0;
+}
+///@}
+
+#endif /* #if defined(LINUX_SPIDEV_PLATFORM) */
+
+/* end of file */
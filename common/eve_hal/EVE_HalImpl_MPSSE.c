@@ -29,6 +29,7 @@
  * SOFTWARE.
 */
 
+#define EVE_HALIMPL_TRANSPORT
 #include "EVE_HalImpl.h"
 #if defined(MPSSE_PLATFORM)
 
@@ -43,9 +44,20 @@
 #define LIBMPSSE_MAX_RD_BYTES_PER_CALL_IN_MULTI_CH 65535
 #define LIBMPSSE_MAX_WR_BYTES_PER_CALL_IN_MULTI_CH 65532 /**< 3 bytes for FT81x memory address to which data to be written */
 
-#define POLLING_BYTES 8 // 4 byte align
+#define POLLING_BYTES EVE_MPSSE_POLLING_BYTES
 #define READ_TIMEOUT 5
-#define DATA_LENGTH 1024
+
+#if EVE_ASYNC_WRITES
+/* Each half of SpiWrBuf is filled in turn, while the other half is written in the background */
+#define MPSSE_WRBUF_SIZE (sizeof(((EVE_HalContext *)0)->SpiWrBuf) / 2)
+#define MPSSE_WRBUF(phost) (&(phost)->SpiWrBuf[(phost)->SpiWrHalf * MPSSE_WRBUF_SIZE])
+
+static bool flush(EVE_HalContext *phost);
+static bool writePacket(EVE_HalContext *phost, uint32_t addr, uint8_t *buffer, uint32_t size);
+#else
+#define MPSSE_WRBUF_SIZE (sizeof(((EVE_HalContext *)0)->SpiWrBuf))
+#define MPSSE_WRBUF(phost) ((phost)->SpiWrBuf)
+#endif
 
 /*********
 ** INIT **
@@ -146,6 +158,20 @@ bool EVE_HalImpl_defaults(EVE_HalParameters *parameters, size_t deviceIdx)
 	return res;
 }
 
+/**
+ * @brief Fill the SPI channel configuration
+ * 
+ * @param channelConf Channel configuration
+ * @param clockKHz SPI clock rate in kHz
+ */
+static void channelConfig(ChannelConfig *channelConf, uint32_t clockKHz)
+{
+	channelConf->ClockRate = clockKHz * 1000;
+	channelConf->LatencyTimer = 2;
+	channelConf->configOptions = SPI_CONFIG_OPTION_MODE0 | SPI_CONFIG_OPTION_CS_DBUS3 | SPI_CONFIG_OPTION_CS_ACTIVELOW;
+	channelConf->Pin = 0x00008080; /* FinalVal-FinalDir-InitVal-InitDir (for dir 0=in, 1=out) */ /* !!! Critical setting for system to power on */
+}
+
 /**
  * @brief Opens a new HAL context using the specified parameters
  * 
@@ -161,10 +187,7 @@ bool EVE_HalImpl_open(EVE_HalContext *phost, const EVE_HalParameters *parameters
 	ChannelConfig channelConf; /* channel configuration */
 
 	/* configure the spi settings */
-	channelConf.ClockRate = parameters->SpiClockrateKHz * 1000;
-	channelConf.LatencyTimer = 2;
-	channelConf.configOptions = SPI_CONFIG_OPTION_MODE0 | SPI_CONFIG_OPTION_CS_DBUS3 | SPI_CONFIG_OPTION_CS_ACTIVELOW;
-	channelConf.Pin = 0x00008080; /* FinalVal-FinalDir-InitVal-InitDir (for dir 0=in, 1=out) */ /* !!! Critical setting for system to power on */
+	channelConfig(&channelConf, parameters->SpiClockrateKHz);
 
 	phost->SpiClockrateKHz = parameters->SpiClockrateKHz;
 	phost->MpsseChannelNo = parameters->MpsseChannelNo;
@@ -267,6 +290,11 @@ bool EVE_HalImpl_open(EVE_HalContext *phost, const EVE_HalParameters *parameters
 	}
 #endif
 
+#if EVE_ASYNC_WRITES
+	/* Falls back to synchronous writes if the worker cannot be started */
+	EVE_AsyncWrite_start(phost, writePacket);
+#endif
+
 	return true;
 }
 
@@ -277,6 +305,10 @@ bool EVE_HalImpl_open(EVE_HalContext *phost, const EVE_HalParameters *parameters
  */
 void EVE_HalImpl_close(EVE_HalContext *phost)
 {
+#if EVE_ASYNC_WRITES
+	flush(phost);
+	EVE_AsyncWrite_stop(phost);
+#endif
 	phost->Status = EVE_STATUS_CLOSED;
 	--g_HalPlatform.OpenedDevices;
 	if (phost->GpioHandle != phost->SpiHandle)
@@ -329,7 +361,7 @@ static inline uint32_t incrementRamGAddr(EVE_HalContext *phost, uint32_t addr, u
 }
 
 /**
- * @brief Read a block data from Coprocessor
+ * @brief Read from the SPI bus, within the ongoing read transaction
  * 
  * @param phost Pointer to Hal context
  * @param buffer Buffer to get result
@@ -337,62 +369,171 @@ static inline uint32_t incrementRamGAddr(EVE_HalContext *phost, uint32_t addr, u
  * @return true True if ok
  * @return false False if error
  */
-static inline bool rdBuffer(EVE_HalContext *phost, uint8_t *buffer, uint32_t size)
+static bool spiRead(EVE_HalContext *phost, uint8_t *buffer, uint32_t size)
 {
-	uint32_t sizeRemaining = size;
-	if (sizeRemaining & 3)
+	uint32_t sizeTransferred = 0;
+	FT_STATUS status = SPI_Read(phost->SpiHandle, buffer, size, &sizeTransferred, SPI_TRANSFER_OPTIONS_SIZE_IN_BYTES);
+	if ((status != FT_OK) || (sizeTransferred != size))
 	{
-		sizeRemaining = (sizeRemaining + 3) & ~3UL;
-		eve_printf_debug("Data size should be align to 4 bytes\n");
+		eve_printf_debug("SPI_Read failed, sizeTransferred is %d with status %d\n", (int)sizeTransferred, (int)status);
+		if (sizeTransferred != size)
+			phost->Status = EVE_STATUS_ERROR;
+		return false;
 	}
+	return true;
+}
 
-	while (sizeRemaining)
-	{
-		uint32_t sizeTransferred = 0;
-		uint32_t bytesPerRead;
-		bool readyRecved = false;
-		uint8_t retry = 0;
-		uint8_t buff1[DATA_LENGTH + POLLING_BYTES] = { 0 };
+/**
+ * @brief Poll for the read ready byte, and read the first block of data
+ * 
+ * The device sends dummy bytes after the address until the data is ready,
+ * marked by a 0x01 byte. Data which is received past the requested size is
+ * kept for the next read of the transaction.
+ * 
+ * @param phost Pointer to Hal context
+ * @param buffer Buffer to get result
+ * @param size Number of bytes to read, at most EVE_MPSSE_FIRST_READ
+ * @return true True if ok
+ * @return false False if error
+ */
+static bool rdReady(EVE_HalContext *phost, uint8_t *buffer, uint32_t size)
+{
+	uint8_t buff1[POLLING_BYTES + EVE_MPSSE_FIRST_READ];
+	uint32_t bytesPerRead = (size + 3) & ~3UL;
+	uint8_t retry;
 
-		if (sizeRemaining <= DATA_LENGTH)
-			bytesPerRead = sizeRemaining;
-		else
-			bytesPerRead = DATA_LENGTH;
+	eve_assert(size <= EVE_MPSSE_FIRST_READ);
+	for (retry = 0; retry < READ_TIMEOUT; ++retry)
+	{
+		if (!spiRead(phost, buff1, bytesPerRead + POLLING_BYTES))
+			return false;
 
-		while (1)
+		for (uint8_t i = 0; i < POLLING_BYTES; i++)
 		{
-			FT_STATUS status = SPI_Read(phost->SpiHandle, buff1, bytesPerRead + POLLING_BYTES, &sizeTransferred, SPI_TRANSFER_OPTIONS_SIZE_IN_BYTES);
-			if ((status != FT_OK) || (sizeTransferred != (POLLING_BYTES + bytesPerRead)))
+			if (buff1[i] == 0x01)
 			{
-				eve_printf_debug("SPI_Read failed, sizeTransferred is %d with status %d\n", sizeTransferred, status);
-				if (sizeTransferred != (POLLING_BYTES + bytesPerRead))
-					phost->Status = EVE_STATUS_ERROR;
-				return false;
+				uint32_t received = bytesPerRead + POLLING_BYTES - (i + 1);
+				memcpy(buffer, &buff1[i + 1], size);
+				phost->SpiRdCarrySize = (uint8_t)(received - size);
+				memcpy(phost->SpiRdCarry, &buff1[i + 1 + size], phost->SpiRdCarrySize);
+				phost->SpiRdReady = true;
+				return true;
 			}
+		}
+	}
 
-			for (uint8_t i = 0; i < POLLING_BYTES; i++)
-			{
-				if (buff1[i] == 0x01)
-				{
-					readyRecved = true;
-					memcpy(buffer, &buff1[i + 1], bytesPerRead); /* Prepare the SFN to be modified */
-					sizeTransferred = bytesPerRead;
-					break;
-				}
-			}
-			if (readyRecved)
-				break;
+	eve_printf_debug("Read ready byte not received\n");
+	return false;
+}
 
-			retry++;
-			if (retry >= READ_TIMEOUT)
+/**
+ * @brief Read a block data from Coprocessor
+ * 
+ * Readiness is polled once per read transaction. After that, the data is
+ * streamed straight into the buffer in blocks of up to EVE_MPSSE_BULK_READ.
+ * 
+ * @param phost Pointer to Hal context
+ * @param buffer Buffer to get result
+ * @param size Number of bytes to read
+ * @return true True if ok
+ * @return false False if error
+ */
+static inline bool rdBuffer(EVE_HalContext *phost, uint8_t *buffer, uint32_t size)
+{
+	if (!phost->SpiRdReady)
+	{
+		uint32_t bytesPerRead = min(size, EVE_MPSSE_FIRST_READ);
+		if (!rdReady(phost, buffer, bytesPerRead))
+			return false;
+		buffer += bytesPerRead;
+		size -= bytesPerRead;
+	}
+
+	while (size)
+	{
+		uint32_t bytesPerRead;
+		if (phost->SpiRdCarrySize)
+		{
+			/* Data received ahead by the previous read */
+			bytesPerRead = min(size, phost->SpiRdCarrySize);
+			memcpy(buffer, phost->SpiRdCarry, bytesPerRead);
+			phost->SpiRdCarrySize -= (uint8_t)bytesPerRead;
+			memmove(phost->SpiRdCarry, &phost->SpiRdCarry[bytesPerRead], phost->SpiRdCarrySize);
+		}
+		else if (size >= 4)
+		{
+			bytesPerRead = min(size & ~3UL, EVE_MPSSE_BULK_READ);
+			if (!spiRead(phost, buffer, bytesPerRead))
+				return false;
+		}
+		else
+		{
+			/* Keep the transfer word aligned */
+			if (!spiRead(phost, phost->SpiRdCarry, 4))
 				return false;
+			phost->SpiRdCarrySize = 4;
+			continue;
 		}
+		buffer += bytesPerRead;
+		size -= bytesPerRead;
+	}
+
+	return true;
+}
+
+#if defined(EVE_BUFFER_WRITES)
+/**
+ * @brief Write a HOST MEMORY WRITE transaction
+ * 
+ * Called on the background write worker when EVE_ASYNC_WRITES is enabled
+ * 
+ * @param phost Pointer to Hal context
+ * @param addr Address to write
+ * @param buffer Data to write
+ * @param size Size of data
+ * @return true True if ok
+ * @return false False if error
+ */
+static bool writePacket(EVE_HalContext *phost, uint32_t addr, uint8_t *buffer, uint32_t size)
+{
+	uint32_t sizeTransferred;
+	uint8_t hrdpkt[8];
+	FT_STATUS status;
+	uint32_t sizeRemaining;
+
+	/* Compose the HOST MEMORY WRITE packet */
+	hrdpkt[0] = (addr >> 24) | 0x80; /* MSB bit 1 for WRITE */
+	hrdpkt[1] = (addr >> 16) & 0xFF;
+	hrdpkt[2] = (addr >> 8) & 0xFF;
+	hrdpkt[3] = addr & 0xFF;
+
+	status = SPI_Write((FT_HANDLE)phost->SpiHandle, hrdpkt, 4, &sizeTransferred, SPI_TRANSFER_OPTIONS_SIZE_IN_BYTES | SPI_TRANSFER_OPTIONS_CHIPSELECT_ENABLE);
+
+	if ((status != FT_OK) || (sizeTransferred != 4))
+	{
+		eve_printf_debug("%d SPI_Write failed, sizeTransferred is %d with status %d\n", __LINE__, sizeTransferred, (int)status);
+		return false;
+	}
+
+	sizeRemaining = size;
+	while (sizeRemaining)
+	{
+		uint32_t transferSize = min(0xFFFF, sizeRemaining);
+		status = SPI_Write(phost->SpiHandle, (uint8 *)buffer, transferSize, &sizeTransferred,
+		    (transferSize == sizeRemaining) ? (SPI_TRANSFER_OPTIONS_SIZE_IN_BYTES | SPI_TRANSFER_OPTIONS_CHIPSELECT_DISABLE) : SPI_TRANSFER_OPTIONS_SIZE_IN_BYTES);
 		sizeRemaining -= sizeTransferred;
 		buffer += sizeTransferred;
+
+		if (status != FT_OK || !sizeTransferred)
+		{
+			eve_printf_debug("%d SPI_Write failed, sizeTransferred is %d with status %d\n", __LINE__, sizeTransferred, (int)status);
+			return false;
+		}
 	}
 
 	return true;
 }
+#endif
 
 /**
  * @brief Write a block data to Coprocessor
@@ -411,10 +552,10 @@ static inline bool wrBuffer(EVE_HalContext *phost, const uint8_t *buffer, uint32
 		size = (size + 3) & ~3UL;
 		eve_printf_debug("Data size should be align to 4 bytes\n");
 	}
-	if (buffer && (size < (sizeof(phost->SpiWrBuf) - phost->SpiWrBufIndex)))
+	if (buffer && (size < (MPSSE_WRBUF_SIZE - phost->SpiWrBufIndex)))
 	{
 		/* Write to buffer */
-		memcpy(&phost->SpiWrBuf[phost->SpiWrBufIndex], buffer, size);
+		memcpy(&MPSSE_WRBUF(phost)[phost->SpiWrBufIndex], buffer, size);
 		phost->SpiWrBufIndex += size;
 		return true;
 	}
@@ -427,60 +568,44 @@ static inline bool wrBuffer(EVE_HalContext *phost, const uint8_t *buffer, uint32
 				return false;
 
 			/* Write to buffer */
-			if (size < sizeof(phost->SpiWrBuf))
+			if (size < MPSSE_WRBUF_SIZE)
 				return wrBuffer(phost, buffer, size);
 		}
 
 		if (buffer || phost->SpiWrBufIndex)
 		{
-			uint32_t sizeTransferred;
-			uint8_t hrdpkt[8];
 			uint32_t addr = phost->SpiRamGAddr;
-			FT_STATUS status;
-			uint32_t sizeRemaining;
 
 			if (!buffer)
 			{
 				/* Flushing */
-				buffer = phost->SpiWrBuf;
+				buffer = MPSSE_WRBUF(phost);
 				size = phost->SpiWrBufIndex;
 				phost->SpiWrBufIndex = 0;
 			}
 
-			/* Compose the HOST MEMORY WRITE packet */
-			hrdpkt[0] = (addr >> 24) | 0x80; /* MSB bit 1 for WRITE */
-			hrdpkt[1] = (addr >> 16) & 0xFF;
-			hrdpkt[2] = (addr >> 8) & 0xFF;
-			hrdpkt[3] = addr & 0xFF;
-
-			status = SPI_Write((FT_HANDLE)phost->SpiHandle, hrdpkt, 4, &sizeTransferred, SPI_TRANSFER_OPTIONS_SIZE_IN_BYTES | SPI_TRANSFER_OPTIONS_CHIPSELECT_ENABLE);
-
-			if ((status != FT_OK) || (sizeTransferred != 4))
+#if EVE_ASYNC_WRITES
+			while (size)
 			{
-				eve_printf_debug("%d SPI_Write failed, sizeTransferred is %d with status %d\n", __LINE__, sizeTransferred, (int)status);
-				if (sizeTransferred != 4)
-					phost->Status = EVE_STATUS_ERROR;
-				return false;
+				/* Written in the background, while the other half is being filled */
+				uint8_t *packet = MPSSE_WRBUF(phost);
+				uint32_t packetSize = min(size, MPSSE_WRBUF_SIZE);
+				if (buffer != packet)
+					memcpy(packet, buffer, packetSize);
+				EVE_AsyncWrite_submit(phost, addr, packet, packetSize);
+				phost->SpiWrHalf ^= 1;
+				buffer += packetSize;
+				size -= packetSize;
+				addr = incrementRamGAddr(phost, addr, packetSize);
 			}
-
-			sizeRemaining = size;
-			while (sizeRemaining)
+#else
+			if (!writePacket(phost, addr, (uint8_t *)buffer, size))
 			{
-				uint32_t transferSize = min(0xFFFF, sizeRemaining);
-				FT_STATUS status = SPI_Write(phost->SpiHandle, (uint8 *)buffer, transferSize, &sizeTransferred,
-				    (transferSize == sizeRemaining) ? (SPI_TRANSFER_OPTIONS_SIZE_IN_BYTES | SPI_TRANSFER_OPTIONS_CHIPSELECT_DISABLE) : SPI_TRANSFER_OPTIONS_SIZE_IN_BYTES);
-				sizeRemaining -= sizeTransferred;
-				buffer += sizeTransferred;
-
-				if (status != FT_OK || !sizeTransferred)
-				{
-					eve_printf_debug("%d SPI_Write failed, sizeTransferred is %d with status %d\n", __LINE__, sizeTransferred, (int)status);
-					phost->Status = EVE_STATUS_ERROR;
-					return false;
-				}
+				phost->Status = EVE_STATUS_ERROR;
+				return false;
 			}
-
 			addr = incrementRamGAddr(phost, addr, size);
+#endif
 			phost->SpiRamGAddr = addr;
 		}
 
@@ -521,11 +646,32 @@ static bool flush(EVE_HalContext *phost)
 	bool res = true;
 	if (phost->SpiWrBufIndex)
 	{
+		++phost->Stats.Flushes;
 		res = wrBuffer(phost, NULL, 0);
 	}
 	eve_assert(!phost->SpiWrBufIndex);
 	return res;
 }
+
+/**
+ * @brief Flush data to Coprocessor, and wait until all data is written
+ * 
+ * @param phost Pointer to Hal context
+ * @return true True if ok
+ * @return false False if error
+ */
+static bool flushSync(EVE_HalContext *phost)
+{
+	bool res = flush(phost);
+#if EVE_ASYNC_WRITES
+	if (!EVE_AsyncWrite_wait(phost))
+	{
+		phost->Status = EVE_STATUS_ERROR;
+		res = false;
+	}
+#endif
+	return res;
+}
 #endif
 
 /**
@@ -537,7 +683,7 @@ void EVE_Hal_flush(EVE_HalContext *phost)
 {
 	eve_assert(phost->Status == EVE_STATUS_OPENED);
 #if defined(EVE_BUFFER_WRITES)
-	flush(phost);
+	flushSync(phost);
 #endif
 }
 
@@ -551,9 +697,16 @@ void EVE_Hal_flush(EVE_HalContext *phost)
 void EVE_Hal_startTransfer(EVE_HalContext *phost, EVE_TRANSFER_T rw, uint32_t addr)
 {
 	eve_assert(phost->Status == EVE_STATUS_OPENED);
+	++phost->Stats.Transfers;
 
 #if defined(EVE_BUFFER_WRITES)
-	if (addr != incrementRamGAddr(phost, phost->SpiRamGAddr, phost->SpiWrBufIndex) || rw == EVE_TRANSFER_READ)
+	if (rw == EVE_TRANSFER_READ)
+	{
+		/* Reads must observe all previous writes */
+		flushSync(phost);
+		phost->SpiRamGAddr = addr;
+	}
+	else if (addr != incrementRamGAddr(phost, phost->SpiRamGAddr, phost->SpiWrBufIndex))
 	{
 		/* Close any write transfer that was left open, if the address changed */
 		flush(phost);
@@ -577,6 +730,8 @@ void EVE_Hal_startTransfer(EVE_HalContext *phost, EVE_TRANSFER_T rw, uint32_t ad
 		transferArray[3] = addr & 0xFF;
 
 		SPI_Write((FT_HANDLE)phost->SpiHandle, transferArray, 4, &sizeTransferred, SPI_TRANSFER_OPTIONS_SIZE_IN_BYTES | SPI_TRANSFER_OPTIONS_CHIPSELECT_ENABLE);
+		phost->SpiRdReady = false;
+		phost->SpiRdCarrySize = 0;
 
 		if (phost->Status != EVE_STATUS_ERROR)
 			phost->Status = EVE_STATUS_READING;
@@ -668,6 +823,7 @@ uint32_t EVE_Hal_transfer32(EVE_HalContext *phost, uint32_t value)
 	uint8_t buffer[4];
 	if (phost->Status == EVE_STATUS_READING)
 	{
+		phost->Stats.BytesRead += 4;
 		rdBuffer(phost, buffer, 4);
 		return (uint32_t)buffer[0]
 		    | (uint32_t)buffer[1] << 8
@@ -680,6 +836,7 @@ uint32_t EVE_Hal_transfer32(EVE_HalContext *phost, uint32_t value)
 		buffer[1] = (value >> 8) & 0xFF;
 		buffer[2] = (value >> 16) & 0xFF;
 		buffer[3] = value >> 24;
+		phost->Stats.BytesWritten += 4;
 		wrBuffer(phost, buffer, 4);
 		return 0;
 	}
@@ -705,14 +862,58 @@ void EVE_Hal_transferMem(EVE_HalContext *phost, uint8_t *result, const uint8_t *
 	}
 	else if (result)
 	{
+		phost->Stats.BytesRead += size;
 		rdBuffer(phost, result, size);
 	}
 	else if (buffer)
 	{
+		phost->Stats.BytesWritten += size;
 		wrBuffer(phost, buffer, size);
 	}
 }
 
+/**
+ * @brief Reserve space for an ongoing write directly in the transfer buffer
+ * 
+ * @param phost Pointer to Hal context
+ * @param size Number of bytes to reserve, multiple of 4
+ * @return uint8_t* Pointer into the write buffer, NULL if not available
+ */
+uint8_t *EVE_Hal_transferReserve(EVE_HalContext *phost, uint32_t size)
+{
+	eve_assert(phost->Status == EVE_STATUS_WRITING);
+	eve_assert(!(size & 3));
+
+#if defined(EVE_BUFFER_WRITES)
+	if (size >= MPSSE_WRBUF_SIZE)
+		return NULL;
+	if ((size >= (MPSSE_WRBUF_SIZE - phost->SpiWrBufIndex)) && !flush(phost))
+		return NULL;
+	return &MPSSE_WRBUF(phost)[phost->SpiWrBufIndex];
+#else
+	/* Writes go straight to the device */
+	return NULL;
+#endif
+}
+
+/**
+ * @brief Commit data written into space obtained from EVE_Hal_transferReserve
+ * 
+ * @param phost Pointer to Hal context
+ * @param size Number of bytes written, multiple of 4
+ */
+void EVE_Hal_transferCommit(EVE_HalContext *phost, uint32_t size)
+{
+	eve_assert(!(size & 3));
+#if defined(EVE_BUFFER_WRITES)
+	eve_assert(size < (MPSSE_WRBUF_SIZE - phost->SpiWrBufIndex));
+	phost->Stats.BytesWritten += size;
+	phost->SpiWrBufIndex += size;
+#else
+	eve_assert(!size);
+#endif
+}
+
 /**
  * @brief Transfer a string to EVE platform
  * 
@@ -739,33 +940,18 @@ uint32_t EVE_Hal_transferString(EVE_HalContext *phost, const char *str, uint32_t
 	transferred = 0;
 	if (phost->Status == EVE_STATUS_WRITING)
 	{
-		uint8_t buffer[EVE_CMD_STRING_MAX + 1];
-
-		for (;;)
-		{
-			char c = str[index + (transferred)];
-			buffer[transferred++] = c;
-			// putchar(c ? c : '_');
-			if (!c)
-			{
-				break;
-			}
-			if (transferred >= size)
-			{
-				buffer[transferred++] = 0;
-				// putchar('_');
-				break;
-			}
-		}
-		while (transferred & padMask)
-		{
-			buffer[transferred++] = 0;
-			// putchar('_');
-		}
-
-		eve_assert(transferred);
-
-		wrBuffer(phost, buffer, transferred);
+		uint8_t tail[4] = { 0 };
+		uint32_t length = EVE_Hal_stringLength(&str[index], size);
+		uint32_t aligned = length & ~0x3UL;
+
+		/* Whole words of characters, then the last characters with the terminator and padding as one word */
+		eve_assert(padMask <= 0x3);
+		transferred = (length + 1 + padMask) & ~padMask;
+		memcpy(tail, &str[index + aligned], length - aligned);
+		if (aligned)
+			wrBuffer(phost, (const uint8_t *)&str[index], aligned);
+		wrBuffer(phost, tail, transferred - aligned);
+		phost->Stats.BytesWritten += transferred;
 	}
 	else
 	{
@@ -802,7 +988,7 @@ void EVE_Hal_spiCommand(EVE_HalContext *phost, uint8_t *cmd)
 	transferArray[4] = cmd[4];
 
 #if defined(EVE_BUFFER_WRITES)
-	flush(phost);
+	flushSync(phost);
 #endif
 	SPI_Write(phost->SpiHandle, transferArray, sizeof(transferArray), &sizeTransferred, SPI_TRANSFER_OPTIONS_SIZE_IN_BYTES | SPI_TRANSFER_OPTIONS_CHIPSELECT_ENABLE | SPI_TRANSFER_OPTIONS_CHIPSELECT_DISABLE);
 }
@@ -831,7 +1017,7 @@ static FT_STATUS EVE_HalImpl_passthroughGpio(EVE_HalContext *phost, uint8_t gpio
 	recvArray[1] = 0;
 
 #if defined(EVE_BUFFER_WRITES)
-	flush(phost);
+	flushSync(phost);
 #endif
 	do
 	{
@@ -868,7 +1054,7 @@ bool EVE_Hal_powerCycle(EVE_HalContext *phost, bool up)
 	DWORD dwNumBytesSent;
 	eve_assert(phost->PowerDownPin < 8 || phost->PowerDownPin & 0x80);
 #if defined(EVE_BUFFER_WRITES)
-	flush(phost);
+	flushSync(phost);
 #endif
 	if (up)
 	{
@@ -973,7 +1159,7 @@ bool EVE_Hal_powerCycle(EVE_HalContext *phost, bool up)
 void EVE_Hal_setSPI(EVE_HalContext *phost, EVE_SPI_CHANNELS_T numchnls)
 {
 #if defined(EVE_BUFFER_WRITES)
-	flush(phost);
+	flushSync(phost);
 #endif
 	/* no-op */
 }
@@ -981,11 +1167,40 @@ void EVE_Hal_setSPI(EVE_HalContext *phost, EVE_SPI_CHANNELS_T numchnls)
 void EVE_Hal_restoreSPI(EVE_HalContext *phost)
 {
 #if defined(EVE_BUFFER_WRITES)
-	flush(phost);
+	flushSync(phost);
 #endif
 	/* no-op */
 }
 
+/**
+ * @brief Change the SPI clock
+ * 
+ * Reinitializes the channel with the new clock.
+ * 
+ * @param phost Pointer to Hal context
+ * @param clockKHz Requested clock rate in kHz
+ * @return uint32_t Configured clock rate in kHz
+ */
+uint32_t EVE_Hal_setSPIClock(EVE_HalContext *phost, uint32_t clockKHz)
+{
+	ChannelConfig channelConf;
+	FT_STATUS status;
+
+#if defined(EVE_BUFFER_WRITES)
+	flushSync(phost);
+#endif
+	channelConfig(&channelConf, clockKHz);
+	status = SPI_InitChannel((FT_HANDLE)phost->SpiHandle, &channelConf);
+	if (FT_OK != status)
+	{
+		eve_printf_debug("SPI init channel failed %d\n", (int)status);
+		phost->Status = EVE_STATUS_ERROR;
+		return phost->SpiClockrateKHz;
+	}
+	phost->SpiClockrateKHz = (uint16_t)clockKHz;
+	return clockKHz;
+}
+
 /**
  * @brief Get interrupt status
  * ADBUS5 is connected with interrupt pin which is low active
@@ -1001,6 +1216,11 @@ bool EVE_Hal_getInterrupt(EVE_HalContext *phost)
 
 	// read GPIO status
 	BYTE command = 0x81; // 0x81 = Read Low byte GPIO (ADBUS)
+#if EVE_ASYNC_WRITES
+	/* GPIO shares the channel with the background writes */
+	if (phost->GpioHandle == phost->SpiHandle && !EVE_AsyncWrite_wait(phost))
+		phost->Status = EVE_STATUS_ERROR;
+#endif
 	status = FT_Write(phost->GpioHandle, &command, 1, &dwNumBytesSent);
 	if (status != FT_OK)
 	{
@@ -28,7 +28,9 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
  * SOFTWARE.
  */
+#define EVE_HALIMPL_TRANSPORT
 #include "EVE_HalImpl.h"
+#include "EVE_HalDma.h"
 #if defined(RP2040_PLATFORM)
 
 bool EVE_Hal_NoInit = false;
@@ -36,6 +38,14 @@ bool EVE_Hal_NoInit = false;
 #define READ_TIMEOUT 5
 
 void setSPI(EVE_HalContext *phost, EVE_SPI_CHANNELS_T numchnls);
+static bool flushSync(EVE_HalContext *phost);
+
+#if EVE_DMA_WRITES
+/* DMA engine of each SPI port */
+static EVE_HalDma s_SpiDma[2];
+static bool dmaStart(EVE_HalDma *dma, const uint8_t *packet, uint32_t size);
+static bool dmaWait(EVE_HalDma *dma);
+#endif
 
 /** @name INIT */
 ///@{
@@ -105,8 +115,19 @@ bool EVE_HalImpl_open(EVE_HalContext *phost, const EVE_HalParameters *parameters
 	gpio_put(phost->PowerDownPin, 0);
 
 	/* Initialize single channel */
+	phost->SpiClockrateKHz = EVE_DEFAULT_RP2040_CLOCKRATE_KHZ;
 	setSPI(phost, EVE_SPI_SINGLE_CHANNEL);
 
+#if EVE_DMA_WRITES
+	/* Writes are sent by a DMA channel, paced by the SPI transmit FIFO */
+	EVE_HalDma *dma = &s_SpiDma[parameters->DeviceIdx ? 1 : 0];
+	phost->SpiDmaChannel = dma_claim_unused_channel(true);
+	dma->Start = dmaStart;
+	dma->Wait = dmaWait;
+	dma->UserContext = phost;
+	EVE_HalDma_attach(phost, dma);
+#endif
+
 	gpio_put(phost->PowerDownPin, 1);
 
 	/* Initialize the context variables */
@@ -123,6 +144,10 @@ bool EVE_HalImpl_open(EVE_HalContext *phost, const EVE_HalParameters *parameters
 void EVE_HalImpl_close(EVE_HalContext *phost)
 {
 	size_t deviceIdx = phost->SpiPort == spi1 ? 1 : 0;
+#if EVE_DMA_WRITES
+	flushSync(phost);
+	dma_channel_unclaim(phost->SpiDmaChannel);
+#endif
 	phost->Status = EVE_STATUS_CLOSED;
 	spi_deinit(phost->SpiPort);
 }
@@ -155,6 +180,73 @@ static inline void csDeselect(EVE_HalContext *phost)
 	asm volatile("nop \n nop \n nop");
 }
 
+#if EVE_DMA_WRITES
+/**
+ * @brief Select the chip and start sending a write packet by DMA
+ *
+ * @param dma DMA engine of the SPI port
+ * @param packet Header followed by the data
+ * @param size Size of the packet
+ * @return true True if ok
+ * @return false False if error
+ */
+static bool dmaStart(EVE_HalDma *dma, const uint8_t *packet, uint32_t size)
+{
+	EVE_HalContext *phost = dma->UserContext;
+	spi_inst_t *spi = phost->SpiPort;
+	dma_channel_config config = dma_channel_get_default_config(phost->SpiDmaChannel);
+	channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+	channel_config_set_dreq(&config, spi_get_dreq(spi, true));
+	channel_config_set_read_increment(&config, true);
+	channel_config_set_write_increment(&config, false);
+
+	csSelect(phost);
+	dma_channel_configure(phost->SpiDmaChannel, &config, &spi_get_hw(spi)->dr, packet, size, true);
+	return true;
+}
+
+/**
+ * @brief Wait until the packet is sent, and deselect the chip
+ *
+ * @param dma DMA engine of the SPI port
+ * @return true True if ok
+ * @return false False if error
+ */
+static bool dmaWait(EVE_HalDma *dma)
+{
+	EVE_HalContext *phost = dma->UserContext;
+	spi_inst_t *spi = phost->SpiPort;
+
+	dma_channel_wait_for_finish_blocking(phost->SpiDmaChannel);
+	while (spi_is_busy(spi))
+		tight_loop_contents();
+
+	/* Drop the bytes received while sending, the same as spi_write_blocking */
+	while (spi_is_readable(spi))
+		(void)spi_get_hw(spi)->dr;
+	spi_get_hw(spi)->icr = SPI_SSPICR_RORIC_BITS;
+
+	csDeselect(phost);
+	return true;
+}
+#endif
+
+/**
+ * @brief Send the buffered writes, and wait until they are written
+ *
+ * @param phost Pointer to Hal context
+ * @return true True if ok
+ * @return false False if error
+ */
+static bool flushSync(EVE_HalContext *phost)
+{
+#if EVE_DMA_WRITES
+	return EVE_HalDma_flush(phost) && EVE_HalDma_wait(phost);
+#else
+	return true;
+#endif
+}
+
 // -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 
 /**
@@ -168,9 +260,13 @@ void EVE_Hal_startTransfer(EVE_HalContext *phost, EVE_TRANSFER_T rw, uint32_t ad
 {
 	eve_assert(phost->Status == EVE_STATUS_OPENED);
 
+	++phost->Stats.Transfers;
 	if (rw == EVE_TRANSFER_READ)
 	{
 		uint8_t spidata[4];
+		/* Reads must observe all previous writes */
+		if (!flushSync(phost))
+			return;
 		spidata[0] = (addr >> 24) & 0xFF;
 		spidata[1] = (addr >> 16) & 0xFF;
 		spidata[2] = (addr >> 8) & 0xFF;
@@ -181,6 +277,12 @@ void EVE_Hal_startTransfer(EVE_HalContext *phost, EVE_TRANSFER_T rw, uint32_t ad
 	}
 	else
 	{
+#if EVE_DMA_WRITES
+		/* The header is composed when the packet is sent */
+		EVE_HalDma_startWrite(phost, addr);
+		if (phost->Status == EVE_STATUS_ERROR)
+			return;
+#else
 		uint8_t spidata[4];
 		spidata[0] = (addr >> 24) | 0x80;
 		spidata[1] = (addr >> 16) & 0xFF;
@@ -189,6 +291,7 @@ void EVE_Hal_startTransfer(EVE_HalContext *phost, EVE_TRANSFER_T rw, uint32_t ad
 
 		csSelect(phost);
 		spi_write_blocking(phost->SpiPort, spidata, 4);
+#endif
 
 		phost->Status = EVE_STATUS_WRITING;
 	}
@@ -203,7 +306,18 @@ void EVE_Hal_endTransfer(EVE_HalContext *phost)
 {
 	eve_assert(phost->Status == EVE_STATUS_READING || phost->Status == EVE_STATUS_WRITING);
 
-	csDeselect(phost);
+#if EVE_DMA_WRITES
+	if (phost->Status == EVE_STATUS_WRITING)
+	{
+		EVE_HalDma_endWrite(phost);
+		if (phost->Status == EVE_STATUS_ERROR)
+			return;
+	}
+	else
+#endif
+	{
+		csDeselect(phost);
+	}
 	phost->Status = EVE_STATUS_OPENED;
 }
 
@@ -215,7 +329,7 @@ void EVE_Hal_endTransfer(EVE_HalContext *phost)
 void EVE_Hal_flush(EVE_HalContext *phost)
 {
 	eve_assert(phost->Status == EVE_STATUS_OPENED);
-	/* no-op */
+	flushSync(phost);
 }
 
 /**
@@ -233,6 +347,7 @@ static inline bool rdBuffer(EVE_HalContext *phost, uint8_t *buffer, uint32_t siz
 	uint8_t retry = 0;
 	bool readyRecved = false;
 	uint8_t sizeTransferred;
+	phost->Stats.BytesRead += size;
 	if (size & 3)
 	{
 		size = (size + 3) & ~3UL;
@@ -276,7 +391,12 @@ static inline bool rdBuffer(EVE_HalContext *phost, uint8_t *buffer, uint32_t siz
  */
 static inline void wrBuffer(EVE_HalContext *phost, const uint8_t *buffer, uint32_t size)
 {
+	phost->Stats.BytesWritten += size;
+#if EVE_DMA_WRITES
+	EVE_HalDma_write(phost, buffer, size);
+#else
 	spi_write_blocking(phost->SpiPort, buffer, size);
+#endif
 }
 
 /**
@@ -336,6 +456,40 @@ void EVE_Hal_transferMem(EVE_HalContext *phost, uint8_t *result, const uint8_t *
 	}
 }
 
+/**
+ * @brief Reserve space for an ongoing write directly in the transfer buffer
+ *
+ * @param phost Pointer to Hal context
+ * @param size Number of bytes to reserve, multiple of 4
+ * @return uint8_t* Pointer into the write buffer, NULL if not available
+ */
+uint8_t *EVE_Hal_transferReserve(EVE_HalContext *phost, uint32_t size)
+{
+	eve_assert(phost->Status == EVE_STATUS_WRITING);
+#if EVE_DMA_WRITES
+	return EVE_HalDma_reserve(phost, size);
+#else
+	/* Writes go straight to the SPI peripheral */
+	return NULL;
+#endif
+}
+
+/**
+ * @brief Commit data written into space obtained from EVE_Hal_transferReserve
+ *
+ * @param phost Pointer to Hal context
+ * @param size Number of bytes written, multiple of 4
+ */
+void EVE_Hal_transferCommit(EVE_HalContext *phost, uint32_t size)
+{
+#if EVE_DMA_WRITES
+	phost->Stats.BytesWritten += size;
+	EVE_HalDma_commit(phost, size);
+#else
+	eve_assert(!size);
+#endif
+}
+
 /**
  * @brief Transfer a string to EVE platform
  *
@@ -360,17 +514,17 @@ uint32_t EVE_Hal_transferString(EVE_HalContext *phost, const char *str, uint32_t
 	uint32_t transferred = 0;
 	if (phost->Status == EVE_STATUS_WRITING)
 	{
-		transferred += (uint32_t)strnlen(str, size) + 1;
-		eve_assert(str[transferred - 1] == '\0');
-		wrBuffer(phost, (uint8_t *)str, transferred);
-		if (transferred & padMask)
-		{
-			uint32_t pad = 4 - (transferred & padMask);
-			uint8_t padding[4] = { 0 };
-			wrBuffer(phost, padding, pad);
-			transferred += pad;
-			eve_assert(!(transferred & 0x3));
-		}
+		uint8_t tail[4] = { 0 };
+		uint32_t length = EVE_Hal_stringLength(&str[index], size);
+		uint32_t aligned = length & ~0x3UL;
+
+		/* Whole words of characters, then the last characters with the terminator and padding as one word */
+		eve_assert(padMask <= 0x3);
+		transferred = (length + 1 + padMask) & ~padMask;
+		memcpy(tail, &str[index + aligned], length - aligned);
+		if (aligned)
+			wrBuffer(phost, (const uint8_t *)&str[index], aligned);
+		wrBuffer(phost, tail, transferred - aligned);
 	}
 	else
 	{
@@ -395,6 +549,7 @@ void EVE_Hal_spiCommand(EVE_HalContext* phost, uint8_t* cmd)
 	eve_assert(phost->Status == EVE_STATUS_OPENED);
 	eve_printf_debug("SPI cmd: 0x%x, 0x%x, 0x%x, 0x%x, 0x%x\n", cmd[0], cmd[1], cmd[2], cmd[3], cmd[4]);
 
+	flushSync(phost);
 	csSelect(phost);
 	spi_write_blocking(phost->SpiPort, cmd, 5);
 	csDeselect(phost);
@@ -443,8 +598,14 @@ bool EVE_Hal_powerCycle(EVE_HalContext *phost, bool up)
  */
 void setSPI(EVE_HalContext *phost, EVE_SPI_CHANNELS_T numchnls)
 {
-	/* SPI initialisation. This will use SPI at 25MHz */
-	spi_init(phost->SpiPort, 25 * 1000 * 1000);
+#if EVE_DMA_WRITES
+	/* Not during open, before the engine is attached */
+	if (phost->Dma)
+		flushSync(phost);
+#endif
+
+	/* SPI initialisation, at the configured clock (25MHz by default) */
+	phost->SpiClockrateKHz = spi_init(phost->SpiPort, phost->SpiClockrateKHz * 1000) / 1000;
 	gpio_set_function(phost->SpiMisoPin, GPIO_FUNC_SPI);
 	gpio_set_function(phost->SpiMosiPin, GPIO_FUNC_SPI);
 	gpio_set_function(phost->SpiSckPin, GPIO_FUNC_SPI);
@@ -476,6 +637,22 @@ void EVE_Hal_restoreSPI(EVE_HalContext *phost)
 	setSPI(phost, phost->SpiChannels);
 }
 
+/**
+ * @brief Change the SPI clock
+ *
+ * The clock is derived from the peripheral clock, the closest lower rate is used.
+ *
+ * @param phost Pointer to Hal context
+ * @param clockKHz Requested clock rate in kHz
+ * @return uint32_t Configured clock rate in kHz
+ */
+uint32_t EVE_Hal_setSPIClock(EVE_HalContext *phost, uint32_t clockKHz)
+{
+	flushSync(phost);
+	phost->SpiClockrateKHz = spi_set_baudrate(phost->SpiPort, clockKHz * 1000) / 1000;
+	return phost->SpiClockrateKHz;
+}
+
 /**
  * @brief Get interrupt status
  * 
@@ -487,7 +664,7 @@ bool EVE_Hal_getInterrupt(EVE_HalContext *phost)
 	//INT# connected to GPIO6
 #define EVE_INT 6
 	bool value = gpio_get(EVE_INT);
-	return (~value);
+	return !value; /* INT_N is active low */
 }
 ///@}
 
@@ -524,6 +701,7 @@ void EVE_Mcu_release()
 
 /* Globals for interrupt implementation */
 static absolute_time_t s_LastTime;
+static absolute_time_t s_StartTime;
 static uint64_t s_TotalMilliseconds64;
 static int32_t s_RemainderMicros;
 
@@ -536,6 +714,7 @@ static int32_t s_RemainderMicros;
 void EVE_Millis_initialize()
 {
 	s_LastTime = get_absolute_time();
+	s_StartTime = s_LastTime;
 	s_TotalMilliseconds64 = 0;
 	s_RemainderMicros = 0;
 }
@@ -592,6 +771,16 @@ uint64_t EVE_millis64()
 	return s_TotalMilliseconds64;
 }
 
+/**
+ * @brief Get clock in microsecond
+ *
+ * @return uint64_t Clock number
+ */
+uint64_t EVE_micros64()
+{
+	return (uint64_t)absolute_time_diff_us(s_StartTime, get_absolute_time());
+}
+
 /**
  * @brief Sleep in milisecond
  *
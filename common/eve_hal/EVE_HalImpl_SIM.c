@@ -0,0 +1,1339 @@
+/**
+ * @file EVE_HalImpl_SIM.c
+ * @brief Eve_Hal framework APIs for the in-process BT820 device model
+ *
+ * The coprocessor decodes the fixed words of the commands the EVE_CoCmd
+ * functions write, the strings of the widget commands, and the inline data
+ * of CMD_MEMWRITE, CMD_FLASHWRITE and CMD_FLASHSPITX. The length of other
+ * inline data, such as CMD_LOADIMAGE and CMD_INFLATE without OPT_MEDIAFIFO
+ * or OPT_FLASH, and of commands it does not know, is not known. Decoding
+ * stops after them, and their words are consumed as opaque words until the
+ * command FIFO is empty. A command which is still being written when the
+ * FIFO runs empty may then have its remaining words decoded as commands.
+ * Commands with OPT_FORMAT arguments are handled the same way.
+ *
+ * @author Bridgetek
+ *
+ * @date 2025
+ *
+ * MIT License
+ *
+ * Copyright (c) [2025] [Bridgetek Pte Ltd (BRTChip)]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define EVE_HALIMPL_TRANSPORT
+#include "EVE_HalImpl.h"
+#include "EVE_HalDma.h"
+#if defined(SIM_PLATFORM)
+
+/* Offset of a core address into the model's backing block */
+#define SIM_CORE(addr) ((addr) - BASE)
+
+/* Frame rate reported through REG_FRAMES, scan out is not modelled */
+#define SIM_FRAME_MICROS 16667
+
+/* Part of a command which follows its fixed words */
+#define SIM_TAIL_NONE 0
+#define SIM_TAIL_STRING 1 /* Up to the word holding the terminator */
+#define SIM_TAIL_OPAQUE 2 /* Length not known, not decoded until the FIFO is empty */
+
+static uint32_t s_CrcTable[256];
+
+static bool flushSync(EVE_HalContext *phost);
+#if EVE_DMA_WRITES
+static bool dmaSink(void *sinkContext, uint32_t addr, const uint8_t *data, uint32_t size);
+#endif
+
+/** @name INIT */
+///@{
+/**
+ * @brief Initialize HAL platform
+ *
+ */
+void EVE_HalImpl_initialize()
+{
+	/* CRC-32 as used by CMD_MEMCRC */
+	for (uint32_t i = 0; i < 256; ++i)
+	{
+		uint32_t c = i;
+		for (int k = 0; k < 8; ++k)
+			c = (c & 1) ? (0xEDB88320UL ^ (c >> 1)) : (c >> 1);
+		s_CrcTable[i] = c;
+	}
+}
+
+/**
+ * @brief Release HAL platform
+ *
+ */
+void EVE_HalImpl_release()
+{
+	/* no-op */
+}
+
+/**
+ * @brief Get the default configuration parameters
+ *
+ * @param parameters EVE_Hal framework's parameters
+ * @param deviceIdx Unused, there is one model per context
+ * @return true True if ok
+ * @return false False if error
+ */
+bool EVE_HalImpl_defaults(EVE_HalParameters *parameters, size_t deviceIdx)
+{
+	(void)deviceIdx;
+	parameters->SimRamGSize = EVE_DEFAULT_SIM_RAM_G_SIZE;
+	parameters->SimCmdRateKBps = EVE_DEFAULT_SIM_CMD_RATE_KBPS;
+	parameters->SimMediaFifoRateKBps = EVE_DEFAULT_SIM_MEDIAFIFO_RATE_KBPS;
+	parameters->SimSpiClockMaxKHz = 0;
+	return true;
+}
+
+static inline uint32_t get32(const uint8_t *p)
+{
+	return (uint32_t)p[0]
+	    | (uint32_t)p[1] << 8
+	    | (uint32_t)p[2] << 16
+	    | (uint32_t)p[3] << 24;
+}
+
+static inline void put32(uint8_t *p, uint32_t value)
+{
+	p[0] = value & 0xFF;
+	p[1] = (value >> 8) & 0xFF;
+	p[2] = (value >> 16) & 0xFF;
+	p[3] = value >> 24;
+}
+
+/**
+ * @brief Get the backing storage of a register or core memory address
+ *
+ * @param phost Pointer to Hal context
+ * @param addr Address outside RAM_G
+ * @return uint8_t* Backing byte, NULL if the address is not modelled
+ */
+static inline uint8_t *simReg(EVE_HalContext *phost, uint32_t addr)
+{
+	if (addr >= BASE && addr < BASE + EVE_SIM_CORE_SIZE)
+		return &phost->SimCore[SIM_CORE(addr)];
+	if (addr >= EVE_SIM_PERIPH_BASE && addr < EVE_SIM_PERIPH_BASE + EVE_SIM_PERIPH_SIZE)
+		return &phost->SimPeriph[addr - EVE_SIM_PERIPH_BASE];
+	return NULL;
+}
+
+static inline uint32_t getReg(EVE_HalContext *phost, uint32_t addr)
+{
+	return get32(simReg(phost, addr));
+}
+
+static inline void setReg(EVE_HalContext *phost, uint32_t addr, uint32_t value)
+{
+	put32(simReg(phost, addr), value);
+}
+
+/**
+ * @brief Get a contiguous range of RAM_G
+ *
+ * @param phost Pointer to Hal context
+ * @param addr Address in RAM_G
+ * @param size Number of bytes
+ * @return uint8_t* Backing memory, NULL if the range is outside the modelled RAM_G
+ */
+static inline uint8_t *simRamG(EVE_HalContext *phost, uint32_t addr, uint32_t size)
+{
+	if (addr < phost->SimRamGSize && size <= phost->SimRamGSize - addr)
+		return &phost->SimRamG[addr];
+	return NULL;
+}
+
+/**
+ * @brief Reset the model to its power-on state
+ *
+ * @param phost Pointer to Hal context
+ * @param up Power state after the reset
+ * @return true True if ok
+ * @return false False if RAM_G could not be allocated
+ */
+static bool simReset(EVE_HalContext *phost, bool up)
+{
+	memset(phost->SimCore, 0, sizeof(phost->SimCore));
+	memset(phost->SimPeriph, 0, sizeof(phost->SimPeriph));
+
+	/* Fresh zeroed pages, RAM_G is only committed where it is touched */
+	free(phost->SimRamG);
+	phost->SimRamG = calloc(1, phost->SimRamGSize);
+	if (!phost->SimRamG)
+	{
+		eve_printf_debug("Allocate %d bytes of RAM_G for the device model failed\n", (int)phost->SimRamGSize);
+		return false;
+	}
+
+	phost->SimMediaFifoBase = 0;
+	phost->SimMediaFifoSize = 0;
+	phost->SimPayloadAddr = 0;
+	phost->SimPayloadRemaining = 0;
+	phost->SimPayloadStore = 0;
+	phost->SimCmdTail = SIM_TAIL_NONE;
+	phost->SimCmdCredit = 0;
+	phost->SimMediaFifoCredit = 0;
+	phost->SimMicros = EVE_micros64();
+	phost->SimBootMicros = phost->SimMicros;
+
+	if (up)
+	{
+		setReg(phost, REG_ID, 0x7C);
+		setReg(phost, REG_FREQUENCY, SYS_CLK_FREQ);
+		setReg(phost, REG_CHIP_ID, (EVE_CHIPID & 0xFFFF) << 16);
+		setReg(phost, REG_BOOT_STATUS, 0x522e2e2e);
+		setReg(phost, REG_FLASH_STATUS, FLASH_STATUS_DETACHED);
+	}
+	return true;
+}
+
+/**
+ * @brief Opens a new HAL context using the specified parameters
+ *
+ * @param phost Pointer to Hal context
+ * @param parameters EVE_Hal framework's parameters
+ * @return true True if ok
+ * @return false False if error
+ */
+bool EVE_HalImpl_open(EVE_HalContext *phost, const EVE_HalParameters *parameters)
+{
+	phost->SimRamGSize = parameters->SimRamGSize ? parameters->SimRamGSize : EVE_DEFAULT_SIM_RAM_G_SIZE;
+	if (!simReset(phost, false))
+		return false;
+	phost->SimCmdRateKBps = parameters->SimCmdRateKBps;
+	phost->SimMediaFifoRateKBps = parameters->SimMediaFifoRateKBps;
+	phost->SpiClockrateKHz = EVE_DEFAULT_SIM_SPI_CLOCKRATE_KHZ;
+	phost->SimSpiClockMaxKHz = parameters->SimSpiClockMaxKHz;
+
+	eve_printf_debug("Open device model, RAM_G %d bytes, command FIFO %d kB/s, media FIFO %d kB/s\n",
+	    (int)phost->SimRamGSize, (int)phost->SimCmdRateKBps, (int)phost->SimMediaFifoRateKBps);
+
+	phost->SpiChannels = EVE_SPI_SINGLE_CHANNEL;
+
+#if EVE_DMA_WRITES
+	/* Writes go through the packets, which the synchronous mock engine hands to the model */
+	{
+		EVE_HalDmaMock *mock = malloc(sizeof(EVE_HalDmaMock));
+		if (!mock)
+		{
+			free(phost->SimRamG);
+			phost->SimRamG = NULL;
+			return false;
+		}
+		EVE_HalDma_attach(phost, EVE_HalDma_initMock(mock, dmaSink, phost));
+	}
+#endif
+
+	phost->Status = EVE_STATUS_OPENED;
+	++g_HalPlatform.OpenedDevices;
+
+	return true;
+}
+
+/**
+ * @brief Close a HAL context
+ *
+ * @param phost Pointer to Hal context
+ */
+void EVE_HalImpl_close(EVE_HalContext *phost)
+{
+#if EVE_DMA_WRITES
+	flushSync(phost);
+	free(phost->Dma->UserContext);
+	phost->Dma = NULL;
+#endif
+	phost->Status = EVE_STATUS_CLOSED;
+	--g_HalPlatform.OpenedDevices;
+
+	free(phost->SimRamG);
+	phost->SimRamG = NULL;
+	phost->SimRamGSize = 0;
+}
+///@}
+
+/*****************
+** DEVICE MODEL **
+*****************/
+
+/** @name DEVICE MODEL */
+///@{
+
+/**
+ * @brief Write bytes into RAM_G, or word by word into registers
+ *
+ * @param phost Pointer to Hal context
+ * @param addr Start address
+ * @param buffer Data to write
+ * @param size Number of bytes
+ * @return uint32_t Address following the written data
+ */
+static uint32_t simWrite(EVE_HalContext *phost, uint32_t addr, const uint8_t *buffer, uint32_t size);
+
+/**
+ * @brief Compute the CRC-32 of a RAM_G range
+ *
+ * @param phost Pointer to Hal context
+ * @param ptr Start address
+ * @param num Number of bytes
+ * @return uint32_t CRC, 0 if the range is not modelled
+ */
+static uint32_t simCrc(EVE_HalContext *phost, uint32_t ptr, uint32_t num)
+{
+	const uint8_t *p = simRamG(phost, ptr, num);
+	uint32_t crc = 0xFFFFFFFFUL;
+
+	if (!p)
+	{
+		eve_printf_debug("Device model CMD_MEMCRC outside RAM_G, 0x%x\n", (unsigned int)ptr);
+		return 0;
+	}
+
+	while (num--)
+		crc = s_CrcTable[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+	return crc ^ 0xFFFFFFFFUL;
+}
+
+/**
+ * @brief Number of fixed words the model consumes at once for a command
+ *
+ * Strings and inline data which follow are consumed afterwards, see
+ * SimCmdTail and SimPayloadRemaining.
+ *
+ * @param cmd First word of the command
+ * @return uint32_t Number of words, including the command and its result slots, 0 for an unknown command
+ */
+static uint32_t cmdWords(uint32_t cmd)
+{
+	switch (cmd)
+	{
+	case CMD_DLSTART:
+	case CMD_SWAP:
+	case CMD_COLDSTART:
+	case CMD_LOADIDENTITY:
+	case CMD_SETMATRIX:
+	case CMD_STOP:
+	case CMD_SCREENSAVER:
+	case CMD_LOGO:
+	case CMD_NOP:
+	case CMD_RESETFONTS:
+	case CMD_GRAPHICSFINISH:
+	case CMD_SYNC:
+	case CMD_TESTCARD:
+	case CMD_RETURN:
+	case CMD_ENDLIST:
+	case CMD_FENCE:
+	case CMD_FLASHERASE:
+	case CMD_FLASHDETACH:
+	case CMD_FLASHATTACH:
+	case CMD_FLASHSPIDESEL:
+		return 1;
+	case CMD_FLASHFAST:
+	case CMD_GETPTR:
+	case CMD_INTERRUPT:
+	case CMD_BGCOLOR:
+	case CMD_FGCOLOR:
+	case CMD_GRADCOLOR:
+	case CMD_ROTATE:
+	case CMD_SETROTATE:
+	case CMD_SETBASE:
+	case CMD_SETSCRATCH:
+	case CMD_SNAPSHOT:
+	case CMD_ANIMSTOP:
+	case CMD_ANIMDRAW:
+	case CMD_CALLLIST:
+	case CMD_NEWLIST:
+	case CMD_COPYLIST:
+	case CMD_FILLWIDTH:
+	case CMD_WAIT:
+	case CMD_VIDEOSTART:
+	case CMD_FLASHSOURCE:
+	case CMD_FLASHSPITX:
+	case CMD_FSOPTION:
+	case CMD_WATCHDOG:
+	case CMD_CALIBRATE:
+	case CMD_PLAYVIDEO:
+	case CMD_PLAYWAV:
+		return 2;
+	case CMD_MEMWRITE:
+	case CMD_MEMZERO:
+	case CMD_REGREAD:
+	case CMD_REGWRITE:
+	case CMD_MEDIAFIFO:
+	case CMD_TEXT:
+	case CMD_APPEND:
+	case CMD_APPENDF:
+	case CMD_TRANSLATE:
+	case CMD_SCALE:
+	case CMD_SPINNER:
+	case CMD_ROMFONT:
+	case CMD_RUNANIM:
+	case CMD_ANIMXY:
+	case CMD_VIDEOFRAME:
+	case CMD_GLOW:
+	case CMD_FLASHWRITE:
+	case CMD_FLASHSPIRX:
+	case CMD_INFLATE:
+	case CMD_LOADIMAGE:
+	case CMD_LOADWAV:
+	case CMD_LOADASSET:
+		return 3;
+	case CMD_MEMSET:
+	case CMD_MEMCPY:
+	case CMD_MEMCRC:
+	case CMD_GETPROPS:
+	case CMD_BUTTON:
+	case CMD_KEYS:
+	case CMD_TOGGLE:
+	case CMD_NUMBER:
+	case CMD_ARC:
+	case CMD_DIAL:
+	case CMD_TRACK:
+	case CMD_SETFONT:
+	case CMD_SETBITMAP:
+	case CMD_ANIMSTART:
+	case CMD_ANIMFRAME:
+	case CMD_RENDERTARGET:
+	case CMD_CALIBRATESUB:
+	case CMD_FLASHREAD:
+	case CMD_FLASHUPDATE:
+	case CMD_FLASHPROGRAM:
+		return 4;
+	case CMD_CLOCK:
+	case CMD_GAUGE:
+	case CMD_GRADIENT:
+	case CMD_GRADIENTA:
+	case CMD_PROGRESS:
+	case CMD_SCROLLBAR:
+	case CMD_SLIDER:
+	case CMD_ROTATEAROUND:
+	case CMD_WAITCOND:
+	case CMD_SKETCH:
+		return 5;
+	case CMD_GETIMAGE:
+	case CMD_SKIPCOND:
+	case CMD_CGRADIENT:
+		return 6;
+	case CMD_GETMATRIX:
+		return 7;
+	case CMD_BITMAP_TRANSFORM:
+		return 14;
+	default:
+		/* Display list instructions are single words */
+		return ((cmd & 0xFFFFFF00UL) == 0xFFFFFF00UL) ? 0 : 1;
+	}
+}
+
+/**
+ * @brief What follows a string or inline data option
+ *
+ * @param options Options of the command
+ * @param inlineTail Tail when the data is inline
+ * @return uint8_t SIM_TAIL_NONE when the data comes from elsewhere
+ */
+static inline uint8_t cmdDataTail(uint32_t options, uint8_t inlineTail)
+{
+	return (options & (OPT_MEDIAFIFO | OPT_FLASH | OPT_FS)) ? SIM_TAIL_NONE : inlineTail;
+}
+
+/**
+ * @brief Execute a complete command from the command FIFO
+ *
+ * @param phost Pointer to Hal context
+ * @param rp Offset of the command in RAM_CMD
+ * @param cmd First word of the command
+ */
+static void cmdExecute(EVE_HalContext *phost, uint32_t rp, uint32_t cmd)
+{
+	uint8_t *ramCmd = &phost->SimCore[SIM_CORE(RAM_CMD)];
+	uint32_t arg[13];
+	uint8_t value[4];
+	uint32_t words = cmdWords(cmd);
+	uint8_t *dst;
+	const uint8_t *src;
+
+	for (uint32_t i = 1; i < words; ++i)
+		arg[i - 1] = get32(&ramCmd[(rp + (i << 2)) & EVE_CMD_FIFO_MASK]);
+
+	switch (cmd)
+	{
+	case CMD_DLSTART:
+		setReg(phost, REG_CMD_DL, 0);
+		break;
+	case CMD_SWAP:
+		setReg(phost, REG_INT_FLAGS, getReg(phost, REG_INT_FLAGS) | (1 << INT_SWAP));
+		++phost->SimSwaps;
+		break;
+	case CMD_INTERRUPT:
+		setReg(phost, REG_INT_FLAGS, getReg(phost, REG_INT_FLAGS) | (1 << INT_CMDFLAG));
+		break;
+	case CMD_MEMWRITE:
+		/* Inline data follows, padded to 4 bytes */
+		phost->SimPayloadAddr = arg[0];
+		phost->SimPayloadStore = arg[1];
+		phost->SimPayloadRemaining = (arg[1] + 3) & ~3UL;
+		break;
+	case CMD_MEMSET:
+		if ((dst = simRamG(phost, arg[0], arg[2])))
+			memset(dst, (uint8_t)arg[1], arg[2]);
+		break;
+	case CMD_MEMZERO:
+		if ((dst = simRamG(phost, arg[0], arg[1])))
+			memset(dst, 0, arg[1]);
+		break;
+	case CMD_MEMCPY:
+		dst = simRamG(phost, arg[0], arg[2]);
+		src = simRamG(phost, arg[1], arg[2]);
+		if (dst && src)
+			memmove(dst, src, arg[2]);
+		break;
+	case CMD_MEMCRC:
+		put32(&ramCmd[(rp + 12) & EVE_CMD_FIFO_MASK], simCrc(phost, arg[0], arg[1]));
+		break;
+	case CMD_REGREAD:
+		dst = simReg(phost, arg[0] & ~3UL);
+		put32(&ramCmd[(rp + 8) & EVE_CMD_FIFO_MASK], dst ? get32(dst) : 0);
+		break;
+	case CMD_REGWRITE:
+		put32(value, arg[1]);
+		simWrite(phost, arg[0], value, 4);
+		break;
+	case CMD_MEDIAFIFO:
+		phost->SimMediaFifoBase = arg[0];
+		phost->SimMediaFifoSize = arg[1];
+		setReg(phost, REG_MEDIAFIFO_READ, 0);
+		setReg(phost, REG_MEDIAFIFO_WRITE, 0);
+		break;
+	case CMD_FLASHATTACH:
+		if (getReg(phost, REG_FLASH_STATUS) == FLASH_STATUS_DETACHED)
+			setReg(phost, REG_FLASH_STATUS, FLASH_STATUS_BASIC);
+		break;
+	case CMD_FLASHDETACH:
+		setReg(phost, REG_FLASH_STATUS, FLASH_STATUS_DETACHED);
+		break;
+	case CMD_FLASHWRITE:
+		/* Inline data follows, not modelled */
+		phost->SimPayloadStore = 0;
+		phost->SimPayloadRemaining = (arg[1] + 3) & ~3UL;
+		break;
+	case CMD_FLASHSPITX:
+		phost->SimPayloadStore = 0;
+		phost->SimPayloadRemaining = (arg[0] + 3) & ~3UL;
+		break;
+	case CMD_TEXT:
+		phost->SimCmdTail = (arg[1] & (OPT_FORMAT << 16)) ? SIM_TAIL_OPAQUE : SIM_TAIL_STRING;
+		break;
+	case CMD_BUTTON:
+	case CMD_KEYS:
+		phost->SimCmdTail = (arg[2] & (OPT_FORMAT << 16)) ? SIM_TAIL_OPAQUE : SIM_TAIL_STRING;
+		break;
+	case CMD_TOGGLE:
+		phost->SimCmdTail = (arg[2] & OPT_FORMAT) ? SIM_TAIL_OPAQUE : SIM_TAIL_STRING;
+		break;
+	case CMD_PLAYVIDEO:
+	case CMD_PLAYWAV:
+		phost->SimCmdTail = cmdDataTail(arg[0], SIM_TAIL_OPAQUE);
+		break;
+	case CMD_INFLATE:
+	case CMD_LOADIMAGE:
+	case CMD_LOADWAV:
+	case CMD_LOADASSET:
+		phost->SimCmdTail = cmdDataTail(arg[1], SIM_TAIL_OPAQUE);
+		break;
+	case CMD_FLASHFAST:
+		setReg(phost, REG_FLASH_STATUS, FLASH_STATUS_FULL);
+		/* fall through */
+	case CMD_GETPTR:
+	case CMD_GETPROPS:
+	case CMD_GETIMAGE:
+	case CMD_GETMATRIX:
+		/* Results are not modelled, report zeros */
+		for (uint32_t i = 1; i < words; ++i)
+			put32(&ramCmd[(rp + (i << 2)) & EVE_CMD_FIFO_MASK], 0);
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * @brief Let the coprocessor consume the command FIFO
+ *
+ * @param phost Pointer to Hal context
+ * @param budget Maximum number of bytes to consume
+ * @return uint32_t Number of bytes consumed
+ */
+static uint32_t cmdConsume(EVE_HalContext *phost, uint32_t budget)
+{
+	uint8_t *ramCmd = &phost->SimCore[SIM_CORE(RAM_CMD)];
+	uint32_t rp = getReg(phost, REG_CMD_READ) & EVE_CMD_FIFO_MASK;
+	uint32_t wp = getReg(phost, REG_CMD_WRITE) & EVE_CMD_FIFO_MASK;
+	uint32_t consumed = 0;
+
+	budget &= ~3UL;
+	while (budget)
+	{
+		uint32_t avail = ((wp - rp) & EVE_CMD_FIFO_MASK) & ~3UL;
+		uint32_t bytes;
+
+		if (!avail)
+			break;
+
+		if (phost->SimPayloadRemaining)
+		{
+			/* Inline data of CMD_MEMWRITE */
+			uint32_t store;
+
+			bytes = min(min(avail, budget), phost->SimPayloadRemaining);
+			bytes = min(bytes, EVE_CMD_FIFO_SIZE - rp);
+			store = min(bytes, phost->SimPayloadStore);
+			if (store)
+				phost->SimPayloadAddr = simWrite(phost, phost->SimPayloadAddr, &ramCmd[rp], store);
+			phost->SimPayloadStore -= store;
+			phost->SimPayloadRemaining -= bytes;
+		}
+		else if (phost->SimCmdTail)
+		{
+			bytes = 4;
+			if (phost->SimCmdTail == SIM_TAIL_STRING)
+			{
+				uint32_t word = get32(&ramCmd[rp]);
+				if (!(word & 0xFFUL) || !(word & 0xFF00UL) || !(word & 0xFF0000UL) || !(word & 0xFF000000UL))
+					phost->SimCmdTail = SIM_TAIL_NONE; /* Terminator */
+			}
+			else if (avail == 4)
+			{
+				phost->SimCmdTail = SIM_TAIL_NONE; /* The FIFO runs empty */
+			}
+		}
+		else
+		{
+			uint32_t cmd = get32(&ramCmd[rp]);
+			bytes = cmdWords(cmd) << 2;
+			if (!bytes)
+			{
+				/* Unknown command, its length is not known */
+				bytes = 4;
+				if (avail > 4)
+					phost->SimCmdTail = SIM_TAIL_OPAQUE;
+			}
+			else
+			{
+				if (bytes > avail || bytes > budget)
+					break; /* Wait for the complete command */
+				cmdExecute(phost, rp, cmd);
+			}
+		}
+
+		rp = (rp + bytes) & EVE_CMD_FIFO_MASK;
+		budget -= bytes;
+		consumed += bytes;
+	}
+
+	setReg(phost, REG_CMD_READ, rp);
+	if (consumed && rp == wp)
+		setReg(phost, REG_INT_FLAGS, getReg(phost, REG_INT_FLAGS) | (1 << INT_CMDEMPTY));
+	phost->SimCmdBytesDone += consumed;
+	return consumed;
+}
+
+/**
+ * @brief Let the coprocessor consume the media FIFO
+ *
+ * @param phost Pointer to Hal context
+ * @param budget Maximum number of bytes to consume
+ * @return uint32_t Number of bytes consumed
+ */
+static uint32_t mediaFifoConsume(EVE_HalContext *phost, uint32_t budget)
+{
+	uint32_t size = phost->SimMediaFifoSize;
+	uint32_t rp, wp, fullness, bytes;
+
+	if (!size)
+		return 0;
+
+	rp = getReg(phost, REG_MEDIAFIFO_READ);
+	wp = getReg(phost, REG_MEDIAFIFO_WRITE);
+	if (rp >= size || wp >= size)
+		return 0;
+
+	/* The coprocessor reads the media FIFO in whole words */
+	fullness = wp >= rp ? wp - rp : wp + size - rp;
+	bytes = min(fullness, budget) & ~3UL;
+	rp += bytes;
+	if (rp >= size)
+		rp -= size;
+	setReg(phost, REG_MEDIAFIFO_READ, rp);
+	return bytes;
+}
+
+/**
+ * @brief Advance the model to the current time
+ *
+ * Consumption is paced by the configured rates. The unused allowance is
+ * kept, in thousandths of a byte, up to the size of each FIFO.
+ *
+ * @param phost Pointer to Hal context
+ */
+static void simUpdate(EVE_HalContext *phost)
+{
+	uint64_t now = EVE_micros64();
+	uint64_t elapsed = now - phost->SimMicros;
+	uint64_t budget;
+	phost->SimMicros = now;
+
+	/* Coprocessor is held in reset */
+	if (getReg(phost, REG_CPURESET) & 1)
+		return;
+
+	if (phost->SimMediaFifoRateKBps)
+	{
+		phost->SimMediaFifoCredit = min(phost->SimMediaFifoCredit + elapsed * phost->SimMediaFifoRateKBps, (uint64_t)phost->SimMediaFifoSize * 1000);
+		budget = mediaFifoConsume(phost, (uint32_t)(phost->SimMediaFifoCredit / 1000));
+		phost->SimMediaFifoCredit -= budget * 1000;
+	}
+	else
+	{
+		mediaFifoConsume(phost, UINT32_MAX);
+	}
+
+	if (phost->SimCmdRateKBps)
+	{
+		phost->SimCmdCredit = min(phost->SimCmdCredit + elapsed * phost->SimCmdRateKBps, (uint64_t)EVE_CMD_FIFO_SIZE * 1000);
+		budget = cmdConsume(phost, (uint32_t)(phost->SimCmdCredit / 1000));
+		phost->SimCmdCredit -= budget * 1000;
+	}
+	else
+	{
+		cmdConsume(phost, UINT32_MAX);
+	}
+}
+
+/**
+ * @brief Append data to the command FIFO through REG_CMDB_WRITE
+ *
+ * @param phost Pointer to Hal context
+ * @param buffer Data to write
+ * @param size Number of bytes
+ */
+static void cmdbWrite(EVE_HalContext *phost, const uint8_t *buffer, uint32_t size)
+{
+	uint8_t *ramCmd = &phost->SimCore[SIM_CORE(RAM_CMD)];
+	uint32_t wp = getReg(phost, REG_CMD_WRITE) & EVE_CMD_FIFO_MASK;
+
+	phost->SimCmdBytesIn += size;
+	while (size)
+	{
+		uint32_t rp = getReg(phost, REG_CMD_READ) & EVE_CMD_FIFO_MASK;
+		uint32_t space = (rp - wp - 4) & EVE_CMD_FIFO_MASK;
+		uint32_t bytes;
+
+		if (!space)
+		{
+			simUpdate(phost);
+			rp = getReg(phost, REG_CMD_READ) & EVE_CMD_FIFO_MASK;
+			space = (rp - wp - 4) & EVE_CMD_FIFO_MASK;
+			if (!space)
+			{
+				/* Host did not wait for REG_CMDB_SPACE, data is lost */
+				eve_printf_debug("Device model command FIFO overflow, %d bytes dropped\n", (int)size);
+				++phost->SimCmdOverflows;
+				break;
+			}
+		}
+
+		bytes = min(min(size, space), EVE_CMD_FIFO_SIZE - wp);
+		memcpy(&ramCmd[wp], buffer, bytes);
+		wp = (wp + bytes) & EVE_CMD_FIFO_MASK;
+		setReg(phost, REG_CMD_WRITE, wp);
+		buffer += bytes;
+		size -= bytes;
+	}
+}
+
+/**
+ * @brief Read a register, applying its side effects
+ *
+ * @param phost Pointer to Hal context
+ * @param addr Word aligned register address
+ * @return uint32_t Register value
+ */
+static uint32_t rdReg(EVE_HalContext *phost, uint32_t addr)
+{
+	uint32_t value;
+
+	switch (addr)
+	{
+	case REG_CMD_READ:
+	case REG_MEDIAFIFO_READ:
+		++phost->SimCmdPolls;
+		simUpdate(phost);
+		break;
+	case REG_CMDB_SPACE:
+		++phost->SimCmdPolls;
+		simUpdate(phost);
+		return (getReg(phost, REG_CMD_READ) - getReg(phost, REG_CMD_WRITE) - 4) & EVE_CMD_FIFO_MASK;
+	case REG_CLOCK:
+		return (uint32_t)((EVE_micros64() - phost->SimBootMicros) * (getReg(phost, REG_FREQUENCY) / 1000000));
+	case REG_FRAMES:
+		return (uint32_t)((EVE_micros64() - phost->SimBootMicros) / SIM_FRAME_MICROS);
+	case REG_INT_FLAGS:
+		/* Cleared on read */
+		simUpdate(phost);
+		value = getReg(phost, REG_INT_FLAGS);
+		setReg(phost, REG_INT_FLAGS, 0);
+		return value;
+	default:
+		break;
+	}
+
+	return getReg(phost, addr);
+}
+
+/**
+ * @brief Write a register, applying its side effects
+ *
+ * @param phost Pointer to Hal context
+ * @param addr Word aligned register address
+ * @param value Value to write
+ */
+static void wrReg(EVE_HalContext *phost, uint32_t addr, uint32_t value)
+{
+	switch (addr)
+	{
+	case REG_CMD_READ:
+	case REG_CMD_WRITE:
+		value &= EVE_CMD_FIFO_MASK;
+		break;
+	case REG_CPURESET:
+		/* Coprocessor reset drops the command in progress */
+		if (value & 1)
+		{
+			phost->SimPayloadRemaining = 0;
+			phost->SimPayloadStore = 0;
+			phost->SimCmdTail = SIM_TAIL_NONE;
+			setReg(phost, REG_CMD_DL, 0);
+		}
+		break;
+	case REG_DLSWAP:
+		/* Swap completes immediately */
+		++phost->SimSwaps;
+		value = 0;
+		break;
+	case REG_INT_FLAGS:
+	case REG_CMDB_SPACE:
+	case REG_ID:
+	case REG_CHIP_ID:
+	case REG_BOOT_STATUS:
+	case REG_FLASH_STATUS:
+		/* Read only */
+		return;
+	default:
+		break;
+	}
+
+	setReg(phost, addr, value);
+}
+
+/**
+ * @brief Increase RAM_G adress
+ *
+ * @param phost Pointer to Hal context
+ * @param addr Address offset
+ * @param inc Number of bytes to increase
+ * @return uint32_t New address in RAM_G
+ */
+static inline uint32_t incrementRamGAddr(EVE_HalContext *phost, uint32_t addr, uint32_t inc)
+{
+	if (addr != REG_CMDB_WRITE)
+	{
+		bool wrapCmdAddr = (addr >= RAM_CMD) && (addr < (RAM_CMD + EVE_CMD_FIFO_SIZE));
+		addr += inc;
+		if (wrapCmdAddr)
+			addr = RAM_CMD + (addr & EVE_CMD_FIFO_MASK);
+	}
+	return addr;
+}
+
+static uint32_t simWrite(EVE_HalContext *phost, uint32_t addr, const uint8_t *buffer, uint32_t size)
+{
+	uint8_t *dst;
+
+	if (addr == REG_CMDB_WRITE)
+	{
+		cmdbWrite(phost, buffer, size);
+		return addr;
+	}
+
+	if ((dst = simRamG(phost, addr, size)))
+	{
+		memcpy(dst, buffer, size);
+		return addr + size;
+	}
+
+	while (size)
+	{
+		uint32_t bytes = ((addr & 3) || size < 4) ? 1 : 4;
+		if (bytes == 4 && simReg(phost, addr))
+			wrReg(phost, addr, get32(buffer));
+		else if ((dst = simReg(phost, addr)) || (dst = simRamG(phost, addr, 1)))
+			*dst = *buffer;
+		addr = incrementRamGAddr(phost, addr, bytes);
+		buffer += bytes;
+		size -= bytes;
+	}
+	return addr;
+}
+
+/**
+ * @brief Read bytes from RAM_G, or word by word from registers
+ *
+ * @param phost Pointer to Hal context
+ * @param addr Start address
+ * @param result Buffer to receive the data
+ * @param size Number of bytes
+ * @return uint32_t Address following the read data
+ */
+static uint32_t simRead(EVE_HalContext *phost, uint32_t addr, uint8_t *result, uint32_t size)
+{
+	const uint8_t *src;
+
+	if ((src = simRamG(phost, addr, size)))
+	{
+		memcpy(result, src, size);
+		return addr + size;
+	}
+
+	while (size)
+	{
+		uint32_t bytes = ((addr & 3) || size < 4) ? 1 : 4;
+		if (bytes == 4 && simReg(phost, addr))
+			put32(result, rdReg(phost, addr));
+		else if ((src = simReg(phost, addr)) || (src = simRamG(phost, addr, 1)))
+			*result = *src;
+		else
+			*result = 0;
+		addr = incrementRamGAddr(phost, addr, bytes);
+		result += bytes;
+		size -= bytes;
+	}
+	return addr;
+}
+
+/**
+ * @brief Idle. Call regularly to update frequently changing internal state
+ *
+ * @param phost Pointer to Hal context
+ */
+void EVE_HalImpl_idle(EVE_HalContext *phost)
+{
+	simUpdate(phost);
+}
+///@}
+
+/*************
+** TRANSFER **
+*************/
+
+/** @name TRANSFER */
+///@{
+
+#if EVE_DMA_WRITES
+/**
+ * @brief Receive a packet from the mock DMA engine, and apply it to the model
+ *
+ * @param sinkContext Pointer to Hal context
+ * @param addr Address of the packet
+ * @param data Data of the packet
+ * @param size Size of the data
+ * @return true Always
+ */
+static bool dmaSink(void *sinkContext, uint32_t addr, const uint8_t *data, uint32_t size)
+{
+	simWrite((EVE_HalContext *)sinkContext, addr, data, size);
+	return true;
+}
+#endif
+
+/**
+ * @brief Send any buffered writes to the model
+ *
+ * @param phost Pointer to Hal context
+ * @return true True if ok
+ * @return false False if error
+ */
+static bool flushSync(EVE_HalContext *phost)
+{
+#if EVE_DMA_WRITES
+	return EVE_HalDma_flush(phost) && EVE_HalDma_wait(phost);
+#else
+	return true;
+#endif
+}
+
+/**
+ * @brief Start data transfer to Coprocessor
+ *
+ * @param phost Pointer to Hal context
+ * @param rw Read or Write
+ * @param addr Address to read/write
+ */
+void EVE_Hal_startTransfer(EVE_HalContext *phost, EVE_TRANSFER_T rw, uint32_t addr)
+{
+	eve_assert(phost->Status == EVE_STATUS_OPENED);
+
+	phost->SimAddr = addr;
+	++phost->Stats.Transfers;
+	if (rw == EVE_TRANSFER_READ)
+	{
+		/* Reads must observe all previous writes */
+		if (!flushSync(phost))
+			return;
+		phost->Status = EVE_STATUS_READING;
+	}
+	else
+	{
+#if EVE_DMA_WRITES
+		EVE_HalDma_startWrite(phost, addr);
+		if (phost->Status == EVE_STATUS_ERROR)
+			return;
+#endif
+		phost->Status = EVE_STATUS_WRITING;
+	}
+}
+
+/**
+ * @brief End data transfer
+ *
+ * @param phost Pointer to Hal context
+ */
+void EVE_Hal_endTransfer(EVE_HalContext *phost)
+{
+	eve_assert(phost->Status == EVE_STATUS_READING || phost->Status == EVE_STATUS_WRITING);
+
+#if EVE_DMA_WRITES
+	if (phost->Status == EVE_STATUS_WRITING)
+	{
+		EVE_HalDma_endWrite(phost);
+		if (phost->Status == EVE_STATUS_ERROR)
+			return;
+	}
+#endif
+	phost->Status = EVE_STATUS_OPENED;
+}
+
+/**
+ * @brief Flush data to Coprocessor
+ *
+ * @param phost Pointer to Hal context
+ */
+void EVE_Hal_flush(EVE_HalContext *phost)
+{
+	eve_assert(phost->Status == EVE_STATUS_OPENED);
+	/* Without EVE_DMA_WRITES, writes are applied immediately */
+	flushSync(phost);
+}
+
+/**
+ * @brief Model unreliable reads when the SPI clock exceeds SimSpiClockMaxKHz
+ *
+ * @param phost Pointer to Hal context
+ * @param result Data which was read
+ */
+static inline void corruptRead(EVE_HalContext *phost, uint8_t *result)
+{
+	if (phost->SimSpiClockMaxKHz && phost->SpiClockrateKHz > phost->SimSpiClockMaxKHz)
+		result[0] ^= 0x10;
+}
+
+/**
+ * @brief Write a block of data to the model, or into the packet being filled
+ *
+ * @param phost Pointer to Hal context
+ * @param buffer Data to write
+ * @param size Number of bytes
+ */
+static inline void wrBuffer(EVE_HalContext *phost, const uint8_t *buffer, uint32_t size)
+{
+#if EVE_DMA_WRITES
+	EVE_HalDma_write(phost, buffer, size);
+#else
+	phost->SimAddr = simWrite(phost, phost->SimAddr, buffer, size);
+#endif
+}
+
+/**
+ * @brief Write 4 bytes to Coprocessor
+ *
+ * @param phost Pointer to Hal context
+ * @param value Value to write
+ * @return uint32_t Number of bytes transfered
+ */
+uint32_t EVE_Hal_transfer32(EVE_HalContext *phost, uint32_t value)
+{
+	uint8_t buffer[4];
+	if (phost->Status == EVE_STATUS_READING)
+	{
+		phost->SimAddr = simRead(phost, phost->SimAddr, buffer, 4);
+		phost->Stats.BytesRead += 4;
+		corruptRead(phost, buffer);
+		return get32(buffer);
+	}
+	else
+	{
+		put32(buffer, value);
+		wrBuffer(phost, buffer, 4);
+		phost->Stats.BytesWritten += 4;
+		return 0;
+	}
+}
+
+/**
+ * @brief Transfer (read/write) a block data to Coprocessor
+ *
+ * @param phost Pointer to Hal context
+ * @param result Buffer to get data transfered, NULL when write
+ * @param buffer Buffer where data is transfered, NULL when read
+ * @param size Size of buffer
+ */
+void EVE_Hal_transferMem(EVE_HalContext *phost, uint8_t *result, const uint8_t *buffer, uint32_t size)
+{
+	if (!size)
+		return;
+
+	if (result && buffer)
+	{
+		/* not implemented */
+		eve_debug_break();
+	}
+	else if (result)
+	{
+		phost->SimAddr = simRead(phost, phost->SimAddr, result, size);
+		phost->Stats.BytesRead += size;
+		corruptRead(phost, result);
+	}
+	else if (buffer)
+	{
+		wrBuffer(phost, buffer, size);
+		phost->Stats.BytesWritten += size;
+	}
+}
+
+/**
+ * @brief Reserve space for an ongoing write directly in the transfer buffer
+ *
+ * @param phost Pointer to Hal context
+ * @param size Number of bytes to reserve, multiple of 4
+ * @return uint8_t* Pointer into the write buffer, NULL if not available
+ */
+uint8_t *EVE_Hal_transferReserve(EVE_HalContext *phost, uint32_t size)
+{
+	eve_assert(phost->Status == EVE_STATUS_WRITING);
+#if EVE_DMA_WRITES
+	return EVE_HalDma_reserve(phost, size);
+#else
+	/* Writes are not buffered */
+	return NULL;
+#endif
+}
+
+/**
+ * @brief Commit data written into space obtained from EVE_Hal_transferReserve
+ *
+ * @param phost Pointer to Hal context
+ * @param size Number of bytes written, multiple of 4
+ */
+void EVE_Hal_transferCommit(EVE_HalContext *phost, uint32_t size)
+{
+#if EVE_DMA_WRITES
+	phost->Stats.BytesWritten += size;
+	EVE_HalDma_commit(phost, size);
+#else
+	eve_assert(!size);
+#endif
+}
+
+/**
+ * @brief Transfer a string to EVE platform
+ *
+ * @param phost Pointer to Hal context
+ * @param str String to transfer
+ * @param index Start position in the string
+ * @param size Size of string
+ * @param padMask Padding mask
+ * @return uint32_t Numer of bytes transfered
+ */
+uint32_t EVE_Hal_transferString(EVE_HalContext *phost, const char *str, uint32_t index, uint32_t size, uint32_t padMask)
+{
+	uint32_t transferred;
+
+	if (!size)
+	{
+		/* TODO: Support different padding options */
+		eve_assert(padMask == 0x3);
+		EVE_Hal_transfer32(phost, 0);
+		return 4;
+	}
+
+	eve_assert(size <= EVE_CMD_STRING_MAX);
+	transferred = 0;
+	if (phost->Status == EVE_STATUS_WRITING)
+	{
+		uint8_t tail[4] = { 0 };
+		uint32_t length = EVE_Hal_stringLength(&str[index], size);
+		uint32_t aligned = length & ~0x3UL;
+
+		/* Whole words of characters, then the last characters with the terminator and padding as one word */
+		eve_assert(padMask <= 0x3);
+		transferred = (length + 1 + padMask) & ~padMask;
+		memcpy(tail, &str[index + aligned], length - aligned);
+		if (aligned)
+			wrBuffer(phost, (const uint8_t *)&str[index], aligned);
+		wrBuffer(phost, tail, transferred - aligned);
+		phost->Stats.BytesWritten += transferred;
+	}
+	else
+	{
+		/* not implemented */
+		eve_debug_break();
+	}
+	return transferred;
+}
+///@}
+
+/************
+** UTILITY **
+************/
+
+/** @name UTILITY */
+///@{
+/**
+ * @brief This API sends a 5byte command to the phost
+ *
+ * @param phost Pointer to Hal context
+ * @param cmd Command to send
+ */
+void EVE_Hal_spiCommand(EVE_HalContext *phost, uint8_t *cmd)
+{
+	eve_assert(phost->Status == EVE_STATUS_OPENED);
+	eve_printf_debug("SPI cmd: 0x%x, 0x%x, 0x%x, 0x%x, 0x%x\n", cmd[0], cmd[1], cmd[2], cmd[3], cmd[4]);
+
+	/* Clock and boot configuration are not modelled */
+	flushSync(phost);
+}
+
+/**
+ * @brief Power cycle the device model
+ *
+ * @param phost Pointer to Hal context
+ * @param up Up or Down
+ * @return true True if ok
+ * @return false False if error
+ */
+bool EVE_Hal_powerCycle(EVE_HalContext *phost, bool up)
+{
+	bool res;
+	flushSync(phost);
+	res = simReset(phost, up);
+	if (!res)
+		phost->Status = EVE_STATUS_ERROR;
+
+	/* Reset to single channel SPI mode */
+	phost->SpiChannels = EVE_SPI_SINGLE_CHANNEL;
+
+	return res;
+}
+
+/**
+ * @brief Set number of SPI channel
+ *
+ * @param phost Pointer to Hal context
+ * @param numchnls Number of channel
+ */
+void EVE_Hal_setSPI(EVE_HalContext *phost, EVE_SPI_CHANNELS_T numchnls)
+{
+	int32_t syscfg;
+
+	if (numchnls > EVE_SPI_QUAD_CHANNEL)
+		return; // error
+
+	/* Switch EVE to multi channel SPI mode */
+	EVE_Hal_startTransfer(phost, EVE_TRANSFER_READ, REG_SYS_CFG);
+	syscfg = EVE_Hal_transfer32(phost, 0);
+	EVE_Hal_endTransfer(phost);
+	syscfg &= ~(SPI_WIDTH_2bit | SPI_WIDTH_4bit);
+	if (numchnls == EVE_SPI_DUAL_CHANNEL)
+	{
+		syscfg |= SPI_WIDTH_2bit;
+	}
+	else if (numchnls == EVE_SPI_QUAD_CHANNEL)
+	{
+		syscfg |= SPI_WIDTH_4bit;
+	}
+	EVE_Hal_startTransfer(phost, EVE_TRANSFER_WRITE, REG_SYS_CFG);
+	EVE_Hal_transfer32(phost, syscfg);
+	EVE_Hal_endTransfer(phost);
+
+	phost->SpiChannels = numchnls;
+}
+
+/**
+ * @brief Restore platform to previously configured EVE SPI channel mode
+ *
+ * @param phost Pointer to Hal context
+ */
+void EVE_Hal_restoreSPI(EVE_HalContext *phost)
+{
+	/* no-op */
+}
+
+/**
+ * @brief Change the modelled SPI clock
+ *
+ * @param phost Pointer to Hal context
+ * @param clockKHz Requested clock rate in kHz
+ * @return uint32_t Configured clock rate in kHz
+ */
+uint32_t EVE_Hal_setSPIClock(EVE_HalContext *phost, uint32_t clockKHz)
+{
+	phost->SpiClockrateKHz = clockKHz;
+	return clockKHz;
+}
+
+/**
+ * @brief Get interrupt status
+ *
+ * @param phost Pointer to Hal context
+ * @return True on interrupt happened or otherwise
+ */
+bool EVE_Hal_getInterrupt(EVE_HalContext *phost)
+{
+	simUpdate(phost);
+	return (getReg(phost, REG_INT_EN) & 1)
+	    && (getReg(phost, REG_INT_FLAGS) & getReg(phost, REG_INT_MASK));
+}
+///@}
+
+#endif /* #if defined(SIM_PLATFORM) */
+
+/* end of file */
@@ -63,12 +63,152 @@ void EVE_Mcu_release()
 }
 ///@}
 
+#if EVE_ASYNC_WRITES
+
+/*****************
+** ASYNC WRITES **
+*****************/
+
+/** @name ASYNC WRITES */
+///@{
+
+/**
+ * @brief Background write worker, writes one packet per start event
+ * 
+ * @param param Pointer to Hal context
+ * @return DWORD Thread exit code
+ */
+static DWORD WINAPI asyncWriteThread(LPVOID param)
+{
+	EVE_HalContext *phost = (EVE_HalContext *)param;
+	for (;;)
+	{
+		WaitForSingleObject(phost->AsyncWrStart, INFINITE);
+		if (phost->AsyncWrQuit)
+			break;
+		if (!phost->AsyncWrFunc(phost, phost->AsyncWrAddr, phost->AsyncWrBuffer, phost->AsyncWrSize))
+			phost->AsyncWrFailed = true;
+		SetEvent(phost->AsyncWrDone);
+	}
+	return 0;
+}
+
+/**
+ * @brief Start the background write worker
+ * 
+ * @param phost Pointer to Hal context
+ * @param func Function writing one packet, called on the worker thread
+ * @return true True if ok
+ * @return false False if the thread could not be created
+ */
+bool EVE_AsyncWrite_start(EVE_HalContext *phost, EVE_AsyncWriteFunc func)
+{
+	phost->AsyncWrFunc = func;
+	phost->AsyncWrPending = false;
+	phost->AsyncWrFailed = false;
+	phost->AsyncWrQuit = false;
+	phost->AsyncWrThread = NULL;
+	phost->AsyncWrStart = CreateEvent(NULL, FALSE, FALSE, NULL);
+	phost->AsyncWrDone = CreateEvent(NULL, FALSE, FALSE, NULL);
+	if (phost->AsyncWrStart && phost->AsyncWrDone)
+		phost->AsyncWrThread = CreateThread(NULL, 0, asyncWriteThread, phost, 0, NULL);
+	if (!phost->AsyncWrThread)
+	{
+		eve_printf_debug("Failed to start background write thread\n");
+		if (phost->AsyncWrStart)
+			CloseHandle(phost->AsyncWrStart);
+		if (phost->AsyncWrDone)
+			CloseHandle(phost->AsyncWrDone);
+		phost->AsyncWrStart = NULL;
+		phost->AsyncWrDone = NULL;
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Wait for the pending packet and stop the background write worker
+ * 
+ * @param phost Pointer to Hal context
+ */
+void EVE_AsyncWrite_stop(EVE_HalContext *phost)
+{
+	if (!phost->AsyncWrThread)
+		return;
+
+	EVE_AsyncWrite_wait(phost);
+	phost->AsyncWrQuit = true;
+	SetEvent(phost->AsyncWrStart);
+	WaitForSingleObject(phost->AsyncWrThread, INFINITE);
+	CloseHandle(phost->AsyncWrThread);
+	CloseHandle(phost->AsyncWrStart);
+	CloseHandle(phost->AsyncWrDone);
+	phost->AsyncWrThread = NULL;
+	phost->AsyncWrStart = NULL;
+	phost->AsyncWrDone = NULL;
+}
+
+/**
+ * @brief Hand a packet to the background write worker
+ * 
+ * Waits for the previously submitted packet first, so at most one packet is
+ * in flight. The buffer must not be modified until the next wait.
+ * 
+ * @param phost Pointer to Hal context
+ * @param addr Destination address
+ * @param buffer Packet data
+ * @param size Packet size
+ */
+void EVE_AsyncWrite_submit(EVE_HalContext *phost, uint32_t addr, uint8_t *buffer, uint32_t size)
+{
+	if (!phost->AsyncWrThread)
+	{
+		/* Worker not running, write synchronously */
+		if (!phost->AsyncWrFunc(phost, addr, buffer, size))
+			phost->AsyncWrFailed = true;
+		return;
+	}
+
+	if (phost->AsyncWrPending)
+		WaitForSingleObject(phost->AsyncWrDone, INFINITE);
+	phost->AsyncWrAddr = addr;
+	phost->AsyncWrBuffer = buffer;
+	phost->AsyncWrSize = size;
+	phost->AsyncWrPending = true;
+	SetEvent(phost->AsyncWrStart);
+}
+
+/**
+ * @brief Wait until the pending packet has been written
+ * 
+ * @param phost Pointer to Hal context
+ * @return true True if ok
+ * @return false False if any background write failed since the last wait
+ */
+bool EVE_AsyncWrite_wait(EVE_HalContext *phost)
+{
+	bool res;
+	if (phost->AsyncWrPending)
+	{
+		WaitForSingleObject(phost->AsyncWrDone, INFINITE);
+		phost->AsyncWrPending = false;
+	}
+	res = !phost->AsyncWrFailed;
+	phost->AsyncWrFailed = false;
+	return res;
+}
+///@}
+
+#endif
+
 /*********
 ** MISC **
 *********/
 
 static DWORD s_Millis_Start;
 static ULONGLONG s_Millis64_Start;
+static LARGE_INTEGER s_Micros64_Start;
+static LARGE_INTEGER s_Micros64_Frequency;
 /** @name MISC */
 ///@{
 
@@ -80,6 +220,8 @@ void EVE_Millis_initialize()
 {
 	s_Millis_Start = GetTickCount();
 	s_Millis64_Start = GetTickCount64();
+	QueryPerformanceFrequency(&s_Micros64_Frequency);
+	QueryPerformanceCounter(&s_Micros64_Start);
 }
 
 /**
@@ -113,6 +255,21 @@ uint64_t EVE_millis64()
 	return GetTickCount64() - s_Millis64_Start;
 }
 
+/**
+* @brief Get clock in microsecond
+* 
+* @return uint64_t Clock number
+*/
+uint64_t EVE_micros64()
+{
+	LARGE_INTEGER now;
+	uint64_t ticks;
+	QueryPerformanceCounter(&now);
+	ticks = (uint64_t)(now.QuadPart - s_Micros64_Start.QuadPart);
+	return (ticks / s_Micros64_Frequency.QuadPart) * 1000000
+	    + ((ticks % s_Micros64_Frequency.QuadPart) * 1000000) / s_Micros64_Frequency.QuadPart;
+}
+
 /**
  * @brief Sleep in milisecond
  * 
@@ -0,0 +1,418 @@
+/**
+ * @file EVE_HalTransport.c
+ * @brief Runtime transport table, with stackable decorators
+ *
+ * @author Bridgetek
+ *
+ * @date 2025
+ *
+ * MIT License
+ *
+ * Copyright (c) [2025] [Bridgetek Pte Ltd (BRTChip)]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "EVE_Hal.h"
+#if EVE_TRANSPORT_OPS
+
+/* The platform layer goes through the recording functions when tracing */
+#if EVE_TRACE
+#define PLATFORM_CALL(name) EVE_HalTrace_##name
+#else
+#define PLATFORM_CALL(name) EVE_HalImpl_##name
+#endif
+
+/*************
+** PLATFORM **
+*************/
+
+static bool platformOpen(EVE_HalContext *phost, EVE_HalTransport *transport, const EVE_HalParameters *parameters)
+{
+	return EVE_HalImpl_open(phost, parameters);
+}
+
+static void platformClose(EVE_HalContext *phost, EVE_HalTransport *transport)
+{
+	EVE_HalImpl_close(phost);
+}
+
+static void platformIdle(EVE_HalContext *phost, EVE_HalTransport *transport)
+{
+	EVE_HalImpl_idle(phost);
+}
+
+static void platformStartTransfer(EVE_HalContext *phost, EVE_HalTransport *transport, EVE_TRANSFER_T rw, uint32_t addr)
+{
+	PLATFORM_CALL(startTransfer)(phost, rw, addr);
+}
+
+static void platformEndTransfer(EVE_HalContext *phost, EVE_HalTransport *transport)
+{
+	PLATFORM_CALL(endTransfer)(phost);
+}
+
+static uint32_t platformTransfer32(EVE_HalContext *phost, EVE_HalTransport *transport, uint32_t value)
+{
+	return PLATFORM_CALL(transfer32)(phost, value);
+}
+
+static void platformTransferMem(EVE_HalContext *phost, EVE_HalTransport *transport, uint8_t *result, const uint8_t *buffer, uint32_t size)
+{
+	PLATFORM_CALL(transferMem)(phost, result, buffer, size);
+}
+
+static uint32_t platformTransferString(EVE_HalContext *phost, EVE_HalTransport *transport, const char *str, uint32_t index, uint32_t size, uint32_t padMask)
+{
+	return PLATFORM_CALL(transferString)(phost, str, index, size, padMask);
+}
+
+static uint8_t *platformTransferReserve(EVE_HalContext *phost, EVE_HalTransport *transport, uint32_t size)
+{
+	return PLATFORM_CALL(transferReserve)(phost, size);
+}
+
+static void platformTransferCommit(EVE_HalContext *phost, EVE_HalTransport *transport, uint32_t size)
+{
+	PLATFORM_CALL(transferCommit)(phost, size);
+}
+
+static void platformFlush(EVE_HalContext *phost, EVE_HalTransport *transport)
+{
+	PLATFORM_CALL(flush)(phost);
+}
+
+static void platformSpiCommand(EVE_HalContext *phost, EVE_HalTransport *transport, uint8_t *cmd)
+{
+	PLATFORM_CALL(spiCommand)(phost, cmd);
+}
+
+static bool platformPowerCycle(EVE_HalContext *phost, EVE_HalTransport *transport, bool up)
+{
+	return PLATFORM_CALL(powerCycle)(phost, up);
+}
+
+static void platformSetSPI(EVE_HalContext *phost, EVE_HalTransport *transport, EVE_SPI_CHANNELS_T numchnls)
+{
+	PLATFORM_CALL(setSPI)(phost, numchnls);
+}
+
+static void platformRestoreSPI(EVE_HalContext *phost, EVE_HalTransport *transport)
+{
+	EVE_HalImpl_restoreSPI(phost);
+}
+
+static uint32_t platformSetSPIClock(EVE_HalContext *phost, EVE_HalTransport *transport, uint32_t clockKHz)
+{
+	return EVE_HalImpl_setSPIClock(phost, clockKHz);
+}
+
+static bool platformGetInterrupt(EVE_HalContext *phost, EVE_HalTransport *transport)
+{
+	return EVE_HalImpl_getInterrupt(phost);
+}
+
+static const EVE_HalTransportOps c_PlatformOps = {
+	platformOpen,
+	platformClose,
+	platformIdle,
+	platformStartTransfer,
+	platformEndTransfer,
+	platformTransfer32,
+	platformTransferMem,
+	platformTransferString,
+	platformTransferReserve,
+	platformTransferCommit,
+	platformFlush,
+	platformSpiCommand,
+	platformPowerCycle,
+	platformSetSPI,
+	platformRestoreSPI,
+	platformSetSPIClock,
+	platformGetInterrupt,
+};
+
+EVE_HalTransport g_HalTransportPlatform = { &c_PlatformOps, NULL, NULL };
+
+/**********
+** STACK **
+**********/
+
+/**
+ * @brief Put a decorator on top of the transport stack
+ * 
+ * Must not be called during a transfer.
+ * 
+ * @param phost Pointer to Hal context
+ * @param layer Decorator layer
+ */
+void EVE_HalTransport_push(EVE_HalContext *phost, EVE_HalTransport *layer)
+{
+	eve_assert(phost->Status == EVE_STATUS_OPENED);
+	layer->Next = phost->Transport;
+	phost->Transport = layer;
+}
+
+/**
+ * @brief Remove the top decorator of the transport stack
+ * 
+ * Must not be called during a transfer.
+ * 
+ * @param phost Pointer to Hal context
+ * @return EVE_HalTransport* Removed layer, NULL when only the device is left
+ */
+EVE_HalTransport *EVE_HalTransport_pop(EVE_HalContext *phost)
+{
+	EVE_HalTransport *layer = phost->Transport;
+	eve_assert(phost->Status == EVE_STATUS_OPENED);
+	if (!layer->Next)
+		return NULL;
+	phost->Transport = layer->Next;
+	layer->Next = NULL;
+	return layer;
+}
+
+/***************
+** FORWARDING **
+***************/
+
+/* Each call goes to the first layer from `transport` down which implements it */
+
+void EVE_HalTransport_startTransfer(EVE_HalContext *phost, EVE_HalTransport *transport, EVE_TRANSFER_T rw, uint32_t addr)
+{
+	while (!transport->Ops->StartTransfer)
+		transport = transport->Next;
+	transport->Ops->StartTransfer(phost, transport, rw, addr);
+}
+
+void EVE_HalTransport_endTransfer(EVE_HalContext *phost, EVE_HalTransport *transport)
+{
+	while (!transport->Ops->EndTransfer)
+		transport = transport->Next;
+	transport->Ops->EndTransfer(phost, transport);
+}
+
+uint32_t EVE_HalTransport_transfer32(EVE_HalContext *phost, EVE_HalTransport *transport, uint32_t value)
+{
+	while (!transport->Ops->Transfer32)
+		transport = transport->Next;
+	return transport->Ops->Transfer32(phost, transport, value);
+}
+
+void EVE_HalTransport_transferMem(EVE_HalContext *phost, EVE_HalTransport *transport, uint8_t *result, const uint8_t *buffer, uint32_t size)
+{
+	while (!transport->Ops->TransferMem)
+		transport = transport->Next;
+	transport->Ops->TransferMem(phost, transport, result, buffer, size);
+}
+
+uint32_t EVE_HalTransport_transferString(EVE_HalContext *phost, EVE_HalTransport *transport, const char *str, uint32_t index, uint32_t size, uint32_t padMask)
+{
+	while (!transport->Ops->TransferString)
+		transport = transport->Next;
+	return transport->Ops->TransferString(phost, transport, str, index, size, padMask);
+}
+
+uint8_t *EVE_HalTransport_transferReserve(EVE_HalContext *phost, EVE_HalTransport *transport, uint32_t size)
+{
+	while (!transport->Ops->TransferReserve)
+	{
+		/* A layer which sees written memory, but not reservations, gets the data through TransferMem */
+		if (transport->Ops->TransferMem)
+			return NULL;
+		transport = transport->Next;
+	}
+	return transport->Ops->TransferReserve(phost, transport, size);
+}
+
+void EVE_HalTransport_transferCommit(EVE_HalContext *phost, EVE_HalTransport *transport, uint32_t size)
+{
+	while (!transport->Ops->TransferCommit)
+		transport = transport->Next;
+	transport->Ops->TransferCommit(phost, transport, size);
+}
+
+void EVE_HalTransport_flush(EVE_HalContext *phost, EVE_HalTransport *transport)
+{
+	while (!transport->Ops->Flush)
+		transport = transport->Next;
+	transport->Ops->Flush(phost, transport);
+}
+
+void EVE_HalTransport_spiCommand(EVE_HalContext *phost, EVE_HalTransport *transport, uint8_t *cmd)
+{
+	while (!transport->Ops->SpiCommand)
+		transport = transport->Next;
+	transport->Ops->SpiCommand(phost, transport, cmd);
+}
+
+bool EVE_HalTransport_powerCycle(EVE_HalContext *phost, EVE_HalTransport *transport, bool up)
+{
+	while (!transport->Ops->PowerCycle)
+		transport = transport->Next;
+	return transport->Ops->PowerCycle(phost, transport, up);
+}
+
+void EVE_HalTransport_setSPI(EVE_HalContext *phost, EVE_HalTransport *transport, EVE_SPI_CHANNELS_T numchnls)
+{
+	while (!transport->Ops->SetSPI)
+		transport = transport->Next;
+	transport->Ops->SetSPI(phost, transport, numchnls);
+}
+
+void EVE_HalTransport_restoreSPI(EVE_HalContext *phost, EVE_HalTransport *transport)
+{
+	while (!transport->Ops->RestoreSPI)
+		transport = transport->Next;
+	transport->Ops->RestoreSPI(phost, transport);
+}
+
+uint32_t EVE_HalTransport_setSPIClock(EVE_HalContext *phost, EVE_HalTransport *transport, uint32_t clockKHz)
+{
+	while (!transport->Ops->SetSPIClock)
+		transport = transport->Next;
+	return transport->Ops->SetSPIClock(phost, transport, clockKHz);
+}
+
+bool EVE_HalTransport_getInterrupt(EVE_HalContext *phost, EVE_HalTransport *transport)
+{
+	while (!transport->Ops->GetInterrupt)
+		transport = transport->Next;
+	return transport->Ops->GetInterrupt(phost, transport);
+}
+
+/*************
+** DISPATCH **
+*************/
+
+/* Public transport functions, starting from the top of the stack of the context */
+
+void EVE_Hal_startTransfer(EVE_HalContext *phost, EVE_TRANSFER_T rw, uint32_t addr)
+{
+	EVE_HalTransport_startTransfer(phost, phost->Transport, rw, addr);
+}
+
+void EVE_Hal_endTransfer(EVE_HalContext *phost)
+{
+	EVE_HalTransport_endTransfer(phost, phost->Transport);
+}
+
+uint32_t EVE_Hal_transfer32(EVE_HalContext *phost, uint32_t value)
+{
+	return EVE_HalTransport_transfer32(phost, phost->Transport, value);
+}
+
+void EVE_Hal_transferMem(EVE_HalContext *phost, uint8_t *result, const uint8_t *buffer, uint32_t size)
+{
+	EVE_HalTransport_transferMem(phost, phost->Transport, result, buffer, size);
+}
+
+uint32_t EVE_Hal_transferString(EVE_HalContext *phost, const char *str, uint32_t index, uint32_t size, uint32_t padMask)
+{
+	return EVE_HalTransport_transferString(phost, phost->Transport, str, index, size, padMask);
+}
+
+uint8_t *EVE_Hal_transferReserve(EVE_HalContext *phost, uint32_t size)
+{
+	return EVE_HalTransport_transferReserve(phost, phost->Transport, size);
+}
+
+void EVE_Hal_transferCommit(EVE_HalContext *phost, uint32_t size)
+{
+	EVE_HalTransport_transferCommit(phost, phost->Transport, size);
+}
+
+void EVE_Hal_flush(EVE_HalContext *phost)
+{
+	EVE_HalTransport_flush(phost, phost->Transport);
+}
+
+void EVE_Hal_spiCommand(EVE_HalContext *phost, uint8_t *cmd)
+{
+	EVE_HalTransport_spiCommand(phost, phost->Transport, cmd);
+}
+
+bool EVE_Hal_powerCycle(EVE_HalContext *phost, bool up)
+{
+	return EVE_HalTransport_powerCycle(phost, phost->Transport, up);
+}
+
+void EVE_Hal_setSPI(EVE_HalContext *phost, EVE_SPI_CHANNELS_T numchnls)
+{
+	EVE_HalTransport_setSPI(phost, phost->Transport, numchnls);
+}
+
+void EVE_Hal_restoreSPI(EVE_HalContext *phost)
+{
+	EVE_HalTransport_restoreSPI(phost, phost->Transport);
+}
+
+uint32_t EVE_Hal_setSPIClock(EVE_HalContext *phost, uint32_t clockKHz)
+{
+	return EVE_HalTransport_setSPIClock(phost, phost->Transport, clockKHz);
+}
+
+bool EVE_Hal_getInterrupt(EVE_HalContext *phost)
+{
+	return EVE_HalTransport_getInterrupt(phost, phost->Transport);
+}
+
+/***************
+** DECORATORS **
+***************/
+
+static void latencyStartTransfer(EVE_HalContext *phost, EVE_HalTransport *transport, EVE_TRANSFER_T rw, uint32_t addr)
+{
+	uint64_t end = EVE_micros64() + *(uint32_t *)transport->UserContext;
+	while (EVE_micros64() < end)
+		;
+	EVE_HalTransport_startTransfer(phost, transport->Next, rw, addr);
+}
+
+static void latencyFlush(EVE_HalContext *phost, EVE_HalTransport *transport)
+{
+	uint64_t end = EVE_micros64() + *(uint32_t *)transport->UserContext;
+	while (EVE_micros64() < end)
+		;
+	EVE_HalTransport_flush(phost, transport->Next);
+}
+
+static const EVE_HalTransportOps c_LatencyOps = {
+	.StartTransfer = latencyStartTransfer,
+	.Flush = latencyFlush,
+};
+
+/**
+ * @brief Initialize a latency injection decorator
+ * 
+ * Push it with EVE_HalTransport_push.
+ * 
+ * @param layer Layer to initialize
+ * @param micros Delay per startTransfer and flush, in microseconds
+ */
+void EVE_HalTransport_initLatency(EVE_HalTransport *layer, uint32_t *micros)
+{
+	layer->Ops = &c_LatencyOps;
+	layer->Next = NULL;
+	layer->UserContext = micros;
+}
+
+#endif /* EVE_TRANSPORT_OPS */
+
+/* end of file */
@@ -0,0 +1,152 @@
+/**
+ * @file EVE_HalTransport.h
+ * @brief Runtime transport table, with stackable decorators
+ *
+ * @author Bridgetek
+ *
+ * @date 2025
+ *
+ * MIT License
+ *
+ * Copyright (c) [2025] [Bridgetek Pte Ltd (BRTChip)]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef EVE_HAL_TRANSPORT__H
+#define EVE_HAL_TRANSPORT__H
+
+#include "EVE_HalImpl.h"
+
+#if EVE_TRANSPORT_OPS
+
+/*
+With EVE_TRANSPORT_OPS, every transport call of the context goes through a stack
+of EVE_HalTransport layers. The bottom layer is the device, by default the
+compiled platform (g_HalTransportPlatform), or any other device passed to
+EVE_Hal_openTransport. Decorators pushed on top see each call first, and forward
+it to the layer below with the EVE_HalTransport_ functions. A decorator leaves
+the entries it does not handle NULL, those calls go straight to the layer below.
+
+Without EVE_TRANSPORT_OPS, the EVE_Hal_ transport functions are implemented
+directly by the platform, without indirection.
+*/
+
+typedef struct EVE_HalTransport EVE_HalTransport;
+
+/** Transport operations. Device entries are only used on the bottom layer */
+typedef struct EVE_HalTransportOps
+{
+	/** @name Device */
+	///@{
+	/** Open the device, sets phost->Status to EVE_STATUS_OPENED */
+	bool (*Open)(EVE_HalContext *phost, EVE_HalTransport *transport, const EVE_HalParameters *parameters);
+	void (*Close)(EVE_HalContext *phost, EVE_HalTransport *transport);
+	void (*Idle)(EVE_HalContext *phost, EVE_HalTransport *transport);
+	///@}
+
+	/** @name Transfer, see EVE_HalImpl.h */
+	///@{
+	void (*StartTransfer)(EVE_HalContext *phost, EVE_HalTransport *transport, EVE_TRANSFER_T rw, uint32_t addr);
+	void (*EndTransfer)(EVE_HalContext *phost, EVE_HalTransport *transport);
+	uint32_t (*Transfer32)(EVE_HalContext *phost, EVE_HalTransport *transport, uint32_t value);
+	void (*TransferMem)(EVE_HalContext *phost, EVE_HalTransport *transport, uint8_t *result, const uint8_t *buffer, uint32_t size);
+	uint32_t (*TransferString)(EVE_HalContext *phost, EVE_HalTransport *transport, const char *str, uint32_t index, uint32_t size, uint32_t padMask);
+	uint8_t *(*TransferReserve)(EVE_HalContext *phost, EVE_HalTransport *transport, uint32_t size);
+	void (*TransferCommit)(EVE_HalContext *phost, EVE_HalTransport *transport, uint32_t size);
+	void (*Flush)(EVE_HalContext *phost, EVE_HalTransport *transport);
+	///@}
+
+	/** @name Utility, see EVE_HalImpl.h */
+	///@{
+	void (*SpiCommand)(EVE_HalContext *phost, EVE_HalTransport *transport, uint8_t *cmd);
+	bool (*PowerCycle)(EVE_HalContext *phost, EVE_HalTransport *transport, bool up);
+	void (*SetSPI)(EVE_HalContext *phost, EVE_HalTransport *transport, EVE_SPI_CHANNELS_T numchnls);
+	void (*RestoreSPI)(EVE_HalContext *phost, EVE_HalTransport *transport);
+	uint32_t (*SetSPIClock)(EVE_HalContext *phost, EVE_HalTransport *transport, uint32_t clockKHz);
+	bool (*GetInterrupt)(EVE_HalContext *phost, EVE_HalTransport *transport);
+	///@}
+} EVE_HalTransportOps;
+
+/** A layer of the transport stack */
+struct EVE_HalTransport
+{
+	const EVE_HalTransportOps *Ops;
+	EVE_HalTransport *Next; /**< Layer below, NULL for the device */
+	void *UserContext; /**< State of the layer */
+};
+
+/** Transport of the compiled platform, used by EVE_Hal_open */
+extern EVE_HalTransport g_HalTransportPlatform;
+
+/** @name TRANSPORT STACK */
+///@{
+
+/* Open a context on the specified device transport, instead of the compiled platform */
+bool EVE_Hal_openTransport(EVE_HalContext *phost, const EVE_HalParameters *parameters, EVE_HalTransport *device);
+
+/* Put a decorator on top of the transport stack. The layer must stay valid until it is popped or the context is closed */
+void EVE_HalTransport_push(EVE_HalContext *phost, EVE_HalTransport *layer);
+
+/* Remove the top decorator. Returns the removed layer, or NULL when only the device is left */
+EVE_HalTransport *EVE_HalTransport_pop(EVE_HalContext *phost);
+
+/* Get the device at the bottom of the transport stack */
+static inline EVE_HalTransport *EVE_HalTransport_device(EVE_HalContext *phost)
+{
+	EVE_HalTransport *transport = phost->Transport;
+	while (transport->Next)
+		transport = transport->Next;
+	return transport;
+}
+///@}
+
+/** @name FORWARDING
+Call the operation on `transport`, or on the first layer below it which implements it.
+Decorators forward with `transport->Next` */
+///@{
+void EVE_HalTransport_startTransfer(EVE_HalContext *phost, EVE_HalTransport *transport, EVE_TRANSFER_T rw, uint32_t addr);
+void EVE_HalTransport_endTransfer(EVE_HalContext *phost, EVE_HalTransport *transport);
+uint32_t EVE_HalTransport_transfer32(EVE_HalContext *phost, EVE_HalTransport *transport, uint32_t value);
+void EVE_HalTransport_transferMem(EVE_HalContext *phost, EVE_HalTransport *transport, uint8_t *result, const uint8_t *buffer, uint32_t size);
+uint32_t EVE_HalTransport_transferString(EVE_HalContext *phost, EVE_HalTransport *transport, const char *str, uint32_t index, uint32_t size, uint32_t padMask);
+uint8_t *EVE_HalTransport_transferReserve(EVE_HalContext *phost, EVE_HalTransport *transport, uint32_t size);
+void EVE_HalTransport_transferCommit(EVE_HalContext *phost, EVE_HalTransport *transport, uint32_t size);
+void EVE_HalTransport_flush(EVE_HalContext *phost, EVE_HalTransport *transport);
+void EVE_HalTransport_spiCommand(EVE_HalContext *phost, EVE_HalTransport *transport, uint8_t *cmd);
+bool EVE_HalTransport_powerCycle(EVE_HalContext *phost, EVE_HalTransport *transport, bool up);
+void EVE_HalTransport_setSPI(EVE_HalContext *phost, EVE_HalTransport *transport, EVE_SPI_CHANNELS_T numchnls);
+void EVE_HalTransport_restoreSPI(EVE_HalContext *phost, EVE_HalTransport *transport);
+uint32_t EVE_HalTransport_setSPIClock(EVE_HalContext *phost, EVE_HalTransport *transport, uint32_t clockKHz);
+bool EVE_HalTransport_getInterrupt(EVE_HalContext *phost, EVE_HalTransport *transport);
+///@}
+
+/** @name DECORATORS */
+///@{
+
+/* Latency injection. Delays every startTransfer and flush by *micros microseconds,
+to test behaviour over slow bridges. `micros` may be changed while the layer is in use */
+void EVE_HalTransport_initLatency(EVE_HalTransport *layer, uint32_t *micros);
+///@}
+
+#endif /* EVE_TRANSPORT_OPS */
+
+#endif /* #ifndef EVE_HAL_TRANSPORT__H */
+
+/* end of file */
@@ -165,7 +165,6 @@ uint32_t EVE_Util_loadRawFile(EVE_HalContext *phost, uint32_t address, const cha
 	UINT blocklen;
 	int32_t filesize;
 	uint8_t buffer[512L];
-	uint32_t addr = address;
 	uint32_t file_size = 0;
 
 	if (!s_FatFSLoaded)
@@ -187,13 +186,37 @@ uint32_t EVE_Util_loadRawFile(EVE_HalContext *phost, uint32_t address, const cha
 	{
 		filesize = f_size(&InfSrc);
 		file_size = filesize;
+		EVE_Hal_regBatchFlush(phost);
+		EVE_Hal_startTransfer(phost, EVE_TRANSFER_WRITE, address);
 		while (filesize > 0)
 		{
-			fResult = f_read(&InfSrc, buffer, 512, &blocklen); // read a chunk of src file
+			/* Read straight into the transport write buffer when it has one,
+			so the card is read while the previous packet is being sent */
+			uint8_t *dst = EVE_Hal_transferReserve(phost, 512);
+			fResult = f_read(&InfSrc, dst ? dst : buffer, 512, &blocklen); // read a chunk of src file
+			if ((fResult != FR_OK) || !blocklen)
+			{
+				if (dst)
+					EVE_Hal_transferCommit(phost, 0);
+				break;
+			}
 			filesize -= blocklen;
-			EVE_Hal_wrMem(phost, addr, buffer, blocklen);
-			addr += blocklen;
+			if (dst)
+			{
+				/* Commit whole words only, the last bytes of the file are
+				written separately so nothing past the file is sent */
+				UINT aligned = blocklen & ~3U;
+				memcpy(buffer, &dst[aligned], blocklen - aligned);
+				EVE_Hal_transferCommit(phost, aligned);
+				if (blocklen != aligned)
+					EVE_Hal_transferMem(phost, NULL, buffer, blocklen - aligned);
+			}
+			else
+			{
+				EVE_Hal_transferMem(phost, NULL, buffer, blocklen);
+			}
 		}
+		EVE_Hal_endTransfer(phost);
 		f_close(&InfSrc);
 		return file_size;
 	}
@@ -117,14 +117,38 @@ uint32_t EVE_MediaFifo_space(EVE_HalContext *phost)
 	if (!phost->MediaFifoSize)
 		return 0;
 
-	int32_t rp = EVE_Hal_rd32(phost, REG_MEDIAFIFO_READ);
-	int32_t wp = EVE_Hal_rd32(phost, REG_MEDIAFIFO_WRITE);
+	static const uint32_t addrs[2] = { REG_MEDIAFIFO_READ, REG_MEDIAFIFO_WRITE };
+	uint32_t values[2];
+	EVE_Hal_rd32Multi(phost, addrs, values, 2);
+	int32_t rp = values[0];
+	int32_t wp = values[1];
 
 	return rp > wp
 	    ? (rp - wp - 4)
 	    : (rp + phost->MediaFifoSize - wp - 4);
 }
 
+/**
+ * @brief Write a block which wraps around the end of the media FIFO
+ * 
+ * @param phost Pointer to Hal context
+ * @param wp Write pointer
+ * @param buffer Data to write
+ * @param size Data size
+ * @param overflow Number of bytes written at the start of the media FIFO
+ */
+static void wrWrapped(EVE_HalContext *phost, uint32_t wp, const uint8_t *buffer, uint32_t size, uint32_t overflow)
+{
+	EVE_HalMemSegment segments[2];
+	segments[0].Addr = phost->MediaFifoAddress + wp;
+	segments[0].Buffer = buffer;
+	segments[0].Size = size - overflow;
+	segments[1].Addr = phost->MediaFifoAddress;
+	segments[1].Buffer = &buffer[size - overflow];
+	segments[1].Size = overflow;
+	EVE_Hal_wrMemv(phost, segments, 2);
+}
+
 /**
  * @brief Write a buffer to the media FIFO. 
  * 
@@ -163,8 +187,7 @@ bool EVE_MediaFifo_wrMem(EVE_HalContext *phost, const uint8_t *buffer, uint32_t
 		{
 			eve_assert(phost->MediaFifoAddress + wp + size - overflow <= phost->DDR_RamSize);
 			eve_assert(phost->MediaFifoAddress + overflow <= phost->DDR_RamSize);
-			EVE_Hal_wrMem(phost, phost->MediaFifoAddress + wp, buffer, size - overflow);
-			EVE_Hal_wrMem(phost, phost->MediaFifoAddress, &buffer[size - overflow], overflow);
+			wrWrapped(phost, wp, buffer, size, overflow);
 		}
 		else
 		{
@@ -201,8 +224,7 @@ bool EVE_MediaFifo_wrMem(EVE_HalContext *phost, const uint8_t *buffer, uint32_t
 			{
 				eve_assert(phost->MediaFifoAddress + wp + transfer - overflow <= phost->DDR_RamSize);
 				eve_assert(phost->MediaFifoAddress + overflow <= phost->DDR_RamSize);
-				EVE_Hal_wrMem(phost, phost->MediaFifoAddress + wp, &buffer[done], transfer - overflow);
-				EVE_Hal_wrMem(phost, phost->MediaFifoAddress, &buffer[done + transfer - overflow], overflow);
+				wrWrapped(phost, wp, &buffer[done], transfer, overflow);
 			}
 			else
 			{
@@ -274,10 +296,12 @@ static bool checkWait(EVE_HalContext *phost, uint32_t rpOrSpace)
  * 
  * @param phost Pointer to Hal context
  * @param rpOrSpace Read pointer or space
+ * @param wait Wait loop state
+ * @param pending Bytes still to be consumed
  * @return true True if ok
  * @return false False if error
  */
-static bool handleWait(EVE_HalContext *phost, uint16_t rpOrSpace)
+static bool handleWait(EVE_HalContext *phost, uint16_t rpOrSpace, EVE_HalWait *wait, uint32_t pending)
 {
 	/* Check for coprocessor fault */
 	if (!checkWait(phost, rpOrSpace))
@@ -285,9 +309,25 @@ static bool handleWait(EVE_HalContext *phost, uint16_t rpOrSpace)
 
 	/* Process any idling */
 	EVE_Hal_idle(phost);
+
+	/* Pause according to the wait policy */
+	EVE_Hal_waitPause(phost, wait, pending);
 	return true;
 }
 
+/**
+ * @brief Account the time spent waiting for media FIFO space
+ * 
+ * @param phost Pointer to Hal context
+ * @param start Time when the wait started
+ * @return uint32_t Always 0, for returning from a failed wait
+ */
+static inline uint32_t endWait(EVE_HalContext *phost, uint64_t start)
+{
+	phost->Stats.MediaFifoWaitMicros += EVE_micros64() - start;
+	return 0;
+}
+
 /**
  * @brief Wait for the media FIFO to fully empty.
  * 
@@ -311,6 +351,8 @@ bool EVE_MediaFifo_waitFlush(EVE_HalContext *phost, bool orCmdFlush)
 uint32_t EVE_MediaFifo_waitSpace(EVE_HalContext *phost, uint32_t size, bool orCmdFlush)
 {
 	uint32_t space;
+	uint64_t start;
+	EVE_HalWait wait;
 
 	if (!phost->MediaFifoSize)
 	{
@@ -326,24 +368,29 @@ uint32_t EVE_MediaFifo_waitSpace(EVE_HalContext *phost, uint32_t size, bool orCm
 
 	eve_assert(!phost->CmdWaiting);
 	phost->CmdWaiting = true;
+	++phost->Stats.MediaFifoWaitCalls;
 
 	space = EVE_MediaFifo_space(phost);
 	if (!checkWait(phost, space))
 		return 0;
 
+	start = EVE_micros64();
+	EVE_Hal_waitBegin(phost, &wait, &phost->MediaFifoRate, false);
 	while (space < size)
 	{
+		++phost->Stats.MediaFifoWaitLoops;
 		space = EVE_MediaFifo_space(phost);
-		if (!handleWait(phost, (uint16_t)space))
-			return 0;
+		if (!handleWait(phost, (uint16_t)space, &wait, space < size ? size - space : 0))
+			return endWait(phost, start);
 		phost->CmdWaiting = false;
 		uint32_t cmdSpace = EVE_Cmd_waitSpace(phost, 0);
 		if (!cmdSpace)
-			return 0; /* Check for coprocessor error */
+			return endWait(phost, start); /* Check for coprocessor error */
 		if (orCmdFlush && cmdSpace == (EVE_CMD_FIFO_SIZE - 4))
-			return 0; /* Processed */
+			return endWait(phost, start); /* Processed */
 		phost->CmdWaiting = true;
-	} 
+	}
+	endWait(phost, start);
 
 	phost->CmdWaiting = false;
 	return space;
@@ -50,6 +50,12 @@ extern "C" {
 #if defined(RP2040_PLATFORM)
 #include "EVE_Platform_RP2040.h"
 #endif
+#if defined(LINUX_SPIDEV_PLATFORM)
+#include "EVE_Platform_LINUX_SPIDEV.h"
+#endif
+#if defined(SIM_PLATFORM)
+#include "EVE_Platform_SIM.h"
+#endif
 
 /**********************
  *      MACROS
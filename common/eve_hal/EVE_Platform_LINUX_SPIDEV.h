@@ -0,0 +1,61 @@
+/**
+ * @file EVE_Platform_LINUX_SPIDEV.h
+ * @brief EVE platform for Linux spidev
+ *
+ * @author Bridgetek
+ *
+ * @date 2025
+ *
+ * MIT License
+ *
+ * Copyright (c) [2025] [Bridgetek Pte Ltd (BRTChip)]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef EVE_PLATFORM_LINUX_SPIDEV__H
+#define EVE_PLATFORM_LINUX_SPIDEV__H
+
+#include "EVE_Platform_LINUX.h"
+#include <linux/spi/spidev.h>
+#include <linux/gpio.h>
+
+/** @name Linux spidev default platform definitions.
+ * @warning Configuration can be changed programatically in initialization parameters.
+ * Pin numbers are line offsets on the GPIO character device */
+///@{
+#define EVE_DEFAULT_SPIDEV_DEVICE "/dev/spidev0.0"
+#define EVE_DEFAULT_SPIDEV_GPIOCHIP "/dev/gpiochip0"
+#define EVE_DEFAULT_SPIDEV_PWD 25
+#define EVE_DEFAULT_SPIDEV_INT 24
+#define EVE_DEFAULT_SPIDEV_CLOCKRATE_KHZ 10000
+#define EVE_SPIDEV_PIN_NONE 0xFF /**< Pin not connected */
+///@}
+
+/** @name Linux spidev transfer batching */
+///@{
+#define EVE_SPIDEV_SEGMENTS_MAX 64 /**< spi_ioc_transfer segments carried by one SPI_IOC_MESSAGE */
+#define EVE_SPIDEV_POLLING_BYTES 8 /**< Bytes scanned for the read ready byte */
+#define EVE_SPIDEV_DATA_LENGTH 1024 /**< Maximum payload of one read transaction */
+#define EVE_SPIDEV_BUFSIZ_DEFAULT 4096 /**< Default of the spidev `bufsiz` module parameter */
+///@}
+
+#endif /* #ifndef EVE_PLATFORM_LINUX_SPIDEV__H */
+
+/* end of file */
@@ -36,6 +36,14 @@
 #include "ftd2xx.h"
 #include "libMPSSE_spi.h"
 
+/** @name MPSSE read transfers */
+///@{
+#define EVE_MPSSE_POLLING_BYTES 8 /**< Bytes scanned for the read ready byte */
+#define EVE_MPSSE_FIRST_READ 1024 /**< Maximum payload of the read which polls for the ready byte */
+#define EVE_MPSSE_BULK_READ 65532 /**< Maximum payload streamed by one SPI_Read once the ready byte is received */
+#define EVE_MPSSE_READ_CARRY 16 /**< Bytes received ahead of the caller within a read transaction */
+///@}
+
 #endif /* #ifndef EVE_PLATFORM_MPSSE__H */
 
 /* end of file */
\ No newline at end of file
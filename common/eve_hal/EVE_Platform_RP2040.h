@@ -35,7 +35,7 @@
 /* RP2040 platform libraries */
 #include "pico/stdlib.h"
 #include "hardware/spi.h"
-/* #include "hardware/dma.h" */
+#include "hardware/dma.h"
 /* #include "hardware/pio.h" */
 
 /* Standard C libraries */
@@ -72,6 +72,12 @@
 /** Only use SPI0 by default */
 #define EVE_DEFAULT_SPI 0
 
+/** SPI clock after open, may be changed with EVE_Hal_setSPIClock */
+#define EVE_DEFAULT_RP2040_CLOCKRATE_KHZ 25000
+
+/** Two DMA write packets of 4 KB, see EVE_HalDma.h */
+#define EVE_SPI_WRBUF_SIZE 8192
+
 #endif /* #ifndef EVE_PLATFORM_RP2040__H */
 
 /* end of file */
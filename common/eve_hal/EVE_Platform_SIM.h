@@ -0,0 +1,57 @@
+/**
+ * @file EVE_Platform_SIM.h
+ * @brief EVE platform for the in-process BT820 device model
+ *
+ * @author Bridgetek
+ *
+ * @date 2025
+ *
+ * MIT License
+ *
+ * Copyright (c) [2025] [Bridgetek Pte Ltd (BRTChip)]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef EVE_PLATFORM_SIM__H
+#define EVE_PLATFORM_SIM__H
+
+#include "EVE_Platform_LINUX.h"
+
+/** @name Device model default platform definitions.
+ * @warning Configuration can be changed programatically in initialization parameters. */
+///@{
+#define EVE_DEFAULT_SIM_RAM_G_SIZE (128 * 1024 * 1024UL) /**< Matches EVE_DDR_SIZE 0 */
+#define EVE_DEFAULT_SIM_CMD_RATE_KBPS 0 /**< Coprocessor drains the command FIFO instantly */
+#define EVE_DEFAULT_SIM_MEDIAFIFO_RATE_KBPS 0 /**< Coprocessor drains the media FIFO instantly */
+#define EVE_DEFAULT_SIM_SPI_CLOCKRATE_KHZ 10000
+///@}
+
+/** @name Device model address space.
+ * RAM_CMD, REG_CORE_R2, RAM_REPORT, REG_CORE_R1 and RAM_DL are backed by one block from BASE,
+ * REG_LVDSTX, REG_SYS, REG_LVDSRX and REG_I2S by a second block */
+///@{
+#define EVE_SIM_CORE_SIZE 0x10000
+#define EVE_SIM_PERIPH_BASE (BASE + 0x800000)
+#define EVE_SIM_PERIPH_SIZE 0x1000
+///@}
+
+#endif /* #ifndef EVE_PLATFORM_SIM__H */
+
+/* end of file */
@@ -0,0 +1,813 @@
+/**
+ * @file EVE_Trace.c
+ * @brief Bus transaction trace capture and replay
+ *
+ * @author Bridgetek
+ *
+ * @date 2025
+ *
+ * MIT License
+ *
+ * Copyright (c) [2025] [Bridgetek Pte Ltd (BRTChip)]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "EVE_Trace.h"
+#include "EVE_Hal.h"
+#if EVE_TRACE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Size of the stdio buffer used while recording */
+#define EVE_TRACE_FILE_BUFFER (256 * 1024)
+
+/* Maximum time to resynchronize a coprocessor or media FIFO poll during replay */
+#define EVE_TRACE_SYNC_TIMEOUT_MS 2000
+
+static const char c_TraceMagic[4] = { 'E', 'V', 'T', 'R' };
+
+struct EVE_TraceRecorder
+{
+	FILE *File;
+	char *FileBuffer;
+	uint64_t Micros; /**< Time of the previous record */
+};
+typedef struct EVE_TraceRecorder EVE_TraceRecorder;
+
+/*************
+** CAPTURE **
+*************/
+
+#if EVE_TRANSPORT_OPS
+/* Recording sits between the transport table and the platform, see EVE_HalTransport.c */
+#define EVE_Hal_startTransfer EVE_HalTrace_startTransfer
+#define EVE_Hal_endTransfer EVE_HalTrace_endTransfer
+#define EVE_Hal_transfer32 EVE_HalTrace_transfer32
+#define EVE_Hal_transferMem EVE_HalTrace_transferMem
+#define EVE_Hal_transferString EVE_HalTrace_transferString
+#define EVE_Hal_transferReserve EVE_HalTrace_transferReserve
+#define EVE_Hal_transferCommit EVE_HalTrace_transferCommit
+#define EVE_Hal_flush EVE_HalTrace_flush
+#define EVE_Hal_spiCommand EVE_HalTrace_spiCommand
+#define EVE_Hal_powerCycle EVE_HalTrace_powerCycle
+#define EVE_Hal_setSPI EVE_HalTrace_setSPI
+#endif
+
+static inline void traceByte(EVE_TraceRecorder *trace, uint8_t value)
+{
+	putc(value, trace->File);
+}
+
+static inline void traceVarint(EVE_TraceRecorder *trace, uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		putc((int)(value & 0x7F) | 0x80, trace->File);
+		value >>= 7;
+	}
+	putc((int)value, trace->File);
+}
+
+static inline void trace32(EVE_TraceRecorder *trace, uint32_t value)
+{
+	putc(value & 0xFF, trace->File);
+	putc((value >> 8) & 0xFF, trace->File);
+	putc((value >> 16) & 0xFF, trace->File);
+	putc(value >> 24, trace->File);
+}
+
+/**
+ * @brief Write a record header
+ *
+ * @param trace Active recording
+ * @param type Record type
+ * @param micros Time at which the recorded call was made
+ */
+static void traceRecord(EVE_TraceRecorder *trace, EVE_TRACE_RECORD_T type, uint64_t micros)
+{
+	traceByte(trace, (uint8_t)type);
+	traceVarint(trace, micros - trace->Micros);
+	trace->Micros = micros;
+}
+
+/** @name CAPTURE */
+///@{
+
+/**
+ * @brief Start recording all bus transactions into a trace file
+ *
+ * @param phost Pointer to Hal context
+ * @param filename Trace file to create
+ * @return true True if ok
+ * @return false False if the file could not be created
+ */
+bool EVE_Trace_start(EVE_HalContext *phost, const char *filename)
+{
+	EVE_TraceRecorder *trace;
+	FILE *file;
+	uint8_t header[8];
+	errno_t err;
+
+	EVE_Trace_stop(phost);
+
+	err = fopen_s(&file, filename, "wb");
+	if (err || !file)
+	{
+		eve_printf_debug("Unable to create trace: %s\n", filename);
+		return false;
+	}
+
+	trace = calloc(1, sizeof(EVE_TraceRecorder));
+	if (!trace)
+	{
+		fclose(file);
+		return false;
+	}
+	trace->File = file;
+	trace->FileBuffer = malloc(EVE_TRACE_FILE_BUFFER);
+	if (trace->FileBuffer)
+		setvbuf(file, trace->FileBuffer, _IOFBF, EVE_TRACE_FILE_BUFFER);
+
+	memcpy(header, c_TraceMagic, 4);
+	header[4] = EVE_TRACE_VERSION;
+	header[5] = EVE_HOST;
+	header[6] = 0;
+	header[7] = 0;
+	fwrite(header, 1, sizeof(header), file);
+
+	trace->Micros = EVE_micros64();
+	phost->Trace = trace;
+	eve_printf_debug("Recording bus trace to %s\n", filename);
+	return true;
+}
+
+/**
+ * @brief Stop recording and close the trace file
+ *
+ * @param phost Pointer to Hal context
+ */
+void EVE_Trace_stop(EVE_HalContext *phost)
+{
+	EVE_TraceRecorder *trace = phost->Trace;
+	if (!trace)
+		return;
+
+	phost->Trace = NULL;
+	if (ferror(trace->File))
+		eve_printf_debug("Bus trace is incomplete, write error\n");
+	fclose(trace->File);
+	free(trace->FileBuffer);
+	free(trace);
+}
+///@}
+
+/** @name TRANSFER */
+///@{
+
+/**
+ * @brief Start data transfer to Coprocessor, recorded
+ *
+ * @param phost Pointer to Hal context
+ * @param rw Read or Write
+ * @param addr Address to read/write
+ */
+void EVE_Hal_startTransfer(EVE_HalContext *phost, EVE_TRANSFER_T rw, uint32_t addr)
+{
+	EVE_TraceRecorder *trace = phost->Trace;
+	if (trace)
+	{
+		traceRecord(trace, rw == EVE_TRANSFER_READ ? EVE_TRACE_START_READ : EVE_TRACE_START_WRITE, EVE_micros64());
+		trace32(trace, addr);
+	}
+	EVE_HalImpl_startTransfer(phost, rw, addr);
+}
+
+/**
+ * @brief End data transfer, recorded
+ *
+ * @param phost Pointer to Hal context
+ */
+void EVE_Hal_endTransfer(EVE_HalContext *phost)
+{
+	EVE_TraceRecorder *trace = phost->Trace;
+	if (trace)
+		traceRecord(trace, EVE_TRACE_END, EVE_micros64());
+	EVE_HalImpl_endTransfer(phost);
+}
+
+/**
+ * @brief Transfer (read/write) 4 bytes to Coprocessor, recorded
+ *
+ * @param phost Pointer to Hal context
+ * @param value Value to write
+ * @return uint32_t Value read
+ */
+uint32_t EVE_Hal_transfer32(EVE_HalContext *phost, uint32_t value)
+{
+	EVE_TraceRecorder *trace = phost->Trace;
+	uint64_t micros;
+	uint32_t result;
+	bool reading;
+
+	if (!trace)
+		return EVE_HalImpl_transfer32(phost, value);
+
+	micros = EVE_micros64();
+	reading = phost->Status == EVE_STATUS_READING;
+	result = EVE_HalImpl_transfer32(phost, value);
+	traceRecord(trace, reading ? EVE_TRACE_READ32 : EVE_TRACE_WRITE32, micros);
+	trace32(trace, reading ? result : value);
+	return result;
+}
+
+/**
+ * @brief Transfer (read/write) a block data to Coprocessor, recorded
+ *
+ * @param phost Pointer to Hal context
+ * @param result Buffer to get data transfered, NULL when write
+ * @param buffer Buffer where data is transfered, NULL when read
+ * @param size Size of buffer
+ */
+void EVE_Hal_transferMem(EVE_HalContext *phost, uint8_t *result, const uint8_t *buffer, uint32_t size)
+{
+	EVE_TraceRecorder *trace = phost->Trace;
+	uint64_t micros;
+
+	if (!trace || !size || (result && buffer))
+	{
+		EVE_HalImpl_transferMem(phost, result, buffer, size);
+		return;
+	}
+
+	micros = EVE_micros64();
+	EVE_HalImpl_transferMem(phost, result, buffer, size);
+	traceRecord(trace, result ? EVE_TRACE_READ : EVE_TRACE_WRITE, micros);
+	traceVarint(trace, size);
+	fwrite(result ? result : buffer, 1, size, trace->File);
+}
+
+/**
+ * @brief Transfer a string to EVE platform, recorded
+ *
+ * @param phost Pointer to Hal context
+ * @param str String to transfer
+ * @param index Start position in the string
+ * @param size Size of string
+ * @param padMask Padding mask
+ * @return uint32_t Numer of bytes transfered
+ */
+uint32_t EVE_Hal_transferString(EVE_HalContext *phost, const char *str, uint32_t index, uint32_t size, uint32_t padMask)
+{
+	EVE_TraceRecorder *trace = phost->Trace;
+	uint64_t micros;
+	uint32_t length;
+
+	if (!trace)
+		return EVE_HalImpl_transferString(phost, str, index, size, padMask);
+
+	micros = EVE_micros64();
+	for (length = 0; length < size && str[index + length]; ++length)
+		;
+	traceRecord(trace, EVE_TRACE_STRING, micros);
+	traceVarint(trace, size);
+	traceByte(trace, (uint8_t)padMask);
+	traceVarint(trace, length);
+	fwrite(&str[index], 1, length, trace->File);
+	return EVE_HalImpl_transferString(phost, str, index, size, padMask);
+}
+
+/**
+ * @brief Reserve space in the transport write buffer, unless recording
+ *
+ * While recording, the caller falls back to EVE_Hal_transferMem, so that the data is recorded.
+ *
+ * @param phost Pointer to Hal context
+ * @param size Number of bytes to reserve
+ * @return uint8_t* Pointer into the write buffer, NULL if not available
+ */
+uint8_t *EVE_Hal_transferReserve(EVE_HalContext *phost, uint32_t size)
+{
+	if (phost->Trace)
+		return NULL;
+	return EVE_HalImpl_transferReserve(phost, size);
+}
+
+/**
+ * @brief Commit data written into reserved space
+ *
+ * @param phost Pointer to Hal context
+ * @param size Number of bytes written
+ */
+void EVE_Hal_transferCommit(EVE_HalContext *phost, uint32_t size)
+{
+	EVE_HalImpl_transferCommit(phost, size);
+}
+
+/**
+ * @brief Flush data to Coprocessor, recorded
+ *
+ * @param phost Pointer to Hal context
+ */
+void EVE_Hal_flush(EVE_HalContext *phost)
+{
+	EVE_TraceRecorder *trace = phost->Trace;
+	if (trace)
+		traceRecord(trace, EVE_TRACE_FLUSH, EVE_micros64());
+	EVE_HalImpl_flush(phost);
+}
+///@}
+
+/** @name UTILITY */
+///@{
+
+/**
+ * @brief Send a host command to EVE, recorded
+ *
+ * @param phost Pointer to Hal context
+ * @param cmd Host command, 5 bytes
+ */
+void EVE_Hal_spiCommand(EVE_HalContext *phost, uint8_t *cmd)
+{
+	EVE_TraceRecorder *trace = phost->Trace;
+	if (trace)
+	{
+		traceRecord(trace, EVE_TRACE_SPI_CMD, EVE_micros64());
+		fwrite(cmd, 1, 5, trace->File);
+	}
+	EVE_HalImpl_spiCommand(phost, cmd);
+}
+
+/**
+ * @brief Toggle PD_N pin of EVE board for a power cycle, recorded
+ *
+ * @param phost Pointer to Hal context
+ * @param up Up or Down
+ * @return true True if successful
+ * @return false False if error
+ */
+bool EVE_Hal_powerCycle(EVE_HalContext *phost, bool up)
+{
+	EVE_TraceRecorder *trace = phost->Trace;
+	if (trace)
+	{
+		traceRecord(trace, EVE_TRACE_POWER_CYCLE, EVE_micros64());
+		traceByte(trace, up ? 1 : 0);
+	}
+	return EVE_HalImpl_powerCycle(phost, up);
+}
+
+/**
+ * @brief Set number of SPI channel, recorded
+ *
+ * @param phost Pointer to Hal context
+ * @param numchnls Number of channel
+ */
+void EVE_Hal_setSPI(EVE_HalContext *phost, EVE_SPI_CHANNELS_T numchnls)
+{
+	EVE_TraceRecorder *trace = phost->Trace;
+	if (trace)
+	{
+		traceRecord(trace, EVE_TRACE_SET_SPI, EVE_micros64());
+		traceByte(trace, (uint8_t)numchnls);
+	}
+	EVE_HalImpl_setSPI(phost, numchnls);
+}
+///@}
+
+#if EVE_TRANSPORT_OPS
+/* Replay goes through the whole transport stack */
+#undef EVE_Hal_startTransfer
+#undef EVE_Hal_endTransfer
+#undef EVE_Hal_transfer32
+#undef EVE_Hal_transferMem
+#undef EVE_Hal_transferString
+#undef EVE_Hal_transferReserve
+#undef EVE_Hal_transferCommit
+#undef EVE_Hal_flush
+#undef EVE_Hal_spiCommand
+#undef EVE_Hal_powerCycle
+#undef EVE_Hal_setSPI
+#endif
+
+/************
+** REPLAY **
+************/
+
+typedef struct EVE_TraceReader
+{
+	const uint8_t *Ptr;
+	const uint8_t *End;
+	bool Error;
+} EVE_TraceReader;
+
+static inline bool readerCheck(EVE_TraceReader *reader, size_t size)
+{
+	if ((size_t)(reader->End - reader->Ptr) < size)
+	{
+		reader->Error = true;
+		reader->Ptr = reader->End;
+		return false;
+	}
+	return true;
+}
+
+static inline uint8_t readByte(EVE_TraceReader *reader)
+{
+	if (!readerCheck(reader, 1))
+		return 0;
+	return *reader->Ptr++;
+}
+
+static inline uint64_t readVarint(EVE_TraceReader *reader)
+{
+	uint64_t value = 0;
+	uint32_t shift = 0;
+	uint8_t c;
+	do
+	{
+		c = readByte(reader);
+		value |= (uint64_t)(c & 0x7F) << shift;
+		shift += 7;
+	} while ((c & 0x80) && shift < 64);
+	return value;
+}
+
+static inline uint32_t read32(EVE_TraceReader *reader)
+{
+	const uint8_t *p = reader->Ptr;
+	if (!readerCheck(reader, 4))
+		return 0;
+	reader->Ptr += 4;
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline const uint8_t *readBytes(EVE_TraceReader *reader, size_t size)
+{
+	const uint8_t *p = reader->Ptr;
+	if (!readerCheck(reader, size))
+		return NULL;
+	reader->Ptr += size;
+	return p;
+}
+
+/**
+ * @brief Load a complete trace file into memory
+ *
+ * @param filename Trace file
+ * @param size Output size of the file
+ * @return uint8_t* Allocated file contents, NULL on failure
+ */
+static uint8_t *loadTrace(const char *filename, size_t *size)
+{
+	FILE *file;
+	uint8_t *data;
+	long fileSize;
+	errno_t err;
+
+	err = fopen_s(&file, filename, "rb");
+	if (err || !file)
+	{
+		eve_printf_debug("Unable to open trace: %s\n", filename);
+		return NULL;
+	}
+	fseek(file, 0, SEEK_END);
+	fileSize = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	data = fileSize > 0 ? malloc((size_t)fileSize) : NULL;
+	if (!data || fread(data, 1, (size_t)fileSize, file) != (size_t)fileSize)
+	{
+		eve_printf_debug("Unable to read trace: %s\n", filename);
+		free(data);
+		fclose(file);
+		return NULL;
+	}
+	fclose(file);
+	*size = (size_t)fileSize;
+	return data;
+}
+
+/**
+ * @brief Whether a register is polled to synchronize with the coprocessor or media FIFO
+ *
+ * @param addr Register address
+ * @return true True if the recorded value must be reached before the replay continues
+ */
+static inline bool isSyncRegister(uint32_t addr)
+{
+	return addr == REG_CMDB_SPACE || addr == REG_CMD_READ || addr == REG_MEDIAFIFO_READ;
+}
+
+/**
+ * @brief Check whether a FIFO read pointer has passed a recorded value
+ *
+ * The read pointer only moves from the recorded value towards the write
+ * pointer, so it has passed the recorded value when it lies between the two.
+ *
+ * @param expected Recorded read pointer
+ * @param rp Current read pointer
+ * @param wp Current write pointer
+ * @return true True if rp is at or past expected
+ */
+static inline bool readPointerReached(uint32_t expected, uint32_t rp, uint32_t wp)
+{
+	if (EVE_CMD_FAULT(expected) || EVE_CMD_FAULT(rp))
+		return rp == expected;
+	return expected <= wp
+	    ? (rp >= expected && rp <= wp)
+	    : (rp >= expected || rp <= wp);
+}
+
+/**
+ * @brief Poll a synchronization register until the device is as far as recorded
+ *
+ * The replay does not wait on timestamps, so a polled register may not yet
+ * have the value which allowed the recorded session to continue. Writing ahead
+ * of it would overflow the FIFO, so poll until the device catches up.
+ * The interrupted read transfer is reopened at the next word before returning.
+ *
+ * @param phost Pointer to Hal context
+ * @param addr Register address
+ * @param expected Recorded value
+ * @param value Value read during replay
+ * @return true True if the device reached the recorded state
+ */
+static bool syncRegister(EVE_HalContext *phost, uint32_t addr, uint32_t expected, uint32_t value)
+{
+	uint32_t start = EVE_millis();
+	uint32_t wp = 0;
+	bool reached;
+
+	EVE_Hal_endTransfer(phost);
+	if (addr != REG_CMDB_SPACE)
+		wp = EVE_Hal_rd32(phost, addr == REG_CMD_READ ? REG_CMD_WRITE : REG_MEDIAFIFO_WRITE);
+
+	for (;;)
+	{
+		reached = addr == REG_CMDB_SPACE
+		    ? value >= expected
+		    : readPointerReached(expected, value, wp);
+		if (reached || EVE_millis() - start > EVE_TRACE_SYNC_TIMEOUT_MS)
+			break;
+		value = EVE_Hal_rd32(phost, addr);
+	}
+
+	EVE_Hal_startTransfer(phost, EVE_TRANSFER_READ, addr + 4);
+	return reached;
+}
+
+/**
+ * @brief Check a word read during replay against the recording
+ *
+ * @param phost Pointer to Hal context
+ * @param addr Address of the word
+ * @param expected Recorded value
+ * @param value Value read during replay
+ * @param stats Statistics
+ * @return true True if the replay may continue
+ */
+static bool checkWord(EVE_HalContext *phost, uint32_t addr, uint32_t expected, uint32_t value, EVE_TraceStats *stats)
+{
+	if (value == expected)
+		return true;
+	if (!isSyncRegister(addr))
+	{
+		++stats->ReadMismatches;
+		return true;
+	}
+	if (!syncRegister(phost, addr, expected, value))
+	{
+		eve_printf_debug("Replay lost sync at record %u, address 0x%08x, expected 0x%08x\n",
+		    (unsigned int)stats->Records, (unsigned int)addr, (unsigned int)expected);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Whether a read range covers a synchronization register
+ *
+ * @param addr Start address
+ * @param size Size of the read
+ * @return true True if the range must be replayed word by word
+ */
+static inline bool coversSyncRegister(uint32_t addr, uint32_t size)
+{
+	return !(addr & 3) && !(size & 3)
+	    && ((REG_CMDB_SPACE >= addr && REG_CMDB_SPACE < addr + size)
+	        || (REG_CMD_READ >= addr && REG_CMD_READ < addr + size)
+	        || (REG_MEDIAFIFO_READ >= addr && REG_MEDIAFIFO_READ < addr + size));
+}
+
+/** @name REPLAY */
+///@{
+
+/**
+ * @brief Replay a trace file through the transport of phost as fast as possible
+ *
+ * Reads of REG_CMDB_SPACE, REG_CMD_READ and REG_MEDIAFIFO_READ are polled until
+ * they reach the recorded value, so the replay never writes ahead of the device.
+ * Any other read that differs from the recording is counted as a mismatch.
+ *
+ * @param phost Pointer to Hal context
+ * @param filename Trace file
+ * @param stats Optional output statistics
+ * @return true True if the complete trace was replayed
+ * @return false False if the file is invalid or the device could not keep up
+ */
+bool EVE_Trace_replay(EVE_HalContext *phost, const char *filename, EVE_TraceStats *stats)
+{
+	EVE_TraceStats s;
+	EVE_TraceReader reader;
+	uint8_t *data;
+	uint8_t *scratch = NULL;
+	uint32_t scratchSize = 0;
+	size_t size;
+	uint32_t addr = 0;
+	uint64_t startMicros;
+	bool ok = true;
+
+	memset(&s, 0, sizeof(s));
+	if (stats)
+		*stats = s;
+	data = loadTrace(filename, &size);
+	if (!data)
+		return false;
+
+	if (size < 8 || memcmp(data, c_TraceMagic, 4) || data[4] != EVE_TRACE_VERSION)
+	{
+		eve_printf_debug("Invalid trace: %s\n", filename);
+		free(data);
+		return false;
+	}
+	if (data[5] != EVE_HOST)
+		eve_printf_debug("Replaying trace recorded on host %u\n", (unsigned int)data[5]);
+
+	reader.Ptr = data + 8;
+	reader.End = data + size;
+	reader.Error = false;
+
+	startMicros = EVE_micros64();
+	while (ok && reader.Ptr < reader.End && !reader.Error)
+	{
+		EVE_TRACE_RECORD_T type = (EVE_TRACE_RECORD_T)readByte(&reader);
+		s.RecordedMicros += readVarint(&reader);
+		++s.Records;
+
+		switch (type)
+		{
+		case EVE_TRACE_START_READ:
+		case EVE_TRACE_START_WRITE:
+			addr = read32(&reader);
+			EVE_Hal_startTransfer(phost, type == EVE_TRACE_START_READ ? EVE_TRANSFER_READ : EVE_TRANSFER_WRITE, addr);
+			++s.Transfers;
+			break;
+		case EVE_TRACE_END:
+			EVE_Hal_endTransfer(phost);
+			break;
+		case EVE_TRACE_WRITE32:
+			EVE_Hal_transfer32(phost, read32(&reader));
+			s.BytesWritten += 4;
+			break;
+		case EVE_TRACE_READ32:
+		{
+			uint32_t expected = read32(&reader);
+			uint32_t value = EVE_Hal_transfer32(phost, 0);
+			s.BytesRead += 4;
+			ok = checkWord(phost, addr, expected, value, &s);
+			addr += 4;
+			break;
+		}
+		case EVE_TRACE_WRITE:
+		{
+			uint32_t len = (uint32_t)readVarint(&reader);
+			const uint8_t *buffer = readBytes(&reader, len);
+			if (buffer)
+			{
+				EVE_Hal_transferMem(phost, NULL, buffer, len);
+				s.BytesWritten += len;
+			}
+			break;
+		}
+		case EVE_TRACE_READ:
+		{
+			uint32_t len = (uint32_t)readVarint(&reader);
+			const uint8_t *expected = readBytes(&reader, len);
+			if (!expected)
+				break;
+			if (coversSyncRegister(addr, len))
+			{
+				/* Burst read of polled registers, see EVE_Hal_rd32Multi */
+				uint32_t i;
+				for (i = 0; ok && i < len; i += 4)
+				{
+					uint32_t value = EVE_Hal_transfer32(phost, 0);
+					ok = checkWord(phost, addr, (uint32_t)expected[i] | (uint32_t)expected[i + 1] << 8
+					        | (uint32_t)expected[i + 2] << 16 | (uint32_t)expected[i + 3] << 24,
+					    value, &s);
+					s.BytesRead += 4;
+					addr += 4;
+				}
+				break;
+			}
+			if (len > scratchSize)
+			{
+				uint8_t *grown = realloc(scratch, len);
+				if (!grown)
+				{
+					ok = false;
+					break;
+				}
+				scratch = grown;
+				scratchSize = len;
+			}
+			EVE_Hal_transferMem(phost, scratch, NULL, len);
+			s.BytesRead += len;
+			addr += len;
+			if (memcmp(scratch, expected, len))
+				++s.ReadMismatches;
+			break;
+		}
+		case EVE_TRACE_STRING:
+		{
+			char str[EVE_CMD_STRING_MAX + 1];
+			uint32_t strSize = (uint32_t)readVarint(&reader);
+			uint32_t padMask = readByte(&reader);
+			uint32_t len = (uint32_t)readVarint(&reader);
+			const uint8_t *chars = readBytes(&reader, len);
+			if (!chars || len > EVE_CMD_STRING_MAX || strSize > EVE_CMD_STRING_MAX)
+			{
+				reader.Error = true;
+				break;
+			}
+			memcpy(str, chars, len);
+			str[len] = '\0';
+			s.BytesWritten += EVE_Hal_transferString(phost, str, 0, strSize, padMask);
+			break;
+		}
+		case EVE_TRACE_FLUSH:
+			EVE_Hal_flush(phost);
+			break;
+		case EVE_TRACE_SPI_CMD:
+		{
+			uint8_t cmd[5];
+			const uint8_t *recorded = readBytes(&reader, 5);
+			if (recorded)
+			{
+				memcpy(cmd, recorded, 5);
+				EVE_Hal_spiCommand(phost, cmd);
+			}
+			break;
+		}
+		case EVE_TRACE_POWER_CYCLE:
+			EVE_Hal_powerCycle(phost, readByte(&reader) != 0);
+			break;
+		case EVE_TRACE_SET_SPI:
+			EVE_Hal_setSPI(phost, (EVE_SPI_CHANNELS_T)readByte(&reader));
+			break;
+		default:
+			reader.Error = true;
+			break;
+		}
+	}
+	s.ReplayMicros = EVE_micros64() - startMicros;
+
+	/* Leave the transport idle if the replay stopped inside a transfer */
+	if (phost->Status == EVE_STATUS_READING || phost->Status == EVE_STATUS_WRITING)
+		EVE_Hal_endTransfer(phost);
+
+	if (reader.Error)
+	{
+		eve_printf_debug("Trace is truncated or corrupt at record %u\n", (unsigned int)s.Records);
+		ok = false;
+	}
+
+	free(scratch);
+	free(data);
+	if (stats)
+		*stats = s;
+	return ok;
+}
+///@}
+
+#endif /* EVE_TRACE */
+
+/* end of file */
@@ -0,0 +1,123 @@
+/**
+ * @file EVE_Trace.h
+ * @brief Bus transaction trace capture and replay
+ *
+ * @author Bridgetek
+ *
+ * @date 2025
+ *
+ * MIT License
+ *
+ * Copyright (c) [2025] [Bridgetek Pte Ltd (BRTChip)]
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef EVE_TRACE__H
+#define EVE_TRACE__H
+
+#include "EVE_HalImpl.h"
+
+#if EVE_TRACE
+
+/*
+Bus trace file format. All multi-byte fixed size fields are little endian,
+`varint` fields are unsigned LEB128.
+
+File header, 8 bytes:
+  char magic[4]    "EVTR"
+  uint8_t version  EVE_TRACE_VERSION
+  uint8_t host     EVE_HOST of the recording platform
+  uint16_t reserved
+
+Every record starts with:
+  uint8_t type     EVE_TRACE_RECORD_T
+  varint delta     Microseconds since the previous record
+
+Followed by a type specific body:
+  START_READ       uint32_t addr
+  START_WRITE      uint32_t addr
+  END              -
+  WRITE32          uint32_t value
+  READ32           uint32_t result
+  WRITE            varint size, uint8_t data[size]
+  READ             varint size, uint8_t result[size]
+  STRING           varint size, uint8_t padMask, varint length, char str[length]
+  FLUSH            -
+  SPI_CMD          uint8_t cmd[5]
+  POWER_CYCLE      uint8_t up
+  SET_SPI          uint8_t numchnls
+
+Records map one to one onto the transport calls in EVE_HalImpl.h, so a replay
+issues the exact same sequence of transfers as the recorded session.
+*/
+
+#define EVE_TRACE_VERSION 1
+
+typedef enum EVE_TRACE_RECORD_T
+{
+	EVE_TRACE_START_READ = 1,
+	EVE_TRACE_START_WRITE,
+	EVE_TRACE_END,
+	EVE_TRACE_WRITE32,
+	EVE_TRACE_READ32,
+	EVE_TRACE_WRITE,
+	EVE_TRACE_READ,
+	EVE_TRACE_STRING,
+	EVE_TRACE_FLUSH,
+	EVE_TRACE_SPI_CMD,
+	EVE_TRACE_POWER_CYCLE,
+	EVE_TRACE_SET_SPI,
+} EVE_TRACE_RECORD_T;
+
+/** Results of a trace replay */
+typedef struct EVE_TraceStats
+{
+	uint32_t Records;
+	uint32_t Transfers; /**< Number of startTransfer calls */
+	uint64_t BytesWritten; /**< Payload bytes, excluding addresses */
+	uint64_t BytesRead;
+	uint32_t ReadMismatches; /**< Reads which returned a different result than recorded */
+	uint64_t RecordedMicros; /**< Duration of the recorded session */
+	uint64_t ReplayMicros; /**< Duration of the replay */
+} EVE_TraceStats;
+
+/* Start recording all bus transactions of phost into a new trace file.
+Any recording already in progress is stopped first */
+bool EVE_Trace_start(EVE_HalContext *phost, const char *filename);
+
+/* Stop recording and close the trace file. No-op when not recording */
+void EVE_Trace_stop(EVE_HalContext *phost);
+
+/* Check if bus transactions of phost are being recorded */
+static inline bool EVE_Trace_active(EVE_HalContext *phost)
+{
+	return phost->Trace != NULL;
+}
+
+/* Replay a trace file through phost as fast as the transport allows, without
+waiting on the recorded timestamps. The device should be in the same state as
+at the start of the recording, typically freshly opened. Stats are optional */
+bool EVE_Trace_replay(EVE_HalContext *phost, const char *filename, EVE_TraceStats *stats);
+
+#endif /* EVE_TRACE */
+
+#endif /* EVE_TRACE__H */
+
+/* end of file */
@@ -30,6 +30,7 @@
 */
 
 #include "EVE_Util.h"
+#include "EVE_CoCmd.h"
 
 static const uint8_t c_DlCodeBootup[12] = {
 	0, 0, 0, 2, // GPU instruction CLEAR_COLOR_RGB: BLUE, GREEN, RED, ID(0x02)
@@ -57,6 +58,8 @@ static const char *s_HostDisplayNames[EVE_HOST_NB] = {
 
 	"FT4222",
 	"MPSSE",
+	"Linux spidev",
+	"Device model",
 };
 
 #endif
@@ -104,6 +107,10 @@ void EVE_Util_bootupDefaults(EVE_HalContext *phost, EVE_BootupParameters *bootup
 #else
 	bootup->SpiChannels = EVE_SPI_SINGLE_CHANNEL;
 #endif
+
+	bootup->SpiCalibrate = EVE_SPI_CALIBRATE;
+	bootup->SpiClockMaxKHz = EVE_SPI_CALIBRATE_MAX_KHZ;
+	bootup->CmdRingSelect = EVE_CMD_RING_SELECT;
 }
 
 #ifndef EVE_HARDCODED_DISPLAY_TIMINGS
@@ -417,6 +424,15 @@ bool EVE_Util_bootup(EVE_HalContext *phost, EVE_BootupParameters *bootup)
 	uint32_t retryCpuReset = 100;
 
 	/* EVE will be in SPI Single channel after POR */
+	EVE_Hal_regShadowClear(phost);
+	phost->CmdRing = false; /* Until selected again, see EVE_Util_selectCmdRing */
+	phost->CmdWp = 0;
+	phost->CmdWpPublished = 0;
+	phost->CmdWritten += EVE_CMD_FIFO_SIZE + 4; /* Pending query results are lost */
+	phost->CmdListCount = 0; /* Uploaded command lists are lost with RAM_G */
+	phost->CmdFenceDropped = phost->CmdFenceSeq; /* Pending fences are never reached */
+	phost->CmdFenceDone = phost->CmdFenceSeq;
+	phost->CmdFenceReady = false; /* The slot is rewritten before the next fence */
 	if (!EVE_Hal_powerCycle(phost, true))
 		return false;
 
@@ -587,19 +603,22 @@ bool EVE_Util_config(EVE_HalContext *phost, EVE_ConfigParameters *config)
 
 	phost->PCLK = 0;
 
+	/* In address order, so the timing registers are sent in a single transfer */
+	EVE_Hal_regBatchBegin(phost);
 	EVE_Hal_wr32(phost, REG_HCYCLE, config->HCycle);
 	EVE_Hal_wr32(phost, REG_HOFFSET, config->HOffset);
+	EVE_Hal_wr32(phost, REG_HSIZE, config->Width);
 	EVE_Hal_wr32(phost, REG_HSYNC0, config->HSync0);
 	EVE_Hal_wr32(phost, REG_HSYNC1, config->HSync1);
 	EVE_Hal_wr32(phost, REG_VCYCLE, config->VCycle);
 	EVE_Hal_wr32(phost, REG_VOFFSET, config->VOffset);
+	EVE_Hal_wr32(phost, REG_VSIZE, config->Height);
 	EVE_Hal_wr32(phost, REG_VSYNC0, config->VSync0);
 	EVE_Hal_wr32(phost, REG_VSYNC1, config->VSync1);
 	EVE_Hal_wr32(phost, REG_PCLK_POL, config->PCLKPol);
-	EVE_Hal_wr32(phost, REG_HSIZE, config->Width);
-	EVE_Hal_wr32(phost, REG_VSIZE, config->Height);
 	EVE_Hal_wr32(phost, REG_DISP, 1);
 	EVE_Hal_wr32(phost, REG_PWM_DUTY, 128);
+	EVE_Hal_regBatchEnd(phost);
 
 	EVE_Util_clearScreen(phost);
 
@@ -676,6 +695,7 @@ void EVE_Util_shutdown(EVE_HalContext *phost)
 
 	EVE_Hal_flush(phost);
 	EVE_Hal_powerCycle(phost, false);
+	EVE_Hal_regShadowClear(phost);
 }
 
 #if defined(_DEBUG)
@@ -726,20 +746,31 @@ bool EVE_Util_resetCoprocessor(EVE_HalContext *phost)
 	eve_printf_debug("Reset coprocessor\n");
 
 	/* Set REG_CPURESET to 1, to hold the coprocessor in the reset condition */
+	EVE_Hal_regShadowClear(phost);
 	EVE_Hal_wr32(phost, REG_CPURESET, 1);
 	EVE_Hal_flush(phost);
 	EVE_sleep(100);
 
 	/* Set REG_CMD_READ and REG_CMD_WRITE to zero */
+	EVE_Hal_regBatchBegin(phost);
 	EVE_Hal_wr32(phost, REG_CMD_READ, 0);
 	EVE_Hal_wr32(phost, REG_CMD_WRITE, 0);
 	EVE_Hal_wr32(phost, REG_CMD_DL, 0);
 
 	/* Stop playing audio in case video with audio was playing during reset */
 	EVE_Hal_wr32(phost, REG_PLAYBACK_PLAY, 0);
+	EVE_Hal_regBatchEnd(phost);
 
 	/* Default */
 	phost->CmdFault = false;
+	phost->CmdStageUsed = 0; /* Staged commands are dropped with the fifo */
+	phost->CmdWp = 0;
+	phost->CmdWpPublished = 0;
+	phost->CmdWritten += EVE_CMD_FIFO_SIZE + 4; /* Pending query results are lost */
+	phost->CmdListCount = 0; /* A command list upload may be cut short */
+	phost->CmdFenceDropped = phost->CmdFenceSeq; /* Pending fences are never reached */
+	phost->CmdFenceDone = phost->CmdFenceSeq;
+	phost->CmdFenceReady = false; /* The slot is rewritten before the next fence */
 
 	/* Set REG_CPURESET to 0, to restart the coprocessor */
 	EVE_Hal_wr32(phost, REG_CPURESET, 0);
@@ -785,12 +816,228 @@ void EVE_Util_coprocessorFaultRecover(EVE_HalContext *phost)
 
 	/* Default */
 	phost->CmdFault = false;
+	phost->CmdStageUsed = 0; /* Staged commands are dropped with the fifo */
+	phost->CmdWp = 0;
+	phost->CmdWpPublished = 0;
+	phost->CmdWritten += EVE_CMD_FIFO_SIZE + 4; /* Pending query results are lost */
+	phost->CmdListCount = 0; /* A command list upload may be cut short */
+	phost->CmdFenceDropped = phost->CmdFenceSeq; /* Pending fences are never reached */
+	phost->CmdFenceDone = phost->CmdFenceSeq;
+	phost->CmdFenceReady = false; /* The slot is rewritten before the next fence */
 
 #if defined(_DEBUG)
 	debugRestoreRamG(phost);
 #endif
 }
 
+/** @name SPI CALIBRATION */
+///@{
+
+/* Host side CRC-32, matching CMD_MEMCRC */
+static uint32_t calibrateCrc(const uint8_t *data, uint32_t size)
+{
+	uint32_t crc = 0xFFFFFFFFUL;
+	uint32_t i;
+	int b;
+
+	for (i = 0; i < size; ++i)
+	{
+		crc ^= data[i];
+		for (b = 0; b < 8; ++b)
+			crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+	}
+	return crc ^ 0xFFFFFFFFUL;
+}
+
+/* Write a pseudo-random pattern to RAM_G and verify it by readback and by CMD_MEMCRC */
+static bool calibrateVerify(EVE_HalContext *phost, uint8_t *pattern, uint8_t *readback, uint32_t rounds)
+{
+	uint32_t round;
+	uint32_t seed;
+	uint32_t crc;
+	uint32_t i;
+
+	for (round = 0; round < rounds; ++round)
+	{
+		seed = 0x2545F491UL ^ (round * 0x9E3779B9UL) ^ phost->SpiClockrateKHz ^ ((uint32_t)phost->SpiChannels << 24);
+		if (!seed)
+			seed = 1;
+		for (i = 0; i < EVE_SPI_CALIBRATE_SIZE; ++i)
+		{
+			seed ^= seed << 13;
+			seed ^= seed >> 17;
+			seed ^= seed << 5;
+			pattern[i] = (uint8_t)seed;
+		}
+
+		EVE_Hal_wrMem(phost, EVE_SPI_CALIBRATE_ADDR, pattern, EVE_SPI_CALIBRATE_SIZE);
+		EVE_Hal_rdMem(phost, readback, EVE_SPI_CALIBRATE_ADDR, EVE_SPI_CALIBRATE_SIZE);
+		if (phost->Status == EVE_STATUS_ERROR || memcmp(pattern, readback, EVE_SPI_CALIBRATE_SIZE))
+			return false;
+
+		/* Only involve the coprocessor once the readback is known good,
+		as polling REG_CMD_READ over a corrupted bus may not terminate */
+		if (!EVE_CoCmd_memCrc(phost, EVE_SPI_CALIBRATE_ADDR, EVE_SPI_CALIBRATE_SIZE, &crc))
+			return false;
+		if (crc != calibrateCrc(pattern, EVE_SPI_CALIBRATE_SIZE))
+			return false;
+	}
+	return true;
+}
+
+/* Return to a previously verified setting */
+static void calibrateRestore(EVE_HalContext *phost, EVE_SPI_CHANNELS_T channels, uint32_t clockKHz)
+{
+	EVE_Hal_setSPIClock(phost, clockKHz);
+	EVE_Hal_setSPI(phost, channels);
+	if (phost->CmdFault)
+		EVE_Util_resetCoprocessor(phost);
+}
+
+/**
+ * @brief Find the fastest reliable SPI clock and channel mode
+ * 
+ * Starting from the current clock in single channel mode, first widens the bus
+ * up to maxChannels, then steps up the clock by EVE_SPI_CALIBRATE_STEP_KHZ up to maxClockKHz.
+ * Each step must pass all rounds of a pseudo-random pattern test on RAM_G,
+ * verified by readback and by CMD_MEMCRC. When a step fails, the clock is set
+ * one step below the last passing clock, as a safety margin.
+ * 
+ * The first EVE_SPI_CALIBRATE_SIZE bytes of RAM_G are overwritten.
+ * Requires the coprocessor to be running, call after EVE_Util_config.
+ * 
+ * @param phost Pointer to Hal context
+ * @param maxChannels Widest channel mode to try
+ * @param maxClockKHz Highest SPI clock to try, in kHz
+ * @param rounds Number of pattern tests each step must pass
+ * @return true True if a verified setting is in place
+ * @return false False if even the starting setting is unreliable
+ */
+bool EVE_Util_calibrateSpi(EVE_HalContext *phost, EVE_SPI_CHANNELS_T maxChannels, uint32_t maxClockKHz, uint32_t rounds)
+{
+	uint8_t *pattern;
+	uint8_t *readback;
+	uint32_t baseKHz = phost->SpiClockrateKHz;
+	uint32_t goodKHz = baseKHz;
+	uint32_t marginKHz = baseKHz;
+	uint32_t clockKHz;
+	uint32_t actualKHz;
+	EVE_SPI_CHANNELS_T channels;
+	EVE_SPI_CHANNELS_T goodChannels = EVE_SPI_SINGLE_CHANNEL;
+	bool failed = false;
+	bool res;
+
+	pattern = malloc(EVE_SPI_CALIBRATE_SIZE * 2);
+	if (!pattern)
+		return false;
+	readback = pattern + EVE_SPI_CALIBRATE_SIZE;
+
+	/* Establish the starting setting */
+	EVE_Hal_setSPI(phost, EVE_SPI_SINGLE_CHANNEL);
+	if (!calibrateVerify(phost, pattern, readback, rounds))
+	{
+		eve_printf_debug("SPI calibration failed at %u kHz single channel\n", (unsigned int)baseKHz);
+		calibrateRestore(phost, EVE_SPI_SINGLE_CHANNEL, baseKHz);
+		free(pattern);
+		return false;
+	}
+
+	/* Widen the bus at the starting clock */
+	for (channels = EVE_SPI_DUAL_CHANNEL; channels <= maxChannels; ++channels)
+	{
+		EVE_Hal_setSPI(phost, channels);
+		if (phost->SpiChannels != channels || !calibrateVerify(phost, pattern, readback, rounds))
+			break;
+		goodChannels = channels;
+	}
+	if (phost->SpiChannels != goodChannels)
+		calibrateRestore(phost, goodChannels, baseKHz);
+
+	/* Step up the clock */
+	for (clockKHz = baseKHz + EVE_SPI_CALIBRATE_STEP_KHZ; clockKHz <= maxClockKHz; clockKHz += EVE_SPI_CALIBRATE_STEP_KHZ)
+	{
+		actualKHz = EVE_Hal_setSPIClock(phost, clockKHz);
+		if (actualKHz <= goodKHz)
+			continue; /* Host cannot go faster in this step */
+		if (!calibrateVerify(phost, pattern, readback, rounds))
+		{
+			failed = true;
+			break;
+		}
+		marginKHz = goodKHz;
+		goodKHz = actualKHz;
+	}
+
+	/* Back off one step if the limit was found, rather than the maximum requested */
+	clockKHz = failed ? marginKHz : goodKHz;
+	calibrateRestore(phost, goodChannels, clockKHz);
+	res = calibrateVerify(phost, pattern, readback, rounds);
+	if (!res)
+	{
+		calibrateRestore(phost, EVE_SPI_SINGLE_CHANNEL, baseKHz);
+		res = calibrateVerify(phost, pattern, readback, rounds);
+	}
+	free(pattern);
+
+	eve_printf_debug("SPI calibrated to %u kHz, %s channel (passed up to %u kHz)\n", (unsigned int)phost->SpiClockrateKHz,
+	    (phost->SpiChannels == EVE_SPI_QUAD_CHANNEL) ? "Quad" : ((phost->SpiChannels == EVE_SPI_DUAL_CHANNEL) ? "Dual" : "Single"),
+	    (unsigned int)goodKHz);
+	return res;
+}
+
+///@}
+
+/**
+ * @brief Select whether commands are written directly into RAM_CMD
+ * 
+ * Writes the same number of CMD_NOP commands through REG_CMDB_WRITE and
+ * into RAM_CMD, and keeps ring mode only when it is faster by more than
+ * 1/16th, see EVE_Cmd_setRing. Call after EVE_Util_config.
+ * 
+ * @param phost Pointer to Hal context
+ * @param size Number of command bytes written each way
+ * @return true True if ok
+ * @return false False if error, ring mode is left off
+ */
+bool EVE_Util_selectCmdRing(EVE_HalContext *phost, uint32_t size)
+{
+	uint8_t *nops;
+	uint64_t micros[2];
+	uint64_t start;
+	uint32_t written;
+	uint32_t i;
+	int ring;
+	bool res = true;
+
+	nops = malloc(EVE_CMD_RESERVE_MAX);
+	if (!nops)
+		return false;
+	for (i = 0; i < EVE_CMD_RESERVE_MAX; i += 4)
+		EVE_Cmd_put32(&nops[i], CMD_NOP);
+
+	for (ring = 0; ring < 2 && res; ++ring)
+	{
+		res = EVE_Cmd_setRing(phost, ring);
+		start = EVE_micros64();
+		for (written = 0; written < size && res; written += EVE_CMD_RESERVE_MAX)
+			res = EVE_Cmd_wrMem(phost, nops, EVE_CMD_RESERVE_MAX);
+		res = res && EVE_Cmd_waitFlush(phost);
+		micros[ring] = EVE_micros64() - start;
+	}
+	free(nops);
+
+	ring = res && (micros[1] + (micros[1] >> 4) < micros[0]);
+	if (!EVE_Cmd_setRing(phost, ring) || !res)
+	{
+		EVE_Cmd_setRing(phost, false);
+		return false;
+	}
+
+	eve_printf_debug("Command writes through %s, %u us against %u us\n", ring ? "RAM_CMD" : "REG_CMDB_WRITE",
+	    (unsigned int)micros[ring], (unsigned int)micros[!ring]);
+	return true;
+}
+
 /**
  * @brief Bootup Coprocessor
  * 
@@ -816,6 +1063,18 @@ bool EVE_Util_bootupConfig(EVE_HalContext *phost)
 		return false;
 	}
 
+	if (bootup.SpiCalibrate)
+	{
+		/* Not fatal, calibration always leaves a verified or the original setting in place */
+		EVE_Util_calibrateSpi(phost, bootup.SpiChannels, bootup.SpiClockMaxKHz, EVE_SPI_CALIBRATE_ROUNDS);
+	}
+
+	if (bootup.CmdRingSelect)
+	{
+		/* After the calibration, the choice depends on the SPI clock */
+		EVE_Util_selectCmdRing(phost, EVE_CMD_RING_SELECT_SIZE);
+	}
+
 	return true;
 }
 
@@ -843,4 +1102,99 @@ uint32_t EVE_Util_currentFrequency(EVE_HalContext *phost)
 		interval = 0xFFFFFFFF - t0 + t1;
 	return (interval / 1000000);
 }
+
+/**
+ * @brief Measure the read throughput of the transport
+ * 
+ * Reads a block of device memory repeatedly, and prints the achieved rate.
+ * Use a large block to measure bulk readback, or 4 bytes for register reads.
+ * 
+ * @param phost Pointer to Hal context
+ * @param addr Address to read from
+ * @param size Number of bytes per read
+ * @param iterations Number of reads
+ * @return uint32_t Throughput in KB/s, 0 on error
+ */
+uint32_t EVE_Util_benchmarkRead(EVE_HalContext *phost, uint32_t addr, uint32_t size, uint32_t iterations)
+{
+	uint8_t *buffer;
+	uint64_t start;
+	uint64_t elapsed;
+	uint64_t total = (uint64_t)size * iterations;
+	uint32_t rate;
+	uint32_t i;
+
+	buffer = malloc(size);
+	if (!buffer)
+		return 0;
+
+	start = EVE_micros64();
+	for (i = 0; i < iterations && phost->Status != EVE_STATUS_ERROR; ++i)
+		EVE_Hal_rdMem(phost, buffer, addr, size);
+	elapsed = EVE_micros64() - start;
+	free(buffer);
+
+	if (phost->Status == EVE_STATUS_ERROR || !elapsed)
+		return 0;
+
+	rate = (uint32_t)(total * 1000 / elapsed);
+	eve_printf("Read %u x %u bytes in %u ms: %u.%03u MB/s\n", (unsigned int)iterations, (unsigned int)size,
+	    (unsigned int)(elapsed / 1000), (unsigned int)(rate / 1000), (unsigned int)(rate % 1000));
+	return rate;
+}
+
+/**
+ * @brief Measure the rate of writing display list words
+ * 
+ * Writes frames of VERTEX2F words with EVE_CoCmd_dl, either one call per
+ * word, or into the space of EVE_Cmd_startFuncReserve, and prints the
+ * achieved rate. The time includes waiting for each frame to be processed.
+ * On the SIM platform the device model processes the commands instantly,
+ * which leaves the cost of the host side.
+ * 
+ * @param phost Pointer to Hal context
+ * @param words Number of display list words per frame, up to EVE_DL_SIZE / 4 - 4
+ * @param frames Number of frames
+ * @param fast Write the words into the space of EVE_Cmd_startFuncReserve
+ * @return uint32_t Words per second, 0 on error
+ */
+uint32_t EVE_Util_benchmarkDl(EVE_HalContext *phost, uint32_t words, uint32_t frames, bool fast)
+{
+	uint64_t start;
+	uint64_t elapsed;
+	uint64_t total = (uint64_t)words * frames;
+	uint32_t rate;
+	uint32_t i;
+	uint32_t j;
+
+	eve_assert(words <= EVE_DL_SIZE / 4 - 4);
+
+	start = EVE_micros64();
+	for (i = 0; i < frames; ++i)
+	{
+		EVE_CoCmd_dlStart(phost);
+		EVE_CoCmd_dl(phost, CLEAR(1, 1, 1));
+		EVE_CoCmd_dl(phost, BEGIN(POINTS));
+		if (fast && !EVE_Cmd_startFuncReserve(phost, EVE_CMD_RESERVE_MAX))
+			return 0;
+		for (j = 0; j < words; ++j)
+			EVE_CoCmd_dl(phost, VERTEX2F(j & 0x3FF, j >> 10));
+		if (fast)
+			EVE_Cmd_endFunc(phost);
+		EVE_CoCmd_dl(phost, END());
+		EVE_CoCmd_dl(phost, DISPLAY());
+		EVE_CoCmd_swap(phost);
+		if (!EVE_Cmd_waitFlush(phost))
+			return 0;
+	}
+	elapsed = EVE_micros64() - start;
+
+	if (!elapsed)
+		return 0;
+
+	rate = (uint32_t)(total * 1000000 / elapsed);
+	eve_printf("%s %u x %u words in %u ms: %u words/s\n", fast ? "Reserved" : "Per call", (unsigned int)frames, (unsigned int)words,
+	    (unsigned int)(elapsed / 1000), (unsigned int)rate);
+	return rate;
+}
 /* end of file */
@@ -37,6 +37,22 @@
  *********************/
 #include "EVE_Cmd.h"
 
+/**********************
+ *      DEFINES
+ **********************/
+/** @name SPI calibration, see EVE_Util_calibrateSpi */
+///@{
+#ifndef EVE_SPI_CALIBRATE_MAX_KHZ
+#define EVE_SPI_CALIBRATE_MAX_KHZ 30000 /**< Default highest SPI clock tried */
+#endif
+#define EVE_SPI_CALIBRATE_STEP_KHZ 5000 /**< Clock increment per step, also the safety margin */
+#define EVE_SPI_CALIBRATE_ROUNDS 4 /**< Pattern tests each step must pass */
+#define EVE_SPI_CALIBRATE_ADDR RAM_G /**< Test pattern location */
+#define EVE_SPI_CALIBRATE_SIZE 4096 /**< Test pattern size in bytes */
+///@}
+
+#define EVE_CMD_RING_SELECT_SIZE 65536 /**< Command bytes written each way by EVE_Util_bootupConfig, see EVE_Util_selectCmdRing */
+
 /**********************
  *      TYPEDEFS
  **********************/
@@ -51,6 +67,13 @@ typedef struct EVE_BootupParameters
 	/** SPI */
 	EVE_SPI_CHANNELS_T SpiChannels; /**< Variable to contain single/dual/quad channels */
 
+	/** SPI calibration by EVE_Util_bootupConfig, up to SpiChannels (default: EVE_SPI_CALIBRATE) */
+	bool SpiCalibrate;
+	uint32_t SpiClockMaxKHz; /**< Highest SPI clock tried by the calibration */
+
+	/** Choice between REG_CMDB_WRITE and direct RAM_CMD writes by EVE_Util_bootupConfig (default: EVE_CMD_RING_SELECT) */
+	bool CmdRingSelect;
+
 } EVE_BootupParameters;
 
 typedef struct EVE_ConfigParameters
@@ -122,9 +145,26 @@ bool EVE_Util_resetCoprocessor(EVE_HalContext *phost);
 /* Recover from the coprocessor fault */
 void EVE_Util_coprocessorFaultRecover(EVE_HalContext *phost);
 
+/* Find the fastest reliable SPI clock and channel mode. Call after EVE_Util_config. Overwrites the start of RAM_G. */
+bool EVE_Util_calibrateSpi(EVE_HalContext *phost, EVE_SPI_CHANNELS_T maxChannels, uint32_t maxClockKHz, uint32_t rounds);
+
+/* Time command writes through REG_CMDB_WRITE and directly into RAM_CMD, and keep the faster. Call after EVE_Util_config. */
+bool EVE_Util_selectCmdRing(EVE_HalContext *phost, uint32_t size);
+
 /* Calls EVE_Util_bootup and EVE_Util_config using the default parameters */
 bool EVE_Util_bootupConfig(EVE_HalContext *phost);
 ///@}
+
+/** @name BENCHMARK */
+///@{
+/* Reads size bytes from addr iterations times, prints the throughput and returns it in KB/s.
+Compares transport settings, such as the SPI clock rate and channels */
+uint32_t EVE_Util_benchmarkRead(EVE_HalContext *phost, uint32_t addr, uint32_t size, uint32_t iterations);
+
+/* Writes `frames` display lists of `words` words, prints the rate and returns it in words per second.
+Compares EVE_CoCmd_dl with and without the space of EVE_Cmd_startFuncReserve */
+uint32_t EVE_Util_benchmarkDl(EVE_HalContext *phost, uint32_t words, uint32_t frames, bool fast);
+///@}
 #endif /* #ifndef EVE_UTIL__H */
 
 /* end of file */